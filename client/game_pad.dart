@@ -144,6 +144,19 @@ class GamePad
   static List<GamePadState> _gamePads;
   /// The last requested player index
   static int _playerIndex;
+  /// Bitmask of the game pads subscribed to; 0 to receive the requested index
+  static int _subscribedPads = 0;
+  /// Whether to ask the server for binary frames
+  static bool useBinaryFormat = true;
+  /// The last round trip to the server in milliseconds; null until measured
+  static int latency;
+
+  /// Scale of the thumbsticks in binary frames
+  static final double _thumbstickScale = 1.0 / 32767.0;
+  /// Scale of the triggers in binary frames
+  static final double _triggerScale = 1.0 / 255.0;
+  /// Set in the flags of a binary frame holding only the changed fields
+  static final int _deltaFlag = 1 << 1;
 
   static bool get isConnected => _connected;
 
@@ -164,8 +177,8 @@ class GamePad
     if ((_connection != null) && (_connected))
     {
       // See if a new index is being requested
-      // If so notify the server
-      if (_playerIndex != index)
+      // If so notify the server unless already subscribed to it
+      if ((_playerIndex != index) && ((_subscribedPads & (1 << index)) == 0))
       {
         String message = '{ "type": "index", "index": $index }';
 
@@ -178,6 +191,44 @@ class GamePad
     _gamePads[index].cloneTo(state);
   }
 
+  /**
+   * Receives the state of several game pads on the one connection.
+   *
+   * The server sends every game pad that changed in a frame together.
+   */
+  static void subscribe(List<int> indices)
+  {
+    int pads = 0;
+
+    for (int index in indices)
+      pads |= 1 << index;
+
+    _subscribedPads = pads;
+
+    if ((_connection != null) && (_connected))
+      _sendSubscription();
+  }
+
+  static void _sendSubscription()
+  {
+    _connection.send('{ "type": "subscribe", "pads": $_subscribedPads }');
+  }
+
+  /**
+   * Measures the round trip to the server.
+   *
+   * The result is in [latency] once the server answers.
+   */
+  static void measureLatency()
+  {
+    if ((_connection != null) && (_connected))
+    {
+      int time = new Date.now().millisecondsSinceEpoch;
+
+      _connection.send('{ "type": "ping", "time": $time }');
+    }
+  }
+
   static void setVibration(int index, double leftMotor, double rightMotor)
   {
     if ((_connection != null) && (_connected))
@@ -193,13 +244,40 @@ class GamePad
     if (_connection != null)
       disconnectFromServer;
 
+    // Ask which shard to connect to
+    // Servers without shards don't answer so use the default port
+    XMLHttpRequest request = new XMLHttpRequest();
+    request.open('GET', 'http://$ip:$_port/shard', true);
+
+    request.on.loadEnd.add((e) {
+      int port = _port;
+
+      if (request.status == 200)
+        port = Math.parseInt(request.responseText);
+
+      _openConnection(ip, port, onOpen, onClose);
+    });
+
+    request.send();
+  }
+
+  static void _openConnection(String ip, int port, EventListener onOpen, EventListener onClose)
+  {
     // Setup the connection
-    _connection = new WebSocket('ws://$ip:$_port/ws');
+    _connection = new WebSocket('ws://$ip:$port/ws');
+    _connection.binaryType = 'arraybuffer';
 
     // Connect to the open event
     _connection.on.open.add((e) {
       print("Connected!");
       _connected = true;
+
+      // Servers that don't understand binary frames ignore the request
+      if (useBinaryFormat)
+        _connection.send('{ "type": "format", "format": "binary" }');
+
+      if (_subscribedPads != 0)
+        _sendSubscription();
     });
 
     _connection.on.open.add(onOpen);
@@ -218,7 +296,10 @@ class GamePad
 
     // Receive the game pad updates
     _connection.on.message.add((MessageEvent e) {
-      _receiveMessage(e.data);
+      if (e.data is String)
+        _receiveMessage(e.data);
+      else
+        _receiveBinaryMessage(e.data);
     });
   }
 
@@ -231,10 +312,124 @@ class GamePad
     }
   }
 
+  static void _receiveBinaryMessage(ArrayBuffer message)
+  {
+    // See GamePadSerialization on the server for the layouts
+    // Subscribing to several game pads sends their frames back to back
+    DataView frame = new DataView(message);
+    int offset = 0;
+
+    while (offset < frame.byteLength)
+    {
+      offset = _receiveFrame(frame, offset);
+
+      if (offset < 0)
+        return;
+    }
+  }
+
+  static int _receiveFrame(DataView frame, int offset)
+  {
+    int index = frame.getUint8(offset);
+
+    if (index >= _gamePads.length)
+      return -1;
+
+    GamePadState gamePad = _gamePads[index];
+    int flags = frame.getUint8(offset + 1);
+
+    gamePad._connected = (flags & 1) == 1;
+
+    if ((flags & _deltaFlag) == _deltaFlag)
+      return _applyDelta(gamePad, frame, offset);
+
+    gamePad._buttons = frame.getUint16(offset + 2, true);
+
+    gamePad._leftThumbstick.setValues(
+      frame.getInt16(offset + 4, true) * _thumbstickScale,
+      frame.getInt16(offset + 6, true) * _thumbstickScale
+    );
+
+    gamePad._rightThumbstick.setValues(
+      frame.getInt16(offset + 8, true) * _thumbstickScale,
+      frame.getInt16(offset + 10, true) * _thumbstickScale
+    );
+
+    gamePad._leftTrigger = frame.getUint8(offset + 12) * _triggerScale;
+    gamePad._rightTrigger = frame.getUint8(offset + 13) * _triggerScale;
+
+    return offset + 16;
+  }
+
+  static int _applyDelta(GamePadState gamePad, DataView frame, int offset)
+  {
+    int mask = frame.getUint8(offset + 4);
+    offset += 5;
+
+    if ((mask & (1 << 0)) != 0)
+    {
+      gamePad._buttons = frame.getUint16(offset, true);
+      offset += 2;
+    }
+
+    if ((mask & (1 << 1)) != 0)
+    {
+      gamePad._leftThumbstick.x = frame.getInt16(offset, true) * _thumbstickScale;
+      offset += 2;
+    }
+
+    if ((mask & (1 << 2)) != 0)
+    {
+      gamePad._leftThumbstick.y = frame.getInt16(offset, true) * _thumbstickScale;
+      offset += 2;
+    }
+
+    if ((mask & (1 << 3)) != 0)
+    {
+      gamePad._rightThumbstick.x = frame.getInt16(offset, true) * _thumbstickScale;
+      offset += 2;
+    }
+
+    if ((mask & (1 << 4)) != 0)
+    {
+      gamePad._rightThumbstick.y = frame.getInt16(offset, true) * _thumbstickScale;
+      offset += 2;
+    }
+
+    if ((mask & (1 << 5)) != 0)
+      gamePad._leftTrigger = frame.getUint8(offset++) * _triggerScale;
+
+    if ((mask & (1 << 6)) != 0)
+      gamePad._rightTrigger = frame.getUint8(offset++) * _triggerScale;
+
+    return offset;
+  }
+
   static void _receiveMessage(String message)
   {
-    Map json = JSON.parse(message);
+    var parsed = JSON.parse(message);
 
+    if ((parsed is Map) && (parsed['type'] == 'pong'))
+    {
+      num sent = parsed['time'];
+      latency = new Date.now().millisecondsSinceEpoch - sent.toInt();
+      return;
+    }
+
+    // Subscribing to several game pads sends a list of their states
+    if (parsed is List)
+    {
+      for (Map json in parsed)
+        _receiveState(json);
+    }
+    else
+    {
+      _receiveState(parsed);
+    }
+  }
+
+  static void _receiveState(Map json)
+  {
     int index = json['index'];
     GamePadState gamePad = _gamePads[index];
 
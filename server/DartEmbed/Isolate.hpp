@@ -36,6 +36,12 @@
 
 namespace DartEmbed
 {
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class EmbedIsolateData;
+
 	class Isolate
 	{
 		//---------------------------------------------------------------------
@@ -50,16 +56,29 @@ namespace DartEmbed
 			Isolate(
 				Dart_Isolate isolate,
 				Dart_Handle library,
-				Isolate* parent
+				Isolate* parent,
+				EmbedIsolateData* data
 			);
 
-		public:
-
 			/**
 			 * Destroys the current Isolate.
+			 *
+			 * Only called by the shutdown callback, once the virtual machine
+			 * has shut the isolate down.
 			 */
 			~Isolate();
 
+		public:
+
+			/**
+			 * Shuts down the isolate.
+			 *
+			 * The isolate is entered on the calling thread if it isn't
+			 * already. Native objects owned by the isolate, and the Isolate
+			 * itself, are freed once the virtual machine has shut it down.
+			 */
+			void shutdown();
+
 		//---------------------------------------------------------------------
 		// Properties
 		//---------------------------------------------------------------------
@@ -82,6 +101,10 @@ namespace DartEmbed
 			/**
 			 * Invokes a function within the isolate.
 			 *
+			 * Returns once the function does. Any messages the function leaves
+			 * behind, such as timers or I/O, are handled by a MessageLoop the
+			 * isolate is attached to.
+			 *
 			 * \param name The name of the function to invoke.
 			 */
 			void invokeFunction(const char* name);
@@ -107,14 +130,14 @@ namespace DartEmbed
 			 * \param scriptUri The URI to the script.
 			 * \param main The entry point to the isolate.
 			 * \param resolveScript Whether the script needs resoltion to a uri.
-			 * \param callbackData Pointer to the parent isolate.
+			 * \param parent The isolate spawning the isolate, or 0.
 			 * \param error A pointer to an error message.
 			 */
 			static Isolate* createIsolate(
 				const char* scriptUri,
 				const char* main,
 				bool resolveScript,
-				void* data,
+				Isolate* parent,
 				char** error);
 
 			/**
@@ -125,7 +148,7 @@ namespace DartEmbed
 			 *
 			 * \param scriptUri The URI to the script.
 			 * \param main The entry point to the isolate.
-			 * \param callbackData Pointer to the parent isolate.
+			 * \param callbackData The data of the parent isolate.
 			 * \param error A pointer to an error message.
 			 */
 			static bool isolateCreateCallback(
@@ -137,13 +160,31 @@ namespace DartEmbed
 			/**
 			 * Callback for when an isolate is shut down.
 			 *
-			 * This is only called when an isolate that was created within a script
-			 * was shutdown.
+			 * Called for every isolate, including those the virtual machine
+			 * shuts down after a spawned isolate finishes. Frees the isolate
+			 * data, the native objects it owns and the Isolate.
 			 *
 			 * \param callbackData A pointer to the isolate data.
 			 */
 			static void isolateShutdownCallback(void* callbackData);
 
+			/**
+			 * Compiles everything loaded into the current isolate.
+			 *
+			 * \param scriptUri The URI of the script, used when reporting.
+			 * \returns true if the isolate was compiled; false otherwise.
+			 */
+			static bool compileAll(const char* scriptUri);
+
+			/**
+			 * Sets the parent of the isolate.
+			 *
+			 * Used when a pooled isolate is claimed by a spawning isolate.
+			 *
+			 * \param parent The isolate that spawned the isolate, or 0.
+			 */
+			void setParent(Isolate* parent);
+
 		//---------------------------------------------------------------------
 		// Member variables
 		//---------------------------------------------------------------------
@@ -151,6 +192,9 @@ namespace DartEmbed
 		private:
 
 			friend class VirtualMachine;
+			friend class IsolatePool;
+			friend class MessageLoop;
+			friend class Shards;
 
 			/// The isolate handle
 			Dart_Isolate _isolate;
@@ -158,6 +202,8 @@ namespace DartEmbed
 			Dart_Handle _library;
 			/// The parent of the isolate
 			Isolate* _parent;
+			/// The data associated with the isolate
+			EmbedIsolateData* _data;
 	} ;
 } // end namespace Dart
 
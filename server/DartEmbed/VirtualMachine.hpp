@@ -54,6 +54,70 @@ typedef void (*Dart_LibraryInitializer)(Dart_Handle library);
 
 namespace DartEmbed
 {
+	/**
+	 * Specifies when scripts are compiled ahead of their first use.
+	 */
+	namespace WarmUpMode
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// Functions are compiled lazily on their first call
+			Disabled,
+			/**
+			 * Each shard compiles its isolate on its own thread once main
+			 * returns, and pooled isolates are compiled on the refill thread.
+			 *
+			 * The shards start accepting connections immediately. Messages
+			 * arriving while a shard compiles wait until it finishes.
+			 */
+			Background,
+			/**
+			 * Pooled isolates are compiled on the refill thread and the
+			 * script loaded through Isolate::loadScript is compiled before
+			 * it is returned.
+			 *
+			 * Delays main, and accepting connections, until compilation
+			 * finishes so clients never see a compile stall.
+			 */
+			Startup,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace WarmUpMode
+
+	/**
+	 * Statistics for the isolates pooled for a script.
+	 */
+	struct IsolatePoolStatistics
+	{
+		/// Spawn requests served from the pool
+		std::uint64_t hits;
+		/// Spawn requests that found the pool empty
+		std::uint64_t misses;
+		/// Isolates that failed to be created
+		std::uint64_t failures;
+		/// Isolates ready to be claimed
+		std::size_t available;
+		/// The number of isolates the pool keeps ready
+		std::size_t size;
+	} ; // end struct IsolatePoolStatistics
+
+	/**
+	 * Native memory held by a running isolate.
+	 */
+	struct IsolateMemoryUsage
+	{
+		/// The isolate
+		Dart_Isolate isolate;
+		/// The shard the isolate serves
+		std::size_t shard;
+		/// The number of native objects backing Dart instances
+		std::size_t nativeObjects;
+		/// The size of the native objects in bytes
+		std::size_t nativeBytes;
+	} ; // end struct IsolateMemoryUsage
+
 	/**
 	 * Embedded Dart virtual machine.
 	 */
@@ -96,6 +160,105 @@ namespace DartEmbed
 			 */
 			static std::size_t getNumberOfIsolates();
 
+			/**
+			 * Queries the native memory held by each running isolate.
+			 *
+			 * Native objects are freed when their Dart instance is collected
+			 * or when the isolate shuts down.
+			 *
+			 * \param usage The array to populate.
+			 * \param count The number of elements in the array.
+			 * \returns The number of isolates currently running, which may exceed count.
+			 */
+			static std::size_t getIsolateMemoryUsage(IsolateMemoryUsage* usage, std::size_t count);
+
+			/**
+			 * Sets the number of isolates to keep ready for a script.
+			 *
+			 * When the script spawns an isolate a ready one is claimed rather
+			 * than creating and loading a new isolate. The pool is refilled on
+			 * a background thread.
+			 *
+			 * \param path The path to the script.
+			 * \param size The number of isolates to keep ready.
+			 */
+			static void setIsolatePoolSize(const char* path, std::size_t size);
+
+			/**
+			 * Queries the statistics for the isolates pooled for a script.
+			 *
+			 * \param path The path to the script.
+			 * \param statistics The structure to populate.
+			 * \returns true if the script has a pool; false otherwise.
+			 */
+			static bool getIsolatePoolStatistics(const char* path, IsolatePoolStatistics* statistics);
+
+			/**
+			 * Starts serving isolates of a script.
+			 *
+			 * Each shard loads the script into its own isolate and invokes main
+			 * on its own thread. With more than one shard each thread is pinned
+			 * to a processor. Scripts can query their shard through embed:shard
+			 * to pick a port and balance connections.
+			 *
+			 * \param path The path to the script.
+			 * \param count The number of shards; 0 to use one per processor.
+			 * \returns true if the shards were started; false otherwise.
+			 */
+			static bool startShards(const char* path, std::size_t count = 1);
+
+			/**
+			 * Stops the serving isolates and waits for their threads to finish.
+			 */
+			static void stopShards();
+
+			/**
+			 * Sets the file to write the startup report to.
+			 *
+			 * The report is written as JSON once the first function invoked
+			 * on an isolate returns. It contains the time spent in each phase
+			 * of startup in microseconds.
+			 *
+			 * \param path The path to write the report to.
+			 */
+			static void setStartupReportPath(const char* path);
+
+			/**
+			 * Writes the startup report as JSON.
+			 *
+			 * \param stream The stream to write to.
+			 */
+			static void writeStartupReport(FILE* stream);
+
+			/**
+			 * Sets when scripts are compiled ahead of their first use.
+			 *
+			 * Should be set before any isolates are created. The time spent
+			 * compiling is printed and added to the startup report.
+			 *
+			 * \param mode The warm-up mode.
+			 */
+			static void setWarmUpMode(WarmUpMode::Enum mode);
+
+			/**
+			 * Gets when scripts are compiled ahead of their first use.
+			 *
+			 * \returns The warm-up mode.
+			 */
+			static WarmUpMode::Enum getWarmUpMode();
+
+			/**
+			 * Sets the precision of timers created by scripts.
+			 *
+			 * Timers from every isolate are kept in one timer wheel. Timers
+			 * expiring within the same tick are handled by a single wakeup,
+			 * so a longer tick costs precision but saves wakeups. Should be
+			 * set before any isolates are created.
+			 *
+			 * \param milliseconds The length of a tick in milliseconds.
+			 */
+			static void setTimerResolution(std::uint32_t milliseconds);
+
 		private:
 
 			VirtualMachine() { }
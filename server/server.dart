@@ -29,96 +29,386 @@
 #import('dart:json');
 #import('dart:isolate');
 #import('embed:input');
+#import('embed:shard');
 
-String gamePadStateMessage(int index, GamePadState gamePad)
+/**
+ * A connection receiving game pad state every frame.
+ */
+class _Client
 {
-  return
-    """
+  _Client(WebSocketConnection this.connection)
+    : sentVersions = new List<int>(_feeds.length)
+    , heldVersions = new List<int>(_feeds.length);
+
+  WebSocketConnection connection;
+  /// Bitmask of the game pads the client receives
+  int pads = 1;
+  /// Whether the client asked for binary frames
+  bool binary = false;
+  /// The version of each feed last sent; null when the next must be a keyframe
+  List<int> sentVersions;
+  /// Frames since the last keyframe
+  int framesSinceKeyframe = 0;
+  /// The socket of the connection; -1 if it couldn't be found
+  int socket = -1;
+  /// Bytes sent that the client hasn't received yet
+  int queuedBytes = 0;
+  /// The version of each feed held back while the client was behind
+  List<int> heldVersions;
+  /// Versions replaced by a newer one before they could be sent
+  int dropped = 0;
+  /// Consecutive frames the client has been behind
+  int stalledFrames = 0;
+  /// Whether the client is being disconnected
+  bool closing = false;
+
+  /**
+   * Receives the given game pads from the next frame.
+   */
+  void subscribe(int value)
+  {
+    pads = value;
+    requestKeyframe();
+  }
+
+  /**
+   * Sends the full state on the next frame.
+   */
+  void requestKeyframe()
+  {
+    for (int i = 0; i < sentVersions.length; ++i)
+      sentVersions[i] = null;
+
+    framesSinceKeyframe = 0;
+  }
+
+  /**
+   * Sends the state of the subscribed game pads that changed since they
+   * were last sent.
+   *
+   * The feeds serialize each version once and every viewer is sent the
+   * same bytes. Binary clients that are one version behind receive only
+   * the changed fields. A keyframe is sent when the client connects,
+   * changes subscription and periodically so a client can't stay out of
+   * sync. The game pads that changed are sent together as one frame.
+   *
+   * Nothing is sent while the client has more than [_sendLimit] bytes
+   * it hasn't received. The newest version is held instead, replacing
+   * any held before it, and sent once the client catches up so it never
+   * works through stale input. Clients that stay behind are disconnected.
+   */
+  void sendState(List<GamePadFeed> feeds)
+  {
+    if (closing)
+      return;
+
+    if (socket != -1)
+      queuedBytes = Math.max(SendBacklog.unsentBytes(socket), 0);
+
+    if (queuedBytes > _sendLimit)
+    {
+      if (++stalledFrames > _stalledFrameLimit)
+        disconnect();
+      else
+        holdState(feeds);
+
+      return;
+    }
+
+    stalledFrames = 0;
+
+    if (++framesSinceKeyframe >= _keyframeInterval)
+      requestKeyframe();
+
+    _parts.clear();
+
+    for (int i = 0; i < feeds.length; ++i)
+    {
+      if ((pads & (1 << i)) == 0)
+        continue;
+
+      GamePadFeed feed = feeds[i];
+      int version = feed.version;
+      int sentVersion = sentVersions[i];
+
+      heldVersions[i] = null;
+
+      // Idle game pads send nothing
+      if (sentVersion == version)
+        continue;
+
+      if (binary && (sentVersion != null) && (sentVersion == version - 1))
+        _parts.add(feed.delta);
+      else
+        _parts.add(binary ? feed.keyframe : feed.json);
+
+      sentVersions[i] = version;
+    }
+
+    if (_parts.length == 1)
+      connection.send(_parts[0]);
+    else if (_parts.length > 1)
+      connection.send(binary ? GamePadFeed.combine(_parts) : '[${Strings.join(_parts, ',')}]');
+  }
+
+  /**
+   * Holds the newest version of each subscribed game pad back.
+   */
+  void holdState(List<GamePadFeed> feeds)
+  {
+    for (int i = 0; i < feeds.length; ++i)
+    {
+      if ((pads & (1 << i)) == 0)
+        continue;
+
+      int version = feeds[i].version;
+
+      if ((version != sentVersions[i]) && (version != heldVersions[i]))
+      {
+        if (heldVersions[i] != null)
+        {
+          ++dropped;
+          ++_dropped;
+        }
+
+        heldVersions[i] = version;
+      }
+    }
+  }
+
+  /**
+   * Disconnects a client that can't keep up.
+   */
+  void disconnect()
+  {
+    print('Disconnecting client with $queuedBytes bytes queued');
+
+    closing = true;
+    ++_slowDisconnects;
+    connection.close(1008, 'Client too slow');
+  }
+}
+
+/// Frames between keyframes
+int _keyframeInterval;
+/// Bytes a client can have outstanding before its state is held back
+int _sendLimit = 8192;
+/// Seconds a client can stay behind before it is disconnected
+int _slowClientTimeout = 5;
+/// Frames a client can stay behind before it is disconnected
+int _stalledFrameLimit;
+
+/// Versions dropped across every connection
+int _dropped = 0;
+/// Connections closed for falling behind
+int _slowDisconnects = 0;
+/// The connection of the WebSocket being opened
+HttpConnectionInfo _openingConnection;
+/// Reads the control messages sent by clients
+ControlMessage _control;
+
+/// Connections receiving game pad state
+List<_Client> _clients;
+/// The serialized state of each game pad
+List<GamePadFeed> _feeds;
+/// The frames being sent to a client
+List _parts;
+
+void _removeClient(_Client client)
 {
-  "index": ${index},
-  "connected": ${gamePad.isConnected},
-  "leftThumbstick": {
-      "x": ${gamePad.leftThumbstickX},
-      "y": ${gamePad.leftThumbstickY}
-  },
-  "rightThumbstick": {
-      "x": ${gamePad.rightThumbstickX},
-      "y": ${gamePad.rightThumbstickY}
-  },
-  "leftTrigger": ${gamePad.leftTrigger},
-  "rightTrigger": ${gamePad.rightTrigger},
-  "buttons": ${gamePad.buttons}
-}      
-      """;
+  int index = _clients.indexOf(client);
+
+  if (index != -1)
+    _clients.removeRange(index, 1);
+}
+
+void _handleFrame(int frame)
+{
+  // Serialize each game pad once however many are watching
+  for (GamePadFeed feed in _feeds)
+    feed.update();
+
+  for (_Client client in _clients)
+    client.sendState(_feeds);
 }
 
 void _handleConnection(WebSocketConnection connection)
 {
-  print('New connection');
+  print('New connection on shard ${Shard.index}');
   bool connected = true;
-  GamePadState gamePad = new GamePadState();
-  int playerIndex = 0;
+  Shard.connectionOpened();
+  _Client client = new _Client(connection);
+  _clients.add(client);
+
+  if (_openingConnection != null)
+  {
+    client.socket = SendBacklog.findSocket(
+        _openingConnection.remoteHost,
+        _openingConnection.remotePort,
+        _openingConnection.localPort);
+  }
 
   connection.onMessage = (message) {
-    // Parse the message
-    Map parsed = JSON.parse(message);
+    // Vibration is applied while the message is read
+    if (!_control.parse(message))
+      return;
 
-    // Get the standard values
-    String type = parsed['type'];
-    int index = parsed['index'];
+    int type = _control.type;
+    int index = _control.index;
+
+    if (type == ControlMessage.FORMAT)
+    {
+      // Clients that understand binary frames ask for them when they connect
+      client.binary = _control.isBinary;
+      client.requestKeyframe();
 
-    if (type == 'index')
+      print('Format ${client.binary ? 'binary' : 'json'}');
+    }
+    else if (type == ControlMessage.INDEX)
     {
       // Start sending this game pad data
-      playerIndex = index;
+      if (index < _feeds.length)
+        client.subscribe(1 << index);
 
       print('Request $index');
     }
-    else if (type == 'vibration')
+    else if (type == ControlMessage.SUBSCRIBE)
     {
-      double leftMotor = parsed['leftMotor'];
-      double rightMotor = parsed['rightMotor'];
+      // Send several game pads on the one connection
+      client.subscribe(_control.pads & ((1 << _feeds.length) - 1));
 
-      print('Vibration $index: left $leftMotor right $rightMotor');
-      GamePad.setVibration(index, leftMotor, rightMotor);
+      print('Subscribe ${client.pads}');
+    }
+    else if (type == ControlMessage.PING)
+    {
+      // Echo the time so the client can measure the round trip
+      connection.send('{"type":"pong","time":${_control.time}}');
     }
   };
 
   connection.onClosed = (int status, String reason) {
     print('Closed with $status for $reason');
+
+    if (connected)
+    {
+      Shard.connectionClosed();
+      _removeClient(client);
+    }
+
     connected = false;
   };
 
   connection.onError = (e) {
     print('Error was $e');
-    connected = false;
-  };
 
-  // Emulate a 60fps application
-  Timer timer = new Timer.repeating(16, (e) {
     if (connected)
     {
-      GamePad.getState(playerIndex, gamePad);
-      connection.send(gamePadStateMessage(playerIndex, gamePad));
+      Shard.connectionClosed();
+      _removeClient(client);
     }
-    else
-    {
-      e.cancel();
-    }
-  });
+
+    connected = false;
+  };
+}
+
+void _handleShardRequest(HttpRequest request, HttpResponse response, int port)
+{
+  // Direct the client to the shard with the fewest connections
+  int selected = port + Shard.select();
+
+  response.headers.set('Access-Control-Allow-Origin', '*');
+  response.outputStream.writeString('${selected}');
+  response.outputStream.close();
+}
+
+void _handleStatsRequest(HttpRequest request, HttpResponse response)
+{
+  List clients = new List();
+
+  for (_Client client in _clients)
+  {
+    clients.add({
+      'pads': client.pads,
+      'queuedBytes': client.queuedBytes,
+      'dropped': client.dropped
+    });
+  }
+
+  Map stats = {
+    'shard': Shard.index,
+    'dropped': _dropped,
+    'slowDisconnects': _slowDisconnects,
+    'clients': clients
+  };
+
+  response.headers.set('Access-Control-Allow-Origin', '*');
+  response.outputStream.writeString(JSON.stringify(stats));
+  response.outputStream.close();
 }
 
 void _startServer(String host, int port)
 {
+  // Each shard listens on its own port
+  int shardPort = port + Shard.index;
+
   // Create the websockets server
   HttpServer server = new HttpServer();
   WebSocketHandler wsHandler = new WebSocketHandler();
-  server.addRequestHandler((req) => req.path == '/ws', wsHandler.onRequest);
+  server.addRequestHandler((req) => req.path == '/stats', _handleStatsRequest);
+
+  // The connection opens while the upgrade is handled so remember whose
+  // it is to find its socket
+  server.addRequestHandler((req) => req.path == '/ws', (req, res) {
+    _openingConnection = req.connectionInfo;
+    wsHandler.onRequest(req, res);
+    _openingConnection = null;
+  });
+
+  // The first shard hands out the ports of the others
+  if (Shard.index == 0)
+  {
+    server.addRequestHandler((req) => req.path == '/shard', (req, res) {
+      _handleShardRequest(req, res, port);
+    });
+  }
 
   wsHandler.onOpen = _handleConnection;
 
-  print('Starting server ${host}:${port}');
-  server.listen(host, port);
+  // Send every connection its game pad state on one shared tick
+  _clients = new List<_Client>();
+  _feeds = new List<GamePadFeed>();
+  _control = new ControlMessage();
+  _parts = new List();
+
+  for (int i = 0; i < 4; ++i)
+    _feeds.add(new GamePadFeed(i));
+
+  // Resend the full state once a second
+  _keyframeInterval = FrameClock.framesPerSecond;
+  _stalledFrameLimit = _slowClientTimeout * FrameClock.framesPerSecond;
+
+  new FrameClock(_handleFrame);
+
+  // Another process took over the port so stop accepting and let the
+  // clients reconnect a few at a time rather than all at once
+  Shard.onDrain((int milliseconds) {
+    server.close();
+
+    List<_Client> draining = new List<_Client>.from(_clients);
+    int interval = milliseconds ~/ (draining.length + 1);
+
+    for (int i = 0; i < draining.length; ++i)
+    {
+      WebSocketConnection connection = draining[i].connection;
+
+      new Timer((i + 1) * interval, (timer) {
+        connection.close(1001, 'Server restarting');
+      });
+    }
+  });
+
+  print('Starting shard ${Shard.index} of ${Shard.count} on ${host}:${shardPort}');
+  server.listen(host, shardPort);
 }
 
 void main()
@@ -138,6 +428,12 @@ void main()
       Map config = JSON.parse(result.value);
       host = config['host'];
       port = config['port'];
+
+      if (config.containsKey('sendLimit'))
+        _sendLimit = config['sendLimit'];
+
+      if (config.containsKey('slowClientTimeout'))
+        _slowClientTimeout = config['slowClientTimeout'];
     }
     else
     {
@@ -0,0 +1,276 @@
+/**
+ * \file AsyncLibrary.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "EmbedLibraries.hpp"
+#include <DartEmbed/VirtualMachine.hpp>
+#include <map>
+#include "AsyncNative.hpp"
+#include "Thread.hpp"
+#include "WorkerPool.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	//---------------------------------------------------------------------
+	// Source code
+	//---------------------------------------------------------------------
+
+	const char* __sourceCode =
+		"#library('embed:async');\n"
+		"#import('dart:isolate');\n"
+		"\n"
+		"class NativeException implements Exception\n"
+		"{\n"
+		"  const NativeException(String this.message);\n"
+		"  String toString() => 'NativeException: $message';\n"
+		"  final String message;\n"
+		"}\n"
+		"\n"
+		"class AsyncNative\n"
+		"{\n"
+		"  AsyncNative(SendPort this._port);\n"
+		"\n"
+		"  Future call(arguments)\n"
+		"  {\n"
+		"    Completer completer = new Completer();\n"
+		"\n"
+		"    _port.call(arguments).then((reply) {\n"
+		"      if (reply[0])\n"
+		"        completer.complete(reply[1]);\n"
+		"      else\n"
+		"        completer.completeException(new NativeException(reply[1]));\n"
+		"    });\n"
+		"\n"
+		"    return completer.future;\n"
+		"  }\n"
+		"\n"
+		"  final SendPort _port;\n"
+		"}\n";
+
+	//---------------------------------------------------------------------
+	// Ports
+	//---------------------------------------------------------------------
+
+	/// Guards the handlers
+	Mutex __mutex;
+	/// The handler for each port
+	std::map<Dart_Port, AsyncHandler> __handlers;
+	/// The workers running submitted work
+	WorkerPool* __workers = 0;
+
+	/**
+	 * Dispatches a request to the handler of its port.
+	 *
+	 * \param destinationPort The port the request was posted to.
+	 * \param replyPort The port to reply to.
+	 * \param message The arguments of the request.
+	 */
+	void __handleRequest(Dart_Port destinationPort, Dart_Port replyPort, Dart_CObject* message)
+	{
+		if (replyPort == kIllegalPort)
+			return;
+
+		AsyncHandler handler = 0;
+
+		{
+			ScopedLock lock(__mutex);
+
+			std::map<Dart_Port, AsyncHandler>::iterator found = __handlers.find(destinationPort);
+
+			if (found != __handlers.end())
+				handler = found->second;
+		}
+
+		AsyncCompletion completion(replyPort);
+
+		if (handler)
+			handler(message, completion);
+		else
+			completion.completeWithError("Port is closed");
+	}
+
+	/**
+	 * Frees bytes once Dart no longer references them.
+	 *
+	 * \param peer The bytes.
+	 */
+	void __deleteBytes(void* peer)
+	{
+		delete static_cast<std::vector<std::uint8_t>*>(peer);
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+bool AsyncCompletion::complete(Dart_CObject* value) const
+{
+	Dart_CObject succeeded;
+	succeeded.type = Dart_CObject::kBool;
+	succeeded.value.as_bool = true;
+
+	Dart_CObject* values[2] = { &succeeded, value };
+
+	Dart_CObject reply;
+	reply.type = Dart_CObject::kArray;
+	reply.value.as_array.length = 2;
+	reply.value.as_array.values = values;
+
+	return Dart_PostCObject(_replyPort, &reply);
+}
+
+//---------------------------------------------------------------------
+
+bool AsyncCompletion::complete() const
+{
+	Dart_CObject value;
+	value.type = Dart_CObject::kNull;
+
+	return complete(&value);
+}
+
+//---------------------------------------------------------------------
+
+bool AsyncCompletion::completeWithBoolean(bool value) const
+{
+	Dart_CObject boolean;
+	boolean.type = Dart_CObject::kBool;
+	boolean.value.as_bool = value;
+
+	return complete(&boolean);
+}
+
+//---------------------------------------------------------------------
+
+bool AsyncCompletion::completeWithBytes(std::vector<std::uint8_t>* bytes) const
+{
+	Dart_CObject value;
+
+	if (bytes->empty())
+	{
+		value.type = Dart_CObject::kUint8Array;
+		value.value.as_byte_array.length = 0;
+		value.value.as_byte_array.values = 0;
+
+		delete bytes;
+
+		return complete(&value);
+	}
+
+	// Hand the bytes to Dart without copying them
+	value.type = Dart_CObject::kExternalUint8Array;
+	value.value.as_external_byte_array.length = static_cast<int>(bytes->size());
+	value.value.as_external_byte_array.data = &(*bytes)[0];
+	value.value.as_external_byte_array.peer = bytes;
+	value.value.as_external_byte_array.callback = __deleteBytes;
+
+	if (complete(&value))
+		return true;
+
+	delete bytes;
+
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+bool AsyncCompletion::completeWithError(const char* message) const
+{
+	Dart_CObject failed;
+	failed.type = Dart_CObject::kBool;
+	failed.value.as_bool = false;
+
+	Dart_CObject error;
+	error.type = Dart_CObject::kString;
+	error.value.as_string = const_cast<char*>(message);
+
+	Dart_CObject* values[2] = { &failed, &error };
+
+	Dart_CObject reply;
+	reply.type = Dart_CObject::kArray;
+	reply.value.as_array.length = 2;
+	reply.value.as_array.values = values;
+
+	return Dart_PostCObject(_replyPort, &reply);
+}
+
+//---------------------------------------------------------------------
+
+Dart_Port AsyncNatives::createPort(const char* name, AsyncHandler handler)
+{
+	ScopedLock lock(__mutex);
+
+	Dart_Port port = Dart_NewNativePort(name, __handleRequest, true);
+
+	if (port != kIllegalPort)
+		__handlers[port] = handler;
+
+	return port;
+}
+
+//---------------------------------------------------------------------
+
+void AsyncNatives::closePort(Dart_Port port)
+{
+	ScopedLock lock(__mutex);
+
+	if (__handlers.erase(port) > 0)
+		Dart_CloseNativePort(port);
+}
+
+//---------------------------------------------------------------------
+
+bool AsyncNatives::submit(Work work, void* argument)
+{
+	if (!__workers)
+		return false;
+
+	__workers->submit(work, argument);
+
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::createAsyncLibrary(std::size_t workers)
+{
+	if (!__workers)
+		__workers = new WorkerPool((workers) ? workers : Thread::getNumberOfProcessors(), ThreadRole::Jobs);
+
+	VirtualMachine::loadScriptLibrary("embed:async", __sourceCode);
+}
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::terminateAsyncLibrary()
+{
+	delete __workers;
+	__workers = 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * \file AsyncNative.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_ASYNC_NATIVE_HPP_INCLUDED
+#define DART_EMBED_ASYNC_NATIVE_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include "dart_api.h"
+
+namespace DartEmbed
+{
+	/**
+	 * Completes the Future returned to Dart by an asynchronous native.
+	 *
+	 * Replies are posted to the port the request came from as a list of
+	 * whether it succeeded and either the value or an error message. The
+	 * AsyncNative class in embed:async turns the reply into the Future's
+	 * value or a NativeException.
+	 *
+	 * Only holds the reply port so it can be copied onto whichever thread
+	 * finishes the work. Exactly one complete call should be made.
+	 */
+	class AsyncCompletion
+	{
+		public:
+
+			/**
+			 * Creates an instance of the AsyncCompletion class.
+			 *
+			 * \param replyPort The port to reply to.
+			 */
+			explicit AsyncCompletion(Dart_Port replyPort = kIllegalPort)
+				: _replyPort(replyPort)
+			{ }
+
+			/**
+			 * Completes with a value.
+			 *
+			 * \param value The value to complete with.
+			 * \returns true if the reply was posted; false otherwise.
+			 */
+			bool complete(Dart_CObject* value) const;
+
+			/**
+			 * Completes with null.
+			 *
+			 * \returns true if the reply was posted; false otherwise.
+			 */
+			bool complete() const;
+
+			/**
+			 * Completes with a boolean.
+			 *
+			 * \param value The value to complete with.
+			 * \returns true if the reply was posted; false otherwise.
+			 */
+			bool completeWithBoolean(bool value) const;
+
+			/**
+			 * Completes with bytes without copying them.
+			 *
+			 * Takes ownership of the bytes, which are freed once Dart no
+			 * longer references them.
+			 *
+			 * \param bytes The bytes to complete with.
+			 * \returns true if the reply was posted; false otherwise.
+			 */
+			bool completeWithBytes(std::vector<std::uint8_t>* bytes) const;
+
+			/**
+			 * Completes with an error.
+			 *
+			 * \param message The error message.
+			 * \returns true if the reply was posted; false otherwise.
+			 */
+			bool completeWithError(const char* message) const;
+
+		private:
+
+			/// The port to reply to
+			Dart_Port _replyPort;
+	} ; // end class AsyncCompletion
+
+	/**
+	 * Handles a request to an asynchronous native.
+	 *
+	 * Runs on a thread of the virtual machine rather than the isolate, so
+	 * the isolate keeps running. Handlers that block should hand the work
+	 * to AsyncNatives::submit so other requests aren't held up.
+	 *
+	 * \param arguments The arguments passed from Dart.
+	 * \param completion Completes the Future returned to Dart.
+	 */
+	typedef void (*AsyncHandler)(Dart_CObject* arguments, const AsyncCompletion& completion);
+
+	/**
+	 * Helpers for writing natives that return a Future to Dart.
+	 *
+	 * A library exposes a native returning the SendPort of a port created
+	 * with createPort and wraps it in an AsyncNative on the Dart side:
+	 *
+	 *   static Future run(a, b) => _native.call([a, b]);
+	 *   static final AsyncNative _native = new AsyncNative(_newPort());
+	 *
+	 * The handler for the port then completes the Future, directly or from
+	 * a worker thread.
+	 */
+	namespace AsyncNatives
+	{
+		/// Work run on a worker thread
+		typedef void (*Work)(void* argument);
+
+		/**
+		 * Creates a port that calls a handler for each request.
+		 *
+		 * \param name The name of the port, used when debugging.
+		 * \param handler The handler to call.
+		 * \returns The port or kIllegalPort if it couldn't be created.
+		 */
+		Dart_Port createPort(const char* name, AsyncHandler handler);
+
+		/**
+		 * Closes a port created with createPort.
+		 *
+		 * \param port The port to close.
+		 */
+		void closePort(Dart_Port port);
+
+		/**
+		 * Runs work on the worker threads.
+		 *
+		 * \param work The work to run.
+		 * \param argument The argument to pass to the work.
+		 * \returns false if the workers aren't running; true otherwise.
+		 */
+		bool submit(Work work, void* argument);
+	} // end namespace AsyncNatives
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_ASYNC_NATIVE_HPP_INCLUDED
@@ -32,6 +32,8 @@
 #ifndef DART_EMBED_BUILTIN_LIBRARIES_HPP_INCLUDED
 #define DART_EMBED_BUILTIN_LIBRARIES_HPP_INCLUDED
 
+#include <cstdint>
+
 //---------------------------------------------------------------------
 // Defines taken from builtin.h
 //
@@ -69,6 +71,22 @@ namespace DartEmbed
 		 */
 		ScriptLibrary* createIOLibrary();
 
+		/**
+		 * Sets the length of a tick of the timer wheel behind dart:io timers.
+		 *
+		 * Timers expiring within the same tick are handled together, so a
+		 * longer tick trades precision for fewer wakeups. Timers never fire
+		 * early. Has no effect once a timer has been scheduled.
+		 *
+		 * \param milliseconds The length of a tick in milliseconds.
+		 */
+		void setTimerResolution(std::uint32_t milliseconds);
+
+		/**
+		 * Stops the timer wheel behind dart:io timers.
+		 */
+		void terminateIOLibrary();
+
 		/**
 		 * Creates the dart:json library.
 		 *
@@ -0,0 +1,117 @@
+/**
+ * \file Clock.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Clock.hpp"
+
+#ifdef _WIN32
+#include "PlatformWindows.hpp"
+#else
+#include <ctime>
+#endif
+
+using namespace DartEmbed;
+
+#ifdef _WIN32
+
+namespace
+{
+	/**
+	 * Queries the frequency of the performance counter.
+	 *
+	 * \returns The number of counts per second.
+	 */
+	std::uint64_t __getFrequency()
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+
+		return frequency.QuadPart;
+	}
+
+	/// Counts per second of the performance counter
+	const std::uint64_t __frequency = __getFrequency();
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+std::uint64_t Clock::getMicroseconds()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	// Split the conversion to avoid overflowing
+	std::uint64_t count = counter.QuadPart;
+	std::uint64_t seconds = count / __frequency;
+	std::uint64_t remainder = count % __frequency;
+
+	return (seconds * 1000000) + ((remainder * 1000000) / __frequency);
+}
+
+//----------------------------------------------------------------------
+
+std::int64_t Clock::getSystemMilliseconds()
+{
+	FILETIME fileTime;
+	GetSystemTimeAsFileTime(&fileTime);
+
+	ULARGE_INTEGER time;
+	time.LowPart  = fileTime.dwLowDateTime;
+	time.HighPart = fileTime.dwHighDateTime;
+
+	// File times count 100ns intervals since 1601
+	const std::int64_t epochOffset = 116444736000000000LL;
+
+	return (static_cast<std::int64_t>(time.QuadPart) - epochOffset) / 10000;
+}
+
+#else
+
+//----------------------------------------------------------------------
+
+std::uint64_t Clock::getMicroseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (static_cast<std::uint64_t>(now.tv_sec) * 1000000) + (now.tv_nsec / 1000);
+}
+
+//----------------------------------------------------------------------
+
+std::int64_t Clock::getSystemMilliseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	return (static_cast<std::int64_t>(now.tv_sec) * 1000) + (now.tv_nsec / 1000000);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * \file Clock.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_CLOCK_HPP_INCLUDED
+#define DART_EMBED_CLOCK_HPP_INCLUDED
+
+#include <cstdint>
+
+namespace DartEmbed
+{
+	/**
+	 * Access to the monotonic and system clocks.
+	 */
+	namespace Clock
+	{
+		/**
+		 * Gets the current time of the monotonic clock.
+		 *
+		 * The value is only meaningful when compared to other values
+		 * returned by this function.
+		 *
+		 * \returns The current time in microseconds.
+		 */
+		std::uint64_t getMicroseconds();
+
+		/**
+		 * Gets the current time of the system clock.
+		 *
+		 * Matches Date.now().millisecondsSinceEpoch in Dart.
+		 *
+		 * \returns The milliseconds since the Unix epoch.
+		 */
+		std::int64_t getSystemMilliseconds();
+	} // end namespace Clock
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_CLOCK_HPP_INCLUDED
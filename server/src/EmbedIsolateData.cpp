@@ -0,0 +1,88 @@
+/**
+ * \file EmbedIsolateData.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "EmbedIsolateData.hpp"
+using namespace DartEmbed;
+
+//----------------------------------------------------------------------
+
+EmbedIsolateData::~EmbedIsolateData()
+{
+	for (NativeObjectMap::iterator itr = _nativeObjects.begin(); itr != _nativeObjects.end(); ++itr)
+		itr->second.destructor(itr->first);
+}
+
+//----------------------------------------------------------------------
+
+void EmbedIsolateData::addNativeObject(void* object, std::size_t size, NativeObjectDestructor destructor)
+{
+	NativeObject value = { size, destructor };
+
+	ScopedLock lock(_mutex);
+
+	_nativeObjects[object] = value;
+	_nativeBytes += size;
+}
+
+//----------------------------------------------------------------------
+
+bool EmbedIsolateData::removeNativeObject(void* object)
+{
+	ScopedLock lock(_mutex);
+
+	NativeObjectMap::iterator found = _nativeObjects.find(object);
+
+	if (found == _nativeObjects.end())
+		return false;
+
+	_nativeBytes -= found->second.size;
+	_nativeObjects.erase(found);
+
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+std::size_t EmbedIsolateData::getNumberOfNativeObjects()
+{
+	ScopedLock lock(_mutex);
+
+	return _nativeObjects.size();
+}
+
+//----------------------------------------------------------------------
+
+std::size_t EmbedIsolateData::getNativeBytes()
+{
+	ScopedLock lock(_mutex);
+
+	return _nativeBytes;
+}
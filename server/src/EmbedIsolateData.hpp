@@ -0,0 +1,177 @@
+/**
+ * \file EmbedIsolateData.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_EMBED_ISOLATE_DATA_HPP_INCLUDED
+#define DART_EMBED_EMBED_ISOLATE_DATA_HPP_INCLUDED
+
+#include <cstddef>
+#include <map>
+#include "dart_api.h"
+#include "isolate_data.h"
+#include "StringMap.hpp"
+#include "Thread.hpp"
+
+namespace DartEmbed
+{
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class Isolate;
+	class ScriptLibrary;
+
+	/**
+	 * A URL that has been canonicalized within an isolate.
+	 */
+	struct CanonicalUrl
+	{
+		/// The library providing the URL or 0 if it is not registered
+		ScriptLibrary* library;
+		/// Whether the library has been loaded into the isolate
+		bool loaded;
+	} ; // end struct CanonicalUrl
+
+	/**
+	 * Frees a native object owned by an isolate.
+	 *
+	 * \param object The object to free.
+	 */
+	typedef void (*NativeObjectDestructor)(void* object);
+
+	/**
+	 * Data associated with every isolate created by the embedder.
+	 *
+	 * Derives from IsolateData as the builtin libraries expect to find their
+	 * event handler through Dart_CurrentIsolateData.
+	 */
+	class EmbedIsolateData : public IsolateData
+	{
+		public:
+
+			/**
+			 * Creates an instance of the EmbedIsolateData class.
+			 */
+			EmbedIsolateData()
+				: canonicalUrls(32)
+				, shard(0)
+				, isolate(0)
+				, _nativeBytes(0)
+			{ }
+
+			/**
+			 * Destroys the EmbedIsolateData.
+			 *
+			 * Frees any native objects the isolate still owns.
+			 */
+			~EmbedIsolateData();
+
+			/**
+			 * Takes ownership of a native object backing a Dart instance.
+			 *
+			 * The object is freed when the isolate shuts down unless it is
+			 * removed first, typically by its weak persistent handle finalizer.
+			 *
+			 * \param object The object to own.
+			 * \param size The size of the object in bytes.
+			 * \param destructor Function to free the object with.
+			 */
+			void addNativeObject(void* object, std::size_t size, NativeObjectDestructor destructor);
+
+			/**
+			 * Releases ownership of a native object.
+			 *
+			 * \param object The object to release.
+			 * \returns true if the object was owned by the isolate; false otherwise.
+			 */
+			bool removeNativeObject(void* object);
+
+			/**
+			 * Gets the number of native objects owned by the isolate.
+			 *
+			 * \returns The number of native objects.
+			 */
+			std::size_t getNumberOfNativeObjects();
+
+			/**
+			 * Gets the size of the native objects owned by the isolate.
+			 *
+			 * \returns The size of the native objects in bytes.
+			 */
+			std::size_t getNativeBytes();
+
+			/**
+			 * URLs the library tag handler has already canonicalized.
+			 *
+			 * Libraries are loaded into the isolate the first time their URL
+			 * is seen rather than when the isolate is created.
+			 */
+			StringMap<CanonicalUrl> canonicalUrls;
+
+			/**
+			 * The shard the isolate serves.
+			 *
+			 * Isolates spawned by a shard report shard 0.
+			 */
+			std::size_t shard;
+
+			/**
+			 * The Isolate the data belongs to.
+			 *
+			 * Freed along with the data when the isolate shuts down.
+			 */
+			Isolate* isolate;
+
+		private:
+
+			/**
+			 * A native object owned by the isolate.
+			 */
+			struct NativeObject
+			{
+				/// The size of the object in bytes
+				std::size_t size;
+				/// Function to free the object with
+				NativeObjectDestructor destructor;
+			} ; // end struct NativeObject
+
+			/// Native objects by address
+			typedef std::map<void*, NativeObject> NativeObjectMap;
+
+			/// Guards the native objects as they're queried from other threads
+			Mutex _mutex;
+			/// The native objects owned by the isolate
+			NativeObjectMap _nativeObjects;
+			/// The size of the native objects in bytes
+			std::size_t _nativeBytes;
+	} ; // end class EmbedIsolateData
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_EMBED_ISOLATE_DATA_HPP_INCLUDED
@@ -32,17 +32,98 @@
 #ifndef DART_EMBED_EMBED_LIBRARIES_HPP_INCLUDED
 #define DART_EMBED_EMEBD_LIBRARIES_HPP_INCLUDED
 
+#include <cstdint>
+#include <vector>
+
 namespace DartEmbed
 {
+	/**
+	 * A native function run as a job from embed:jobs.
+	 *
+	 * Runs on a worker thread so it must not touch the Dart API.
+	 *
+	 * \param input The payload posted with the job.
+	 * \param length The length of the payload.
+	 * \param output The bytes returned to Dart.
+	 * \returns true if the job succeeded; false otherwise.
+	 */
+	typedef bool (*JobKernel)(const std::uint8_t* input, std::size_t length, std::vector<std::uint8_t>* output);
+
 	/**
 	 * Creates the libraries embeded within the application.
 	 */
 	namespace EmbedLibraries
 	{
+		/// The fastest rate the frame clock can tick at
+		const std::uint32_t MaxFramesPerSecond = 1000;
+
+		/**
+		 * Loads the async library.
+		 *
+		 * Starts the workers asynchronous natives run on. Other libraries
+		 * import embed:async to return futures from natives, so it must be
+		 * loaded first.
+		 *
+		 * \param workers The number of worker threads; 0 to use one per processor.
+		 */
+		void createAsyncLibrary(std::size_t workers = 0);
+
+		/**
+		 * Waits for work queued by asynchronous natives to finish.
+		 *
+		 * Libraries using asynchronous natives should be terminated first.
+		 */
+		void terminateAsyncLibrary();
+
 		/**
 		 * Loads the input library.
+		 *
+		 * Scripts can create a FrameClock to receive one tick per frame,
+		 * shared by every isolate, rather than running a timer for each
+		 * connection.
+		 *
+		 * \param framesPerSecond The rate the frame clock ticks at, up to MaxFramesPerSecond.
+		 */
+		void createInputLibrary(std::uint32_t framesPerSecond = 60);
+
+		/**
+		 * Closes the frame clock and vibration services and stops the clock.
+		 */
+		void terminateInputLibrary();
+
+		/**
+		 * Loads the shard library.
+		 */
+		void createShardLibrary();
+
+		/**
+		 * Closes the drain service of the shard library.
+		 */
+		void terminateShardLibrary();
+
+		/**
+		 * Loads the jobs library.
+		 *
+		 * Scripts create a Job with the name of a kernel and run it with a
+		 * payload of bytes; the result comes back through a future. Jobs run
+		 * on the workers of the async library.
+		 */
+		void createJobsLibrary();
+
+		/**
+		 * Registers a kernel that scripts can run as a job.
+		 *
+		 * Kernels must be registered before any scripts run.
+		 *
+		 * \param name The name scripts use to find the kernel.
+		 * \param kernel The function to run.
+		 */
+		void registerJobKernel(const char* name, JobKernel kernel);
+
+		/**
+		 * Closes the jobs service.
 		 */
-		void createInputLibrary();
+		void terminateJobsLibrary();
 	} // end namespace EmbedLibraries
 } // end namespace DartEmbed
 
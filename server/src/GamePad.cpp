@@ -30,14 +30,12 @@
  */
 
 #include <DartEmbed/GamePad.hpp>
+
+#ifdef _WIN32
 #include "PlatformWindows.hpp"
-using namespace DartEmbed;
+#endif
 
-namespace
-{
-	/// The current state of the controllers
-	GamePadState __gamePadState[PlayerIndex::Size];
-} // end anonymous namespace
+using namespace DartEmbed;
 
 //----------------------------------------------------------------------
 
@@ -88,6 +86,14 @@ GamePadState& GamePadState::operator= (const GamePadState& copy)
 	return *this;
 }
 
+#ifdef _WIN32
+
+namespace
+{
+	/// The current state of the controllers
+	GamePadState __gamePadState[PlayerIndex::Size];
+} // end anonymous namespace
+
 //----------------------------------------------------------------------
 
 const GamePadState& GamePad::getState(PlayerIndex::Enum player)
@@ -169,3 +175,5 @@ void updateGamePads()
 		}
 	}
 }
+
+#endif
@@ -0,0 +1,494 @@
+/**
+ * \file GamePadLinux.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifdef __linux__
+
+#include <DartEmbed/GamePad.hpp>
+#include "PlatformLinux.hpp"
+#include "Thread.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/joystick.h>
+using namespace DartEmbed;
+
+namespace
+{
+	//---------------------------------------------------------------------
+	// Xbox 360 controller layout as reported by the xpad driver
+	//---------------------------------------------------------------------
+
+	namespace Axis
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			LeftThumbstickX,
+			LeftThumbstickY,
+			LeftTrigger,
+			RightThumbstickX,
+			RightThumbstickY,
+			RightTrigger,
+			DPadX,
+			DPadY,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace Axis
+
+	/// The XInput button flag for each joystick button
+	const std::int32_t __buttonFlags[] =
+	{
+		0x1000, // A
+		0x2000, // B
+		0x4000, // X
+		0x8000, // Y
+		0x0100, // Left shoulder
+		0x0200, // Right shoulder
+		0x0020, // Back
+		0x0010, // Start
+		0x0000, // Guide, which XInput doesn't report
+		0x0040, // Left thumb
+		0x0080  // Right thumb
+	};
+
+	/// The number of buttons with a flag
+	const std::size_t __buttonCount = sizeof(__buttonFlags) / sizeof(__buttonFlags[0]);
+
+	/// The XInput flags for the directional pad
+	const std::int32_t __dpadUp    = 0x0001;
+	const std::int32_t __dpadDown  = 0x0002;
+	const std::int32_t __dpadLeft  = 0x0004;
+	const std::int32_t __dpadRight = 0x0008;
+
+	/**
+	 * An opened game pad.
+	 */
+	struct Device
+	{
+		/// The file descriptor or -1 if not open
+		int descriptor;
+		/// The value of each axis
+		std::int16_t axes[Axis::Size];
+		/// The XInput flags of the pressed buttons
+		std::int32_t buttons;
+		/// The file descriptor of the event device used for rumble or -1 if unavailable
+		int feedback;
+		/// The identifier of the uploaded rumble effect or -1 if none was uploaded
+		std::int16_t effect;
+	} ; // end struct Device
+
+	/// The opened game pads
+	Device __devices[PlayerIndex::Size] =
+	{
+		{ -1, { 0 }, 0, -1, -1 }, { -1, { 0 }, 0, -1, -1 }, { -1, { 0 }, 0, -1, -1 }, { -1, { 0 }, 0, -1, -1 }
+	};
+	/// Guards the rumble state as vibration is set from the async workers
+	Mutex __feedbackMutex;
+	/// The current state of the controllers
+	GamePadState __gamePadState[PlayerIndex::Size];
+
+	/**
+	 * Converts a thumbstick axis to the range XInput reports.
+	 *
+	 * \param value The value of the axis.
+	 * \param invert Whether the axis points the opposite way to XInput.
+	 * \returns The value between -1 and 1.
+	 */
+	inline float __thumbstick(std::int16_t value, bool invert)
+	{
+		float normalized = static_cast<float>(value) / 32767.0f;
+
+		if (normalized < -1.0f)
+			normalized = -1.0f;
+
+		return (invert) ? -normalized : normalized;
+	}
+
+	/**
+	 * Converts a trigger axis, which rests at its minimum, to between 0 and 1.
+	 *
+	 * \param value The value of the axis.
+	 * \returns The value between 0 and 1.
+	 */
+	inline float __trigger(std::int16_t value)
+	{
+		return (static_cast<float>(value) + 32767.0f) / 65534.0f;
+	}
+
+	/**
+	 * Copies the state of a device to the game pad state.
+	 *
+	 * \param index The index of the game pad.
+	 */
+	void __updateState(std::size_t index)
+	{
+		const Device& device = __devices[index];
+		GamePadState& gamePad = __gamePadState[index];
+
+		gamePad.setConnected(true);
+		gamePad.setPacketNumber(gamePad.getPacketNumber() + 1);
+
+		gamePad.setLeftThumbstickX (__thumbstick(device.axes[Axis::LeftThumbstickX],  false));
+		gamePad.setLeftThumbstickY (__thumbstick(device.axes[Axis::LeftThumbstickY],  true));
+		gamePad.setRightThumbstickX(__thumbstick(device.axes[Axis::RightThumbstickX], false));
+		gamePad.setRightThumbstickY(__thumbstick(device.axes[Axis::RightThumbstickY], true));
+
+		gamePad.setLeftTrigger (__trigger(device.axes[Axis::LeftTrigger]));
+		gamePad.setRightTrigger(__trigger(device.axes[Axis::RightTrigger]));
+
+		std::int32_t buttons = device.buttons;
+
+		if (device.axes[Axis::DPadX] < 0)
+			buttons |= __dpadLeft;
+		else if (device.axes[Axis::DPadX] > 0)
+			buttons |= __dpadRight;
+
+		if (device.axes[Axis::DPadY] < 0)
+			buttons |= __dpadUp;
+		else if (device.axes[Axis::DPadY] > 0)
+			buttons |= __dpadDown;
+
+		gamePad.setButtons(buttons);
+	}
+
+	/**
+	 * Converts a motor speed to a rumble magnitude.
+	 *
+	 * \param speed The speed of the motor between 0 and 1.
+	 * \returns The magnitude of the rumble.
+	 */
+	inline std::uint16_t __magnitude(float speed)
+	{
+		if (!(speed > 0.0f))
+			return 0;
+
+		if (speed >= 1.0f)
+			return 0xffff;
+
+		return static_cast<std::uint16_t>(speed * 65535.0f);
+	}
+
+	/**
+	 * Opens the event device of a game pad for rumble.
+	 *
+	 * The joystick interface doesn't expose force feedback so the event
+	 * device belonging to the same controller is used instead.
+	 *
+	 * \param index The index of the game pad.
+	 * \returns The file descriptor or -1 if rumble is unavailable.
+	 */
+	int __openFeedback(std::size_t index)
+	{
+		char path[64];
+		sprintf(path, "/sys/class/input/js%u/device", static_cast<unsigned int>(index));
+
+		DIR* directory = opendir(path);
+
+		if (!directory)
+		{
+			printf("Vibration unavailable for player %u: unable to find its event device\n", static_cast<unsigned int>(index + 1));
+			return -1;
+		}
+
+		char eventPath[PATH_MAX] = { 0 };
+
+		while (dirent* entry = readdir(directory))
+		{
+			if (strncmp(entry->d_name, "event", 5) == 0)
+			{
+				snprintf(eventPath, sizeof(eventPath), "/dev/input/%s", entry->d_name);
+				break;
+			}
+		}
+
+		closedir(directory);
+
+		if (eventPath[0] == '\0')
+		{
+			printf("Vibration unavailable for player %u: unable to find its event device\n", static_cast<unsigned int>(index + 1));
+			return -1;
+		}
+
+		int descriptor = open(eventPath, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+		if (descriptor == -1)
+		{
+			printf("Vibration unavailable for player %u: unable to open %s: %s\n", static_cast<unsigned int>(index + 1), eventPath, strerror(errno));
+			return -1;
+		}
+
+		// Make sure the driver can rumble before claiming it can vibrate
+		const std::size_t bitsPerLong = sizeof(unsigned long) * 8;
+		unsigned long features[(FF_MAX / bitsPerLong) + 1] = { 0 };
+
+		if ((ioctl(descriptor, EVIOCGBIT(EV_FF, sizeof(features)), features) < 0) ||
+		    !(features[FF_RUMBLE / bitsPerLong] & (1UL << (FF_RUMBLE % bitsPerLong))))
+		{
+			printf("Vibration unavailable for player %u: %s doesn't support rumble\n", static_cast<unsigned int>(index + 1), eventPath);
+			close(descriptor);
+			return -1;
+		}
+
+		return descriptor;
+	}
+
+	/**
+	 * Closes the event device used for rumble.
+	 *
+	 * Closing the device also removes the effect uploaded through it.
+	 * Must be called with the feedback mutex held.
+	 *
+	 * \param device The game pad.
+	 */
+	void __closeFeedback(Device& device)
+	{
+		if (device.feedback != -1)
+			close(device.feedback);
+
+		device.feedback = -1;
+		device.effect = -1;
+	}
+
+	/**
+	 * Closes a game pad and zeroes its state.
+	 *
+	 * \param index The index of the game pad.
+	 */
+	void __closeDevice(std::size_t index)
+	{
+		Device& device = __devices[index];
+
+		if (device.descriptor != -1)
+			close(device.descriptor);
+
+		device.descriptor = -1;
+
+		{
+			ScopedLock lock(__feedbackMutex);
+
+			__closeFeedback(device);
+		}
+
+		__gamePadState[index] = GamePadState();
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+const GamePadState& GamePad::getState(PlayerIndex::Enum player)
+{
+	return __gamePadState[player];
+}
+
+//----------------------------------------------------------------------
+
+void GamePad::setVibration(PlayerIndex::Enum player, const float leftMotor, const float rightMotor)
+{
+	ScopedLock lock(__feedbackMutex);
+
+	Device& device = __devices[player];
+
+	if (device.feedback == -1)
+		return;
+
+	// The left motor is the low frequency one as with XInput
+	ff_effect effect;
+	memset(&effect, 0, sizeof(effect));
+
+	effect.type = FF_RUMBLE;
+	effect.id = device.effect;
+	effect.u.rumble.strong_magnitude = __magnitude(leftMotor);
+	effect.u.rumble.weak_magnitude = __magnitude(rightMotor);
+
+	// Keep rumbling until told otherwise
+	effect.replay.length = 0;
+
+	// Uploading with the same identifier updates the playing effect in place
+	if (ioctl(device.feedback, EVIOCSFF, &effect) < 0)
+	{
+		printf("Vibration failed for player %u: %s\n", static_cast<unsigned int>(player + 1), strerror(errno));
+		__closeFeedback(device);
+		return;
+	}
+
+	device.effect = effect.id;
+
+	input_event play;
+	memset(&play, 0, sizeof(play));
+
+	play.type = EV_FF;
+	play.code = static_cast<std::uint16_t>(effect.id);
+	play.value = ((effect.u.rumble.strong_magnitude != 0) || (effect.u.rumble.weak_magnitude != 0)) ? 1 : 0;
+
+	if (write(device.feedback, &play, sizeof(play)) != static_cast<ssize_t>(sizeof(play)))
+	{
+		printf("Vibration failed for player %u: %s\n", static_cast<unsigned int>(player + 1), strerror(errno));
+		__closeFeedback(device);
+	}
+}
+
+//----------------------------------------------------------------------
+
+void scanGamePads()
+{
+	for (std::size_t i = 0; i < PlayerIndex::Size; ++i)
+	{
+		Device& device = __devices[i];
+
+		if (device.descriptor != -1)
+			continue;
+
+		char path[32];
+		sprintf(path, "/dev/input/js%u", static_cast<unsigned int>(i));
+
+		int descriptor = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+		if (descriptor == -1)
+			continue;
+
+		device.descriptor = descriptor;
+		device.buttons = 0;
+
+		// Triggers rest at their minimum until the initial events arrive
+		for (std::size_t axis = 0; axis < Axis::Size; ++axis)
+			device.axes[axis] = 0;
+
+		device.axes[Axis::LeftTrigger]  = -32767;
+		device.axes[Axis::RightTrigger] = -32767;
+
+		int feedback = __openFeedback(i);
+
+		{
+			ScopedLock lock(__feedbackMutex);
+
+			device.feedback = feedback;
+			device.effect = -1;
+		}
+
+		__updateState(i);
+	}
+}
+
+//----------------------------------------------------------------------
+
+void readGamePad(std::size_t index)
+{
+	Device& device = __devices[index];
+
+	if (device.descriptor == -1)
+		return;
+
+	js_event events[32];
+	bool changed = false;
+
+	for (;;)
+	{
+		ssize_t bytes = read(device.descriptor, events, sizeof(events));
+
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			// Anything other than running out of events means it was unplugged
+			if (errno != EAGAIN)
+			{
+				__closeDevice(index);
+				return;
+			}
+
+			break;
+		}
+
+		if (bytes == 0)
+			break;
+
+		std::size_t count = static_cast<std::size_t>(bytes) / sizeof(js_event);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const js_event& event = events[i];
+			std::uint8_t type = event.type & ~JS_EVENT_INIT;
+
+			if ((type == JS_EVENT_AXIS) && (event.number < Axis::Size))
+			{
+				device.axes[event.number] = event.value;
+				changed = true;
+			}
+			else if ((type == JS_EVENT_BUTTON) && (event.number < __buttonCount))
+			{
+				if (event.value)
+					device.buttons |= __buttonFlags[event.number];
+				else
+					device.buttons &= ~__buttonFlags[event.number];
+
+				changed = true;
+			}
+		}
+	}
+
+	// Coalesce everything read into a single packet
+	if (changed)
+		__updateState(index);
+}
+
+//----------------------------------------------------------------------
+
+int getGamePadDescriptor(std::size_t index)
+{
+	return __devices[index].descriptor;
+}
+
+//----------------------------------------------------------------------
+
+bool canVibrateGamePad(std::size_t index)
+{
+	ScopedLock lock(__feedbackMutex);
+
+	return __devices[index].feedback != -1;
+}
+
+//----------------------------------------------------------------------
+
+void closeGamePads()
+{
+	for (std::size_t i = 0; i < PlayerIndex::Size; ++i)
+		__closeDevice(i);
+}
+
+#endif
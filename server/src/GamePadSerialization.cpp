@@ -0,0 +1,740 @@
+/**
+ * \file GamePadSerialization.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "GamePadSerialization.hpp"
+#include <DartEmbed/GamePad.hpp>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+using namespace DartEmbed;
+
+namespace
+{
+	/// Scale applied to axes before writing them
+	const std::int32_t __axisScale = 100000;
+	/// The number of decimal places in the scale
+	const std::int32_t __axisDecimals = 5;
+
+	/// Scale applied to thumbsticks in binary frames
+	const float __thumbstickScale = 32767.0f;
+	/// Scale applied to triggers in binary frames
+	const float __triggerScale = 255.0f;
+
+	/**
+	 * A field of a binary frame that can be sent in a delta.
+	 */
+	struct BinaryField
+	{
+		/// The offset of the field
+		std::size_t offset;
+		/// The size of the field
+		std::size_t size;
+	} ; // end struct BinaryField
+
+	/// The fields of a binary frame in the order of the delta mask
+	const BinaryField __binaryFields[] =
+	{
+		{  2, 2 }, // Buttons
+		{  4, 2 }, // Left thumbstick X
+		{  6, 2 }, // Left thumbstick Y
+		{  8, 2 }, // Right thumbstick X
+		{ 10, 2 }, // Right thumbstick Y
+		{ 12, 1 }, // Left trigger
+		{ 13, 1 }  // Right trigger
+	};
+
+	/// The number of fields that can be sent in a delta
+	const std::size_t __binaryFieldCount = sizeof(__binaryFields) / sizeof(BinaryField);
+	/// The offset of the flags in a binary frame
+	const std::size_t __flagsOffset = 1;
+	/// The offset of the packet number in a binary frame
+	const std::size_t __packetNumberOffset = 14;
+	/// The length of the header of a delta
+	const std::size_t __deltaHeaderLength = 5;
+
+	/**
+	 * Quantizes a value to the nearest step within a range.
+	 *
+	 * \param value The value to quantize.
+	 * \param scale The number of steps per unit.
+	 * \param minimum The smallest quantized value.
+	 * \param maximum The largest quantized value.
+	 * \returns The quantized value.
+	 */
+	inline std::int32_t __quantize(float value, float scale, std::int32_t minimum, std::int32_t maximum)
+	{
+		float scaled = value * scale + ((value < 0.0f) ? -0.5f : 0.5f);
+
+		if (scaled <= static_cast<float>(minimum))
+			return minimum;
+		else if (scaled >= static_cast<float>(maximum))
+			return maximum;
+		else
+			return static_cast<std::int32_t>(scaled);
+	}
+
+	/**
+	 * Writes a 16-bit value in little endian order.
+	 *
+	 * \param buffer The buffer to write to.
+	 * \param value The value to write.
+	 */
+	inline void __writeUint16(std::uint8_t* buffer, std::uint32_t value)
+	{
+		buffer[0] = static_cast<std::uint8_t>(value);
+		buffer[1] = static_cast<std::uint8_t>(value >> 8);
+	}
+
+	/**
+	 * Writes JSON into a fixed buffer.
+	 *
+	 * Running out of room is remembered rather than checked at every call.
+	 */
+	class JsonWriter
+	{
+		public:
+
+			JsonWriter(char* buffer, std::size_t size)
+				: _position(buffer)
+				, _end(buffer + size)
+				, _overflowed(false)
+			{ }
+
+			/**
+			 * Writes a string without escaping it.
+			 *
+			 * \param value The string to write.
+			 */
+			void writeRaw(const char* value)
+			{
+				std::size_t length = strlen(value);
+
+				if (!_reserve(length))
+					return;
+
+				memcpy(_position, value, length);
+				_position += length;
+			}
+
+			/**
+			 * Writes an integer.
+			 *
+			 * \param value The integer to write.
+			 */
+			void writeInteger(std::int64_t value)
+			{
+				char digits[20];
+				std::size_t count = 0;
+
+				std::uint64_t magnitude = (value < 0) ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+
+				do
+				{
+					digits[count++] = static_cast<char>('0' + (magnitude % 10));
+					magnitude /= 10;
+				}
+				while (magnitude > 0);
+
+				if (!_reserve(count + 1))
+					return;
+
+				if (value < 0)
+					*_position++ = '-';
+
+				while (count > 0)
+					*_position++ = digits[--count];
+			}
+
+			/**
+			 * Writes an axis as a fixed point number.
+			 *
+			 * \param value The value of the axis.
+			 */
+			void writeAxis(float value)
+			{
+				// Round to the nearest step rather than truncating
+				std::int64_t scaled = static_cast<std::int64_t>(value * __axisScale + ((value < 0.0f) ? -0.5f : 0.5f));
+
+				if (scaled < 0)
+				{
+					writeRaw("-");
+					scaled = -scaled;
+				}
+
+				writeInteger(scaled / __axisScale);
+
+				std::int32_t fraction = static_cast<std::int32_t>(scaled % __axisScale);
+
+				if (fraction == 0)
+					return;
+
+				char digits[__axisDecimals];
+				std::int32_t count = __axisDecimals;
+
+				for (std::int32_t i = __axisDecimals - 1; i >= 0; --i)
+				{
+					digits[i] = static_cast<char>('0' + (fraction % 10));
+					fraction /= 10;
+				}
+
+				// Drop the trailing zeros
+				while (digits[count - 1] == '0')
+					count--;
+
+				if (!_reserve(count + 1))
+					return;
+
+				*_position++ = '.';
+
+				memcpy(_position, digits, count);
+				_position += count;
+			}
+
+			/**
+			 * Queries the number of characters written.
+			 *
+			 * \param start The start of the buffer.
+			 * \returns The number of characters written or 0 if the buffer overflowed.
+			 */
+			std::size_t getLength(const char* start) const
+			{
+				return (_overflowed) ? 0 : static_cast<std::size_t>(_position - start);
+			}
+
+		private:
+
+			/**
+			 * Makes sure there is room to write.
+			 *
+			 * \param count The number of characters to write.
+			 * \returns true if there is room; false otherwise.
+			 */
+			bool _reserve(std::size_t count)
+			{
+				if (_overflowed || (static_cast<std::size_t>(_end - _position) < count))
+				{
+					_overflowed = true;
+					return false;
+				}
+
+				return true;
+			}
+
+			/// The next character to write
+			char* _position;
+			/// The end of the buffer
+			char* _end;
+			/// Whether the buffer ran out of room
+			bool _overflowed;
+	} ; // end class JsonWriter
+	/**
+	 * Checks whether a number is a whole number within a range.
+	 *
+	 * \param value The number to check.
+	 * \param maximum The largest value allowed.
+	 * \returns true if the number is whole and between 0 and the maximum; false otherwise.
+	 */
+	inline bool __isWholeNumber(double value, double maximum)
+	{
+		return (value >= 0.0) && (value <= maximum) && (static_cast<double>(static_cast<std::uint32_t>(value)) == value);
+	}
+
+	/**
+	 * Reads the members of a flat JSON object in place.
+	 *
+	 * Strings are handed out as pointers into the text, so escapes are
+	 * kept as is. None of the values a control message uses need them.
+	 */
+	class ControlReader
+	{
+		public:
+
+			/**
+			 * Creates an instance of the ControlReader class.
+			 *
+			 * \param text The text to read, null terminated.
+			 */
+			explicit ControlReader(const char* text)
+				: _position(text)
+				, _members(0)
+			{ }
+
+			/**
+			 * Reads the opening brace of the object.
+			 *
+			 * \returns true if the text starts with an object; false otherwise.
+			 */
+			bool readStart()
+			{
+				return _expect('{');
+			}
+
+			/**
+			 * Reads the name of the next member.
+			 *
+			 * \param name The start of the name.
+			 * \param length The length of the name.
+			 * \param end Set if the object has no more members.
+			 * \returns true if a name or the end was read; false otherwise.
+			 */
+			bool readName(const char** name, std::size_t* length, bool* end)
+			{
+				_skipSpace();
+
+				if (*_position == '}')
+				{
+					++_position;
+					*end = true;
+
+					_skipSpace();
+					return *_position == '\0';
+				}
+
+				*end = false;
+
+				// Members after the first are separated by commas
+				if (_members++ > 0)
+				{
+					if (!_expect(','))
+						return false;
+				}
+
+				return readString(name, length) && _expect(':');
+			}
+
+			/**
+			 * Reads a string value.
+			 *
+			 * \param value The start of the string.
+			 * \param length The length of the string.
+			 * \returns true if a string was read; false otherwise.
+			 */
+			bool readString(const char** value, std::size_t* length)
+			{
+				if (!_expect('"'))
+					return false;
+
+				const char* start = _position;
+
+				while (*_position != '"')
+				{
+					if (*_position == '\0')
+						return false;
+					else if ((*_position == '\\') && (*(++_position) == '\0'))
+						return false;
+
+					++_position;
+				}
+
+				*value = start;
+				*length = static_cast<std::size_t>(_position - start);
+				++_position;
+
+				return true;
+			}
+
+			/**
+			 * Reads a number value.
+			 *
+			 * Only finite numbers written as JSON allows are accepted, so
+			 * the nan, inf and hexadecimal forms strtod knows are rejected.
+			 *
+			 * \param value The number read.
+			 * \returns true if a number was read; false otherwise.
+			 */
+			bool readNumber(double* value)
+			{
+				_skipSpace();
+
+				char* end = 0;
+				*value = strtod(_position, &end);
+
+				if ((end == _position) || (strspn(_position, "0123456789+-.eE") != static_cast<std::size_t>(end - _position)))
+					return false;
+
+				// Out of range values come back as infinity
+				if (!((*value >= -DBL_MAX) && (*value <= DBL_MAX)))
+					return false;
+
+				_position = end;
+
+				return true;
+			}
+
+			/**
+			 * Reads a set of indices given as a bitmask or an array.
+			 *
+			 * \param mask The bitmask of the indices.
+			 * \returns true if a bitmask or an array of indices was read; false otherwise.
+			 */
+			bool readIndexSet(std::uint32_t* mask)
+			{
+				double number;
+
+				_skipSpace();
+
+				if (*_position != '[')
+				{
+					if (!readNumber(&number) || !__isWholeNumber(number, 4294967295.0))
+						return false;
+
+					*mask = static_cast<std::uint32_t>(number);
+					return true;
+				}
+
+				++_position;
+				*mask = 0;
+
+				_skipSpace();
+
+				if (*_position == ']')
+				{
+					++_position;
+					return true;
+				}
+
+				do
+				{
+					if (!readNumber(&number) || !__isWholeNumber(number, 31.0))
+						return false;
+
+					*mask |= 1u << static_cast<std::uint32_t>(number);
+				}
+				while (_expect(','));
+
+				return _expect(']');
+			}
+
+			/**
+			 * Skips a value that isn't used.
+			 *
+			 * \returns true if a string, number or literal was skipped; false otherwise.
+			 */
+			bool skipValue()
+			{
+				_skipSpace();
+
+				const char* value;
+				std::size_t length;
+				double number;
+
+				if (*_position == '"')
+					return readString(&value, &length);
+				else if (strncmp(_position, "true", 4) == 0)
+					_position += 4;
+				else if (strncmp(_position, "false", 5) == 0)
+					_position += 5;
+				else if (strncmp(_position, "null", 4) == 0)
+					_position += 4;
+				else
+					return readNumber(&number);
+
+				return true;
+			}
+
+		private:
+
+			/**
+			 * Skips any whitespace.
+			 */
+			void _skipSpace()
+			{
+				while ((*_position == ' ') || (*_position == '\t') || (*_position == '\n') || (*_position == '\r'))
+					++_position;
+			}
+
+			/**
+			 * Reads a character.
+			 *
+			 * \param value The character expected.
+			 * \returns true if the character was next; false otherwise.
+			 */
+			bool _expect(char value)
+			{
+				_skipSpace();
+
+				if (*_position != value)
+					return false;
+
+				++_position;
+
+				return true;
+			}
+
+			/// The position in the text
+			const char* _position;
+			/// The number of members read
+			std::size_t _members;
+	} ; // end class ControlReader
+
+	/**
+	 * Checks whether a string read in place matches a literal.
+	 *
+	 * \param value The start of the string.
+	 * \param length The length of the string.
+	 * \param literal The literal to compare to.
+	 * \returns true if the string matches; false otherwise.
+	 */
+	inline bool __equals(const char* value, std::size_t length, const char* literal)
+	{
+		return (strlen(literal) == length) && (strncmp(value, literal, length) == 0);
+	}
+
+	/**
+	 * Clamps a motor speed between 0 and 1.
+	 *
+	 * \param value The speed read.
+	 * \returns The clamped speed.
+	 */
+	inline float __clampMotorSpeed(double value)
+	{
+		if (!(value > 0.0))
+			return 0.0f;
+		else if (value > 1.0)
+			return 1.0f;
+		else
+			return static_cast<float>(value);
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+std::size_t GamePadSerialization::writeJson(const GamePadState& state, std::int32_t index, char* buffer, std::size_t size)
+{
+	JsonWriter writer(buffer, size);
+
+	writer.writeRaw("{");
+
+	if (index >= 0)
+	{
+		writer.writeRaw("\"index\":");
+		writer.writeInteger(index);
+		writer.writeRaw(",");
+	}
+
+	writer.writeRaw((state.isConnected()) ? "\"connected\":true" : "\"connected\":false");
+
+	writer.writeRaw(",\"leftThumbstick\":{\"x\":");
+	writer.writeAxis(state.getLeftThumbstickX());
+	writer.writeRaw(",\"y\":");
+	writer.writeAxis(state.getLeftThumbstickY());
+
+	writer.writeRaw("},\"rightThumbstick\":{\"x\":");
+	writer.writeAxis(state.getRightThumbstickX());
+	writer.writeRaw(",\"y\":");
+	writer.writeAxis(state.getRightThumbstickY());
+
+	writer.writeRaw("},\"leftTrigger\":");
+	writer.writeAxis(state.getLeftTrigger());
+	writer.writeRaw(",\"rightTrigger\":");
+	writer.writeAxis(state.getRightTrigger());
+
+	writer.writeRaw(",\"buttons\":");
+	writer.writeInteger(state.getButtons());
+	writer.writeRaw("}");
+
+	return writer.getLength(buffer);
+}
+
+//----------------------------------------------------------------------
+
+void GamePadSerialization::writeBinary(const GamePadState& state, std::int32_t index, std::uint8_t* buffer)
+{
+	buffer[0] = static_cast<std::uint8_t>(index);
+	buffer[1] = (state.isConnected()) ? 1 : 0;
+
+	__writeUint16(buffer +  2, static_cast<std::uint32_t>(state.getButtons()));
+
+	__writeUint16(buffer +  4, static_cast<std::uint32_t>(__quantize(state.getLeftThumbstickX(),  __thumbstickScale, -32768, 32767)));
+	__writeUint16(buffer +  6, static_cast<std::uint32_t>(__quantize(state.getLeftThumbstickY(),  __thumbstickScale, -32768, 32767)));
+	__writeUint16(buffer +  8, static_cast<std::uint32_t>(__quantize(state.getRightThumbstickX(), __thumbstickScale, -32768, 32767)));
+	__writeUint16(buffer + 10, static_cast<std::uint32_t>(__quantize(state.getRightThumbstickY(), __thumbstickScale, -32768, 32767)));
+
+	buffer[12] = static_cast<std::uint8_t>(__quantize(state.getLeftTrigger(),  __triggerScale, 0, 255));
+	buffer[13] = static_cast<std::uint8_t>(__quantize(state.getRightTrigger(), __triggerScale, 0, 255));
+
+	__writeUint16(buffer + 14, static_cast<std::uint32_t>(state.getPacketNumber()));
+}
+
+//----------------------------------------------------------------------
+
+std::size_t GamePadSerialization::writeDelta(const std::uint8_t* previous, const std::uint8_t* current, std::uint8_t* buffer)
+{
+	std::uint8_t mask = 0;
+	std::size_t length = __deltaHeaderLength;
+
+	for (std::size_t i = 0; i < __binaryFieldCount; ++i)
+	{
+		const BinaryField& field = __binaryFields[i];
+
+		if (memcmp(previous + field.offset, current + field.offset, field.size) != 0)
+		{
+			mask |= static_cast<std::uint8_t>(1 << i);
+
+			memcpy(buffer + length, current + field.offset, field.size);
+			length += field.size;
+		}
+	}
+
+	if ((mask == 0) && (previous[__flagsOffset] == current[__flagsOffset]))
+		return 0;
+
+	buffer[0] = current[0];
+	buffer[1] = current[__flagsOffset] | DeltaFlag;
+	buffer[2] = current[__packetNumberOffset];
+	buffer[3] = current[__packetNumberOffset + 1];
+	buffer[4] = mask;
+
+	return length;
+}
+
+//---------------------------------------------------------------------
+
+bool GamePadSerialization::readControl(const char* text, ControlMessage* message)
+{
+	message->type = ControlType::Unknown;
+	message->index = -1;
+	message->pads = 0;
+	message->binary = false;
+	message->leftMotor = 0.0f;
+	message->rightMotor = 0.0f;
+	message->time = 0.0;
+
+	ControlReader reader(text);
+
+	if (!reader.readStart())
+		return false;
+
+	bool hasPads = false;
+	bool hasTime = false;
+	bool hasLeftMotor = false;
+	bool hasRightMotor = false;
+
+	while (true)
+	{
+		const char* name;
+		std::size_t nameLength;
+		bool end;
+
+		if (!reader.readName(&name, &nameLength, &end))
+			return false;
+
+		if (end)
+			break;
+
+		const char* value;
+		std::size_t valueLength;
+		double number;
+
+		if (__equals(name, nameLength, "type"))
+		{
+			if (!reader.readString(&value, &valueLength))
+				return false;
+
+			if (__equals(value, valueLength, "format"))
+				message->type = ControlType::Format;
+			else if (__equals(value, valueLength, "index"))
+				message->type = ControlType::Index;
+			else if (__equals(value, valueLength, "vibration"))
+				message->type = ControlType::Vibration;
+			else if (__equals(value, valueLength, "subscribe"))
+				message->type = ControlType::Subscribe;
+			else if (__equals(value, valueLength, "ping"))
+				message->type = ControlType::Ping;
+		}
+		else if (__equals(name, nameLength, "format"))
+		{
+			if (!reader.readString(&value, &valueLength))
+				return false;
+
+			message->binary = __equals(value, valueLength, "binary");
+		}
+		else if (__equals(name, nameLength, "index"))
+		{
+			if (!reader.readNumber(&number) || (number < 0.0) || (number > 255.0))
+				return false;
+
+			message->index = static_cast<std::int32_t>(number);
+
+			if (message->index != number)
+				return false;
+		}
+		else if (__equals(name, nameLength, "pads"))
+		{
+			if (!reader.readIndexSet(&message->pads))
+				return false;
+
+			hasPads = true;
+		}
+		else if (__equals(name, nameLength, "time"))
+		{
+			if (!reader.readNumber(&message->time))
+				return false;
+
+			hasTime = true;
+		}
+		else if (__equals(name, nameLength, "leftMotor"))
+		{
+			if (!reader.readNumber(&number))
+				return false;
+
+			message->leftMotor = __clampMotorSpeed(number);
+			hasLeftMotor = true;
+		}
+		else if (__equals(name, nameLength, "rightMotor"))
+		{
+			if (!reader.readNumber(&number))
+				return false;
+
+			message->rightMotor = __clampMotorSpeed(number);
+			hasRightMotor = true;
+		}
+		else if (!reader.skipValue())
+		{
+			return false;
+		}
+	}
+
+	// Each type needs the members it acts on
+	switch (message->type)
+	{
+		case ControlType::Index:
+			return message->index != -1;
+		case ControlType::Vibration:
+			return (message->index != -1) && hasLeftMotor && hasRightMotor;
+		case ControlType::Subscribe:
+			return hasPads;
+		case ControlType::Ping:
+			return hasTime;
+		default:
+			return true;
+	}
+}
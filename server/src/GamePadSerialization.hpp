@@ -0,0 +1,181 @@
+/**
+ * \file GamePadSerialization.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_GAME_PAD_SERIALIZATION_HPP_INCLUDED
+#define DART_EMBED_GAME_PAD_SERIALIZATION_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DartEmbed
+{
+	class GamePadState;
+
+	/**
+	 * The type of a control message sent by a client.
+	 */
+	namespace ControlType
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// A message this server doesn't understand
+			Unknown,
+			/// Selects JSON or binary frames
+			Format,
+			/// Selects the game pad to receive
+			Index,
+			/// Sets the vibration of a game pad
+			Vibration,
+			/// Selects several game pads to receive
+			Subscribe,
+			/// Asks for the time to be echoed back
+			Ping,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace ControlType
+
+	/**
+	 * A control message sent by a client.
+	 */
+	struct ControlMessage
+	{
+		/// The type of the message
+		ControlType::Enum type;
+		/// The index of the game pad; -1 if not given
+		std::int32_t index;
+		/// Bitmask of the game pads subscribed to
+		std::uint32_t pads;
+		/// Whether binary frames were asked for
+		bool binary;
+		/// The speed of the left motor
+		float leftMotor;
+		/// The speed of the right motor
+		float rightMotor;
+		/// The time sent with a ping
+		double time;
+	} ; // end struct ControlMessage
+
+	/**
+	 * Reads and writes the messages exchanged with clients.
+	 */
+	namespace GamePadSerialization
+	{
+		/// Enough room for any state written as JSON
+		const std::size_t MaximumJsonLength = 256;
+		/// The length of a state written as binary
+		const std::size_t BinaryLength = 16;
+		/// Enough room for any delta between two binary states
+		const std::size_t MaximumDeltaLength = 19;
+		/// Set in the flags of a binary frame holding a delta
+		const std::uint8_t DeltaFlag = 1 << 1;
+		/// The longest control message read
+		const std::size_t MaximumControlLength = 256;
+
+		/**
+		 * Writes the state of a game pad as compact JSON.
+		 *
+		 * Axes and triggers are written with at most five decimal places,
+		 * which is enough to recover the 16-bit value read from the
+		 * controller, and trailing zeros are dropped.
+		 *
+		 * \param state The state to write.
+		 * \param index The index of the game pad or -1 to leave it out.
+		 * \param buffer The buffer to write to.
+		 * \param size The size of the buffer.
+		 * \returns The number of characters written or 0 if the buffer was too small.
+		 */
+		std::size_t writeJson(const GamePadState& state, std::int32_t index, char* buffer, std::size_t size);
+
+		/**
+		 * Writes the state of a game pad as a binary frame.
+		 *
+		 * Frames are BinaryLength bytes, little endian:
+		 *
+		 *   0     uint8  index of the game pad
+		 *   1     uint8  flags; bit 0 is set when connected
+		 *   2-3   uint16 buttons
+		 *   4-11  int16  left X, left Y, right X, right Y scaled by 32767
+		 *   12-13 uint8  left and right trigger scaled by 255
+		 *   14-15 uint16 low bits of the packet number
+		 *
+		 * \param state The state to write.
+		 * \param index The index of the game pad.
+		 * \param buffer The buffer to write to, at least BinaryLength bytes.
+		 */
+		void writeBinary(const GamePadState& state, std::int32_t index, std::uint8_t* buffer);
+
+		/**
+		 * Writes the fields that differ between two binary frames.
+		 *
+		 * Deltas are little endian:
+		 *
+		 *   0     uint8  index of the game pad
+		 *   1     uint8  flags; bit 0 is set when connected, bit 1 is DeltaFlag
+		 *   2-3   uint16 low bits of the packet number
+		 *   4     uint8  mask of the fields that follow; bit 0 is the
+		 *                buttons, bits 1-4 the thumbstick axes and bits 5-6
+		 *                the triggers
+		 *   5-    the changed fields, in mask order, as in a binary frame
+		 *
+		 * Only the packet number changing isn't worth sending, as the
+		 * values the client sees are the same.
+		 *
+		 * \param previous The binary frame the client last received.
+		 * \param current The binary frame of the current state.
+		 * \param buffer The buffer to write to, at least MaximumDeltaLength bytes.
+		 * \returns The length of the delta or 0 if nothing the client sees changed.
+		 */
+		std::size_t writeDelta(const std::uint8_t* previous, const std::uint8_t* current, std::uint8_t* buffer);
+
+		/**
+		 * Reads a control message sent by a client.
+		 *
+		 * Control messages are a flat JSON object such as
+		 *
+		 *   {"type":"vibration","index":0,"leftMotor":0.5,"rightMotor":1}
+		 *
+		 * The members are read in place rather than building a document.
+		 * Members other than type, index, format, pads, leftMotor,
+		 * rightMotor and time are skipped, and motor speeds are clamped between 0
+		 * and 1. The pads of a subscription are either a bitmask or an
+		 * array of indices, so {"pads":5} and {"pads":[0,2]} are the same.
+		 *
+		 * \param text The message, null terminated.
+		 * \param message The message read.
+		 * \returns true if the message was well formed and complete for its type; false otherwise.
+		 */
+		bool readControl(const char* text, ControlMessage* message);
+	} // end namespace GamePadSerialization
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_GAME_PAD_SERIALIZATION_HPP_INCLUDED
@@ -0,0 +1,585 @@
+/**
+ * \file Handover.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Handover.hpp"
+#include <cstdio>
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include "Clock.hpp"
+#include "PlatformLinux.hpp"
+#include "Shards.hpp"
+#include "Thread.hpp"
+#endif
+
+using namespace DartEmbed;
+
+#ifdef __linux__
+
+namespace
+{
+	/**
+	 * A socket listening on a port.
+	 */
+	struct Listener
+	{
+		/// The port listened on
+		std::int32_t port;
+		/// The listening socket
+		int socket;
+	} ; // end struct Listener
+
+	/// Sent after the last listener
+	const std::int32_t __endOfListeners = -1;
+	/// Sent by the new process once it is listening
+	const char __ready = 'R';
+	/// Time to wait on the previous process in seconds
+	const int __inheritTimeout = 5;
+
+	/// Guards the listeners
+	Mutex __mutex;
+	/// Signaled when an inherited socket is claimed
+	ConditionVariable __claimed;
+	/// The sockets this process listens on
+	std::vector<Listener> __listeners;
+	/// The inherited sockets that haven't been claimed
+	std::vector<Listener> __inherited;
+	/// The connection to the previous process
+	int __predecessor = -1;
+	/// The socket the listeners are offered on
+	int __offer = -1;
+	/// Time allowed to drain connections in milliseconds
+	std::uint32_t __drainTimeout = 0;
+	/// When draining ends in milliseconds; 0 if not draining
+	std::uint64_t __drainDeadline = 0;
+
+	/**
+	 * Gets the current time in milliseconds.
+	 *
+	 * \returns The current time in milliseconds.
+	 */
+	inline std::uint64_t __getMilliseconds()
+	{
+		return Clock::getMicroseconds() / 1000;
+	}
+
+	/**
+	 * Fills in the address of a Unix socket.
+	 *
+	 * \param path The path of the socket.
+	 * \param address The address to fill in.
+	 * \returns true if the path fits; false otherwise.
+	 */
+	bool __getAddress(const char* path, sockaddr_un* address)
+	{
+		memset(address, 0, sizeof(sockaddr_un));
+		address->sun_family = AF_UNIX;
+
+		if (strlen(path) >= sizeof(address->sun_path))
+		{
+			printf("Handover path is too long: %s\n", path);
+			return false;
+		}
+
+		strcpy(address->sun_path, path);
+
+		return true;
+	}
+
+	/**
+	 * Checks that a socket is still listening on a port.
+	 *
+	 * A server that was closed leaves its descriptor behind in the
+	 * listeners, and the number may since have been reused.
+	 *
+	 * \param listener The listener to check.
+	 * \returns true if the socket is listening on the port; false otherwise.
+	 */
+	bool __isListening(const Listener& listener)
+	{
+		int accepting = 0;
+		socklen_t length = sizeof(accepting);
+
+		if ((getsockopt(listener.socket, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &length) != 0) || !accepting)
+			return false;
+
+		sockaddr_storage address;
+		length = sizeof(address);
+
+		if (getsockname(listener.socket, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+			return false;
+
+		if (address.ss_family == AF_INET)
+			return ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port) == listener.port;
+		else if (address.ss_family == AF_INET6)
+			return ntohs(reinterpret_cast<sockaddr_in6*>(&address)->sin6_port) == listener.port;
+
+		return false;
+	}
+
+	/**
+	 * Sends a listener to the new process.
+	 *
+	 * The socket travels as SCM_RIGHTS alongside the port.
+	 *
+	 * \param connection The connection to the new process.
+	 * \param port The port listened on.
+	 * \param socket The listening socket or -1 to send only the port.
+	 * \returns true if the listener was sent; false otherwise.
+	 */
+	bool __sendListener(int connection, std::int32_t port, int socket)
+	{
+		iovec data;
+		data.iov_base = &port;
+		data.iov_len = sizeof(port);
+
+		msghdr header;
+		memset(&header, 0, sizeof(header));
+		header.msg_iov = &data;
+		header.msg_iovlen = 1;
+
+		char control[CMSG_SPACE(sizeof(int))];
+
+		if (socket != -1)
+		{
+			memset(control, 0, sizeof(control));
+			header.msg_control = control;
+			header.msg_controllen = sizeof(control);
+
+			cmsghdr* rights = CMSG_FIRSTHDR(&header);
+			rights->cmsg_level = SOL_SOCKET;
+			rights->cmsg_type = SCM_RIGHTS;
+			rights->cmsg_len = CMSG_LEN(sizeof(int));
+
+			memcpy(CMSG_DATA(rights), &socket, sizeof(int));
+		}
+
+		return sendmsg(connection, &header, MSG_NOSIGNAL) == sizeof(port);
+	}
+
+	/**
+	 * Receives a listener from the previous process.
+	 *
+	 * \param connection The connection to the previous process.
+	 * \param port The port listened on.
+	 * \param socket The listening socket or -1 if none was sent.
+	 * \returns true if a listener was received; false otherwise.
+	 */
+	bool __receiveListener(int connection, std::int32_t* port, int* socket)
+	{
+		iovec data;
+		data.iov_base = port;
+		data.iov_len = sizeof(std::int32_t);
+
+		char control[CMSG_SPACE(sizeof(int))];
+
+		msghdr header;
+		memset(&header, 0, sizeof(header));
+		header.msg_iov = &data;
+		header.msg_iovlen = 1;
+		header.msg_control = control;
+		header.msg_controllen = sizeof(control);
+
+		*socket = -1;
+
+		if (recvmsg(connection, &header, MSG_CMSG_CLOEXEC | MSG_WAITALL) != sizeof(std::int32_t))
+			return false;
+
+		cmsghdr* rights = CMSG_FIRSTHDR(&header);
+
+		if (rights && (rights->cmsg_level == SOL_SOCKET) && (rights->cmsg_type == SCM_RIGHTS))
+			memcpy(socket, CMSG_DATA(rights), sizeof(int));
+
+		return true;
+	}
+
+	/**
+	 * Closes the inherited sockets that weren't claimed.
+	 */
+	void __closeInherited()
+	{
+		std::size_t count = __inherited.size();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			printf("No shard listened on inherited port %d\n", __inherited[i].port);
+			close(__inherited[i].socket);
+		}
+
+		__inherited.clear();
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+bool Handover::inherit(const char* path)
+{
+	sockaddr_un address;
+
+	if (!__getAddress(path, &address))
+		return false;
+
+	int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (connection == -1)
+		return false;
+
+	// Nothing listening means there is no process to take over from
+	if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		close(connection);
+		return false;
+	}
+
+	timeval timeout;
+	timeout.tv_sec = __inheritTimeout;
+	timeout.tv_usec = 0;
+
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	ScopedLock lock(__mutex);
+
+	for (;;)
+	{
+		Listener listener;
+
+		if (!__receiveListener(connection, &listener.port, &listener.socket))
+		{
+			printf("Handover from %s failed: %s\n", path, strerror(errno));
+
+			__closeInherited();
+			close(connection);
+
+			return false;
+		}
+
+		if (listener.port == __endOfListeners)
+			break;
+
+		if (listener.socket != -1)
+			__inherited.push_back(listener);
+	}
+
+	printf("Inherited %u listening sockets from %s\n", static_cast<unsigned int>(__inherited.size()), path);
+
+	__predecessor = connection;
+
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+bool Handover::claimListener(std::int64_t port, std::intptr_t* socket)
+{
+	ScopedLock lock(__mutex);
+
+	std::size_t count = __inherited.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (__inherited[i].port == port)
+		{
+			*socket = __inherited[i].socket;
+
+			__listeners.push_back(__inherited[i]);
+			__inherited.erase(__inherited.begin() + i);
+
+			__claimed.signal();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+void Handover::addListener(std::int64_t port, std::intptr_t socket)
+{
+	// Ephemeral ports can't be handed over
+	if ((port <= 0) || (port > 65535))
+		return;
+
+	ScopedLock lock(__mutex);
+
+	Listener listener;
+	listener.port = static_cast<std::int32_t>(port);
+	listener.socket = static_cast<int>(socket);
+
+	std::size_t count = __listeners.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (__listeners[i].port == listener.port)
+		{
+			__listeners[i] = listener;
+			return;
+		}
+	}
+
+	__listeners.push_back(listener);
+}
+
+//---------------------------------------------------------------------
+
+bool Handover::complete(std::uint32_t timeout)
+{
+	ScopedLock lock(__mutex);
+
+	if (__predecessor == -1)
+		return true;
+
+	// Keep the previous process accepting until the shards are listening
+	std::uint64_t deadline = __getMilliseconds() + timeout;
+
+	while (!__inherited.empty())
+	{
+		std::uint64_t now = __getMilliseconds();
+
+		if (now >= deadline)
+			break;
+
+		__claimed.wait(__mutex, static_cast<std::uint32_t>(deadline - now));
+	}
+
+	bool claimed = __inherited.empty();
+
+	__closeInherited();
+
+	send(__predecessor, &__ready, sizeof(__ready), MSG_NOSIGNAL);
+	close(__predecessor);
+
+	__predecessor = -1;
+
+	return claimed;
+}
+
+//---------------------------------------------------------------------
+
+bool Handover::offer(const char* path, std::uint32_t drainTimeout)
+{
+	sockaddr_un address;
+
+	if (!__getAddress(path, &address))
+		return false;
+
+	int offer = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (offer == -1)
+		return false;
+
+	// Any socket left at the path belongs to the process being replaced
+	unlink(path);
+
+	if ((bind(offer, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (listen(offer, 1) != 0))
+	{
+		printf("Unable to offer the listening sockets on %s: %s\n", path, strerror(errno));
+		close(offer);
+
+		return false;
+	}
+
+	__offer = offer;
+	__drainTimeout = drainTimeout;
+
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+void Handover::terminate()
+{
+	ScopedLock lock(__mutex);
+
+	// The path is left alone as it may already belong to the next process
+	if (__offer != -1)
+		close(__offer);
+
+	if (__predecessor != -1)
+		close(__predecessor);
+
+	__offer = -1;
+	__predecessor = -1;
+
+	__closeInherited();
+	__listeners.clear();
+}
+
+//---------------------------------------------------------------------
+
+int getHandoverDescriptor()
+{
+	return __offer;
+}
+
+//---------------------------------------------------------------------
+
+int acceptSuccessor()
+{
+	int successor = accept4(__offer, 0, 0, SOCK_CLOEXEC);
+
+	if (successor == -1)
+		return -1;
+
+	// The sockets were already handed over
+	if (__drainDeadline != 0)
+	{
+		close(successor);
+		return -1;
+	}
+
+	std::vector<Listener> listeners;
+
+	{
+		ScopedLock lock(__mutex);
+
+		listeners = __listeners;
+	}
+
+	std::size_t count = listeners.size();
+	std::size_t sent = 0;
+	bool succeeded = true;
+
+	for (std::size_t i = 0; (i < count) && succeeded; ++i)
+	{
+		if (__isListening(listeners[i]))
+		{
+			succeeded = __sendListener(successor, listeners[i].port, listeners[i].socket);
+			sent++;
+		}
+	}
+
+	if (!succeeded || !__sendListener(successor, __endOfListeners, -1))
+	{
+		close(successor);
+		return -1;
+	}
+
+	printf("Handed %u listening sockets to a new process\n", static_cast<unsigned int>(sent));
+
+	return successor;
+}
+
+//---------------------------------------------------------------------
+
+void rejectSuccessor()
+{
+	int successor = accept4(__offer, 0, 0, SOCK_CLOEXEC);
+
+	if (successor != -1)
+		close(successor);
+}
+
+//---------------------------------------------------------------------
+
+bool readSuccessor(int successor)
+{
+	char message = 0;
+	ssize_t result = recv(successor, &message, sizeof(message), MSG_DONTWAIT);
+
+	if ((result < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+		return true;
+
+	if ((result != sizeof(message)) || (message != __ready))
+	{
+		printf("New process exited before taking over\n");
+		return false;
+	}
+
+	printf("New process is listening, draining %u connections\n", static_cast<unsigned int>(Shards::getNumberOfConnections()));
+
+	__drainDeadline = __getMilliseconds() + __drainTimeout;
+	Shards::drain(__drainTimeout);
+
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+bool isDrained()
+{
+	if (__drainDeadline == 0)
+		return false;
+
+	return (Shards::getNumberOfConnections() == 0) || (__getMilliseconds() >= __drainDeadline);
+}
+
+#else
+
+//---------------------------------------------------------------------
+
+bool Handover::inherit(const char* path)
+{
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+bool Handover::claimListener(std::int64_t port, std::intptr_t* socket)
+{
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+void Handover::addListener(std::int64_t port, std::intptr_t socket)
+{ }
+
+//---------------------------------------------------------------------
+
+bool Handover::complete(std::uint32_t timeout)
+{
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+bool Handover::offer(const char* path, std::uint32_t drainTimeout)
+{
+	printf("Handing over the listening sockets is only supported on Linux\n");
+
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+void Handover::terminate()
+{ }
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * \file Handover.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_HANDOVER_HPP_INCLUDED
+#define DART_EMBED_HANDOVER_HPP_INCLUDED
+
+#include <cstdint>
+
+namespace DartEmbed
+{
+	/**
+	 * Hands the listening sockets of the server to a new process.
+	 *
+	 * A process started with a handover path offers its listening sockets
+	 * on a Unix socket at that path. When a new process is started with the
+	 * same path it connects, receives the sockets and starts its shards,
+	 * which listen on the inherited sockets rather than binding new ones.
+	 * Once the shards are listening the new process tells the old one,
+	 * which closes its servers and drains its connections before exiting.
+	 * Clients never see the port close.
+	 *
+	 * Only supported on Linux; elsewhere no sockets are ever inherited.
+	 */
+	namespace Handover
+	{
+		/**
+		 * Receives the listening sockets of a running process.
+		 *
+		 * \param path The path of the Unix socket the process offers them on.
+		 * \returns true if a running process handed over its sockets; false otherwise.
+		 */
+		bool inherit(const char* path);
+
+		/**
+		 * Takes an inherited socket listening on a port.
+		 *
+		 * \param port The port to listen on.
+		 * \param socket The inherited socket.
+		 * \returns true if a socket was inherited for the port; false otherwise.
+		 */
+		bool claimListener(std::int64_t port, std::intptr_t* socket);
+
+		/**
+		 * Records a socket listening on a port so it can be handed over.
+		 *
+		 * \param port The port the socket listens on.
+		 * \param socket The listening socket.
+		 */
+		void addListener(std::int64_t port, std::intptr_t socket);
+
+		/**
+		 * Tells the previous process to stop accepting.
+		 *
+		 * Waits for the shards to claim every inherited socket first so
+		 * the previous process keeps accepting until this one is warm.
+		 * Sockets that weren't claimed in time are closed.
+		 *
+		 * \param timeout The maximum time to wait in milliseconds.
+		 * \returns true if every inherited socket was claimed; false otherwise.
+		 */
+		bool complete(std::uint32_t timeout);
+
+		/**
+		 * Offers the listening sockets to the next process.
+		 *
+		 * Once the next process is listening the shards are asked to drain,
+		 * and the host exits when their connections have closed or the
+		 * drain timeout has elapsed.
+		 *
+		 * \param path The path of the Unix socket to offer them on.
+		 * \param drainTimeout Time allowed to drain connections in milliseconds.
+		 * \returns true if the sockets are being offered; false otherwise.
+		 */
+		bool offer(const char* path, std::uint32_t drainTimeout);
+
+		/**
+		 * Stops offering the listening sockets.
+		 */
+		void terminate();
+	} // end namespace Handover
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_HANDOVER_HPP_INCLUDED
@@ -0,0 +1,72 @@
+/**
+ * \file Host.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_HOST_HPP_INCLUDED
+#define DART_EMBED_HOST_HPP_INCLUDED
+
+namespace DartEmbed
+{
+	/**
+	 * The platform the application runs on.
+	 *
+	 * On Windows the host is a window whose message pump runs while a
+	 * thread polls the game pads. On Linux the host is headless: a single
+	 * epoll loop reads the game pads as their events arrive, scans for new
+	 * ones on a timer and exits on SIGINT or SIGTERM.
+	 */
+	namespace Host
+	{
+		/**
+		 * Prepares the host.
+		 *
+		 * Must be called before any threads are started so they inherit
+		 * the signals the host handles.
+		 *
+		 * \returns true if the host was prepared; false otherwise.
+		 */
+		bool initialize();
+
+		/**
+		 * Drives the game pads until the application is asked to exit.
+		 *
+		 * On Linux the host also hands the listening sockets to a new
+		 * process and exits once the connections have drained.
+		 */
+		void run();
+
+		/**
+		 * Releases the resources of the host.
+		 */
+		void terminate();
+	} // end namespace Host
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_HOST_HPP_INCLUDED
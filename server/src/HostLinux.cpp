@@ -0,0 +1,310 @@
+/**
+ * \file HostLinux.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifdef __linux__
+
+#include "Host.hpp"
+#include <DartEmbed/GamePad.hpp>
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "PlatformLinux.hpp"
+#include "ThreadConfiguration.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/**
+	 * Identifies what became ready within the epoll loop.
+	 *
+	 * Game pads are identified by their index so they come first.
+	 */
+	namespace Source
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// A signal asking the application to exit
+			Signals = PlayerIndex::Size,
+			/// The timer to scan for game pads
+			ScanTimer,
+			/// A new process asking for the listening sockets
+			Handover,
+			/// The new process the listening sockets were handed to
+			Successor
+		} ; // end enum Enum
+	} // end namespace Source
+
+	/// Time between scans for new game pads in milliseconds
+	const std::uint32_t __scanInterval = 1000;
+	/// The maximum number of events handled per wait
+	const int __maximumEvents = 8;
+
+	/// The epoll instance
+	int __epoll = -1;
+	/// Receives the signals that end the application
+	int __signals = -1;
+	/// Fires when game pads should be scanned for
+	int __scanTimer = -1;
+	/// Whether each game pad is registered with epoll
+	bool __registered[PlayerIndex::Size];
+	/// The connection to the new process taking over
+	int __successor = -1;
+
+	/**
+	 * Adds a file descriptor to the epoll instance.
+	 *
+	 * \param descriptor The file descriptor to watch.
+	 * \param source What the descriptor is.
+	 * \returns true if the descriptor was added; false otherwise.
+	 */
+	bool __watch(int descriptor, std::uint64_t source)
+	{
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.u64 = source;
+
+		return epoll_ctl(__epoll, EPOLL_CTL_ADD, descriptor, &event) == 0;
+	}
+
+	/**
+	 * Opens any new game pads and watches them for events.
+	 */
+	void __scanGamePads()
+	{
+		scanGamePads();
+
+		for (std::size_t i = 0; i < PlayerIndex::Size; ++i)
+		{
+			int descriptor = getGamePadDescriptor(i);
+
+			if ((descriptor != -1) && !__registered[i])
+				__registered[i] = __watch(descriptor, i);
+		}
+	}
+
+	/**
+	 * Hands the listening sockets to a new process.
+	 *
+	 * Only one new process is served at a time. Any other process that
+	 * connects meanwhile is closed before anything is handed to it.
+	 */
+	void __acceptSuccessor()
+	{
+		if (__successor != -1)
+		{
+			rejectSuccessor();
+			return;
+		}
+
+		int successor = acceptSuccessor();
+
+		if (successor == -1)
+			return;
+
+		if (__watch(successor, Source::Successor))
+			__successor = successor;
+		else
+			close(successor);
+	}
+
+	/**
+	 * Reads from the new process taking over.
+	 */
+	void __readSuccessor()
+	{
+		if (!readSuccessor(__successor))
+		{
+			// Closing the descriptor removes it from epoll
+			close(__successor);
+			__successor = -1;
+		}
+	}
+
+	/**
+	 * Reads the events of a game pad.
+	 *
+	 * \param index The index of the game pad.
+	 */
+	void __readGamePad(std::size_t index)
+	{
+		readGamePad(index);
+
+		// Closing the descriptor removed it from epoll
+		if (getGamePadDescriptor(index) == -1)
+			__registered[index] = false;
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+bool Host::initialize()
+{
+	// Block the signals so they're only received through the descriptor
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+
+	if (pthread_sigmask(SIG_BLOCK, &mask, 0) != 0)
+		return false;
+
+	// Writing to a closed socket should fail rather than end the process
+	signal(SIGPIPE, SIG_IGN);
+
+	__signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	__scanTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	__epoll = epoll_create1(EPOLL_CLOEXEC);
+
+	if ((__signals == -1) || (__scanTimer == -1) || (__epoll == -1))
+	{
+		printf("Unable to create the host: %s\n", strerror(errno));
+		return false;
+	}
+
+	itimerspec interval;
+	interval.it_interval.tv_sec  = __scanInterval / 1000;
+	interval.it_interval.tv_nsec = (__scanInterval % 1000) * 1000000;
+	interval.it_value = interval.it_interval;
+
+	timerfd_settime(__scanTimer, 0, &interval, 0);
+
+	for (std::size_t i = 0; i < PlayerIndex::Size; ++i)
+		__registered[i] = false;
+
+	return __watch(__signals, Source::Signals) && __watch(__scanTimer, Source::ScanTimer);
+}
+
+//---------------------------------------------------------------------
+
+void Host::run()
+{
+	// This thread polls the game pads from here on and every other thread is already running
+	Thread::configureCurrent(ThreadConfiguration::getOptions(ThreadRole::Input));
+
+	__scanGamePads();
+
+	int handover = getHandoverDescriptor();
+
+	if (handover != -1)
+		__watch(handover, Source::Handover);
+
+	epoll_event events[__maximumEvents];
+
+	for (;;)
+	{
+		// Sleep until a game pad, the timer or a signal needs attention
+		int count = epoll_wait(__epoll, events, __maximumEvents, -1);
+
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			printf("Host stopped: %s\n", strerror(errno));
+			return;
+		}
+
+		for (int i = 0; i < count; ++i)
+		{
+			std::uint64_t source = events[i].data.u64;
+
+			if (source == Source::Signals)
+			{
+				signalfd_siginfo info;
+
+				if (read(__signals, &info, sizeof(info)) == sizeof(info))
+				{
+					printf("Received %s, shutting down\n", strsignal(info.ssi_signo));
+					return;
+				}
+			}
+			else if (source == Source::ScanTimer)
+			{
+				std::uint64_t expirations;
+
+				if (read(__scanTimer, &expirations, sizeof(expirations)) == sizeof(expirations))
+					__scanGamePads();
+
+				if (isDrained())
+				{
+					printf("Connections drained, shutting down\n");
+					return;
+				}
+			}
+			else if (source == Source::Handover)
+			{
+				__acceptSuccessor();
+			}
+			else if (source == Source::Successor)
+			{
+				__readSuccessor();
+			}
+			else if (source < PlayerIndex::Size)
+			{
+				__readGamePad(static_cast<std::size_t>(source));
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------
+
+void Host::terminate()
+{
+	closeGamePads();
+
+	if (__successor != -1)
+		close(__successor);
+
+	__successor = -1;
+
+	if (__epoll != -1)
+		close(__epoll);
+
+	if (__scanTimer != -1)
+		close(__scanTimer);
+
+	if (__signals != -1)
+		close(__signals);
+
+	__epoll = -1;
+	__scanTimer = -1;
+	__signals = -1;
+}
+
+#endif
@@ -30,8 +30,13 @@
  */
 
 #include "BuiltinLibraries.hpp"
+#include "Clock.hpp"
+#include "Handover.hpp"
 #include "ScriptLibrary.hpp"
+#include "SendBacklog.hpp"
 #include "NativeResolution.hpp"
+#include "ThreadConfiguration.hpp"
+#include "TimerWheel.hpp"
 using namespace DartEmbed;
 
 //---------------------------------------------------------------------
@@ -120,6 +125,212 @@ DECLARE_FUNCTION(Socket_NewServicePort, 0)
 
 namespace
 {
+	//---------------------------------------------------------------------
+	// Timers
+	//
+	// dart:io passes the wakeup time of an isolate's earliest timer to the
+	// event handler with a null handle. Those are intercepted and kept in a
+	// single timer wheel for every isolate rather than a timeout within
+	// each event handler.
+	//---------------------------------------------------------------------
+
+	/// Sent by dart:io when an isolate has no timers
+	const std::int64_t __noTimer = -1;
+
+	/// Guards the timer wheel
+	Mutex __timerMutex;
+	/// Signaled when the timers change or the wheel is stopped
+	ConditionVariable __timersChanged;
+	/// Thread expiring the timers
+	Thread __timerThread;
+	/// Whether the timer thread should exit
+	bool __timerShutdown = false;
+	/// The wheel holding the timer of each port
+	TimerWheel* __timerWheel = 0;
+	/// The length of a tick of the wheel in milliseconds
+	std::uint32_t __timerResolution = 1;
+
+	/**
+	 * Gets the current tick of the timer wheel.
+	 *
+	 * \returns The current tick.
+	 */
+	inline std::uint64_t __getCurrentTick()
+	{
+		return (Clock::getMicroseconds() / 1000) / __timerResolution;
+	}
+
+	/**
+	 * Notifies the ports whose timers expired.
+	 *
+	 * Every timer expiring within a tick is handled by a single wakeup.
+	 *
+	 * \param argument Unused.
+	 */
+	void __runTimers(void* argument)
+	{
+		std::vector<std::uint64_t> expired;
+
+		__timerMutex.lock();
+
+		while (!__timerShutdown)
+		{
+			std::uint64_t now = __getCurrentTick();
+
+			expired.clear();
+			__timerWheel->advance(now, &expired);
+
+			std::size_t count = expired.size();
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				Dart_CObject message;
+				message.type = Dart_CObject::kNull;
+
+				Dart_PostCObject(static_cast<Dart_Port>(expired[i]), &message);
+			}
+
+			std::uint64_t next;
+
+			if (__timerWheel->getNextTick(&next))
+			{
+				if (next > now)
+					__timersChanged.wait(__timerMutex, static_cast<std::uint32_t>((next - now) * __timerResolution));
+			}
+			else
+			{
+				__timersChanged.wait(__timerMutex);
+			}
+		}
+
+		__timerMutex.unlock();
+	}
+
+	/**
+	 * Schedules the timer of a port.
+	 *
+	 * \param port The port to notify.
+	 * \param wakeup When to notify the port in milliseconds since the epoch, or __noTimer.
+	 */
+	void __scheduleTimer(Dart_Port port, std::int64_t wakeup)
+	{
+		ScopedLock lock(__timerMutex);
+
+		if (!__timerWheel)
+		{
+			__timerWheel = new TimerWheel(__getCurrentTick());
+			__timerShutdown = false;
+			__timerThread.start(__runTimers, 0, ThreadConfiguration::getOptions(ThreadRole::Timers));
+		}
+
+		if (wakeup == __noTimer)
+		{
+			__timerWheel->cancel(static_cast<std::uint64_t>(port));
+		}
+		else
+		{
+			// Convert to the monotonic clock, rounding up so timers never fire early
+			std::int64_t delay = wakeup - Clock::getSystemMilliseconds();
+			std::uint64_t now = Clock::getMicroseconds() / 1000;
+			std::uint64_t expires = (delay > 0) ? now + static_cast<std::uint64_t>(delay) : now;
+
+			__timerWheel->schedule(static_cast<std::uint64_t>(port), (expires + __timerResolution - 1) / __timerResolution);
+		}
+
+		__timersChanged.signal();
+	}
+
+	/**
+	 * Sends data to the event handler of the isolate.
+	 *
+	 * Timers, which have a null handle, are scheduled on the timer wheel.
+	 * Everything else goes to the event handler provided by the runtime.
+	 */
+	void EventHandler_SendData(Dart_NativeArguments args)
+	{
+		Dart_EnterScope();
+
+		if (Dart_IsNull(Dart_GetNativeArgument(args, 1)))
+		{
+			std::int64_t port = 0;
+			Dart_Handle id = Dart_GetField(Dart_GetNativeArgument(args, 2), Dart_NewString("_id"));
+
+			std::int64_t wakeup = __noTimer;
+			Dart_Handle result = Dart_IntegerToInt64(Dart_GetNativeArgument(args, 3), &wakeup);
+
+			if (!Dart_IsError(id) && !Dart_IsError(Dart_IntegerToInt64(id, &port)) && !Dart_IsError(result))
+				__scheduleTimer(static_cast<Dart_Port>(port), wakeup);
+		}
+		else
+		{
+			FUNCTION_NAME(EventHandler_SendData)(args);
+		}
+
+		Dart_ExitScope();
+	}
+
+	/**
+	 * Creates a socket listening on a port.
+	 *
+	 * Sockets inherited from a previous process are reused rather than
+	 * bound again, and every listening socket is recorded so it can be
+	 * handed to the next process.
+	 */
+	void ServerSocket_CreateBindListen(Dart_NativeArguments args)
+	{
+		Dart_EnterScope();
+
+		// Arguments are the socket, the address, the port and the backlog
+		Dart_Handle socket = Dart_GetNativeArgument(args, 0);
+
+		std::int64_t port = 0;
+		Dart_Handle result = Dart_IntegerToInt64(Dart_GetNativeArgument(args, 2), &port);
+
+		std::intptr_t id = 0;
+
+		if (!Dart_IsError(result) && Handover::claimListener(port, &id))
+		{
+			Dart_SetNativeInstanceField(socket, 0, id);
+			Dart_SetReturnValue(args, Dart_True());
+		}
+		else
+		{
+			FUNCTION_NAME(ServerSocket_CreateBindListen)(args);
+
+			if (!Dart_IsError(result) && !Dart_IsError(Dart_GetNativeInstanceField(socket, 0, &id)) && (id > 0))
+				Handover::addListener(port, id);
+		}
+
+		Dart_ExitScope();
+	}
+
+	/**
+	 * Accepts a connection on a listening socket.
+	 *
+	 * Accepted sockets are recorded so the connection can later measure
+	 * how much it has sent that the client hasn't received.
+	 */
+	void ServerSocket_Accept(Dart_NativeArguments args)
+	{
+		Dart_EnterScope();
+
+		// Arguments are the listening socket and the socket to accept into
+		Dart_Handle socket = Dart_GetNativeArgument(args, 1);
+
+		FUNCTION_NAME(ServerSocket_Accept)(args);
+
+		std::intptr_t id = 0;
+
+		if (!Dart_IsError(Dart_GetNativeInstanceField(socket, 0, &id)) && (id > 0))
+			SendBacklog::addSocket(id);
+
+		Dart_ExitScope();
+	}
+
+	//---------------------------------------------------------------------
+	// Virtual machine entries
+	//---------------------------------------------------------------------
+
 	/// Whether the library has been initialized
 	bool __libraryInitialized = false;
 	/// Class entries for the IO library
@@ -162,7 +373,7 @@ namespace
 	 void __setupEventHandlerEntries()
 	 {
 		setNativeEntry(&__eventHandlerNativeEntries[0], "Start",    FUNCTION_NAME(EventHandler_Start), 1);
-		setNativeEntry(&__eventHandlerNativeEntries[1], "SendData", FUNCTION_NAME(EventHandler_SendData), 4);
+		setNativeEntry(&__eventHandlerNativeEntries[1], "SendData", EventHandler_SendData, 4);
 		// Set the sentinal value
 		setNativeEntry(&__eventHandlerNativeEntries[2], "", 0, 0);
 	}
@@ -228,8 +439,8 @@ namespace
 	 */
 	void __setupServerSocketEntries()
 	{
-		setNativeEntry(&__serverSocketNativeEntries[0], "CreateBindListen", FUNCTION_NAME(ServerSocket_CreateBindListen), 4);
-		setNativeEntry(&__serverSocketNativeEntries[1], "Accept",           FUNCTION_NAME(ServerSocket_Accept),           2);
+		setNativeEntry(&__serverSocketNativeEntries[0], "CreateBindListen", ServerSocket_CreateBindListen,                4);
+		setNativeEntry(&__serverSocketNativeEntries[1], "Accept",           ServerSocket_Accept,                          2);
 		// Set the sentinal value
 		setNativeEntry(&__serverSocketNativeEntries[2], "", 0, 0);
 	}
@@ -359,3 +570,29 @@ ScriptLibrary* BuiltinLibraries::createIOLibrary()
 	// IO initializer allows some functions to be called before the library is used.
 	return new ScriptLibrary("dart:io", 0, __ioLibraryResolver, __ioLibraryInitializer);
 }
+
+//---------------------------------------------------------------------
+
+void BuiltinLibraries::setTimerResolution(std::uint32_t milliseconds)
+{
+	ScopedLock lock(__timerMutex);
+
+	// Ticks already scheduled would be misinterpreted
+	if (!__timerWheel && (milliseconds > 0))
+		__timerResolution = milliseconds;
+}
+
+//---------------------------------------------------------------------
+
+void BuiltinLibraries::terminateIOLibrary()
+{
+	__timerMutex.lock();
+	__timerShutdown = true;
+	__timersChanged.signal();
+	__timerMutex.unlock();
+
+	__timerThread.join();
+
+	delete __timerWheel;
+	__timerWheel = 0;
+}
@@ -32,9 +32,17 @@
 #include "EmbedLibraries.hpp"
 #include <DartEmbed/GamePad.hpp>
 #include <DartEmbed/VirtualMachine.hpp>
+#include <algorithm>
+#include <cstring>
 #include "Arguments.hpp"
+#include "AsyncNative.hpp"
+#include "Clock.hpp"
+#include "EmbedIsolateData.hpp"
+#include "GamePadSerialization.hpp"
 #include "ScriptLibrary.hpp"
 #include "NativeResolution.hpp"
+#include "ThreadConfiguration.hpp"
+#include "VibrationQueue.hpp"
 using namespace DartEmbed;
 
 namespace
@@ -45,7 +53,9 @@ namespace
 
 	const char* __sourceCode =
 		"#library('embed:input');\n"
+		"#import('dart:isolate');\n"
 		"#import('dart:nativewrappers');\n"
+		"#import('embed:async');\n"
 		"\n"
 		"class GamePadState extends NativeFieldWrapperClass1\n"
 		"{\n"
@@ -59,14 +69,491 @@ namespace
 		"  double get leftTrigger() native 'GamePadState_GetLeftTrigger';\n"
 		"  double get rightTrigger() native 'GamePadState_GetRightTrigger';\n"
 		"  int get buttons() native 'GamePadState_GetButtons';\n"
+		"  String toJson([int index = -1]) => _toJson(index);\n"
+		"  String _toJson(int index) native 'GamePadState_ToJson';\n"
+		"  int get packetNumber() native 'GamePadState_GetPacketNumber';\n"
 		"}\n"
 		"\n"
 		"class GamePad\n"
 		"{\n"
 		"  static void getState(int index, GamePadState state) native 'GamePad_GetState';\n"
-		"  static void setVibration(int index, double leftMotor, double rightMotor) native 'GamePad_SetVibration';\n"
+		"\n"
+		"  static Future setVibration(int index, double leftMotor, double rightMotor)\n"
+		"  {\n"
+		"    if (_vibration == null)\n"
+		"      _vibration = new AsyncNative(_newVibrationPort());\n"
+		"\n"
+		"    return _vibration.call([index, leftMotor, rightMotor]);\n"
+		"  }\n"
+		"\n"
+		"  static SendPort _newVibrationPort() native 'GamePad_NewVibrationPort';\n"
+		"\n"
+		"  static AsyncNative _vibration;\n"
+		"}\n"
+		"\n"
+		"class GamePadFeed extends NativeFieldWrapperClass1\n"
+		"{\n"
+		"  GamePadFeed(int index) { _initialize(index); }\n"
+		"  void _initialize(int index) native 'GamePadFeed_New';\n"
+		"\n"
+		"  bool update()\n"
+		"  {\n"
+		"    if (!_update())\n"
+		"      return false;\n"
+		"\n"
+		"    _keyframe = null;\n"
+		"    _delta = null;\n"
+		"    _json = null;\n"
+		"\n"
+		"    return true;\n"
+		"  }\n"
+		"\n"
+		"  static List<int> combine(List<List<int>> frames) native 'GamePadFeed_Combine';\n"
+		"\n"
+		"  int get index() native 'GamePadFeed_GetIndex';\n"
+		"  int get version() native 'GamePadFeed_GetVersion';\n"
+		"\n"
+		"  List<int> get keyframe()\n"
+		"  {\n"
+		"    if (_keyframe == null)\n"
+		"      _keyframe = _toBytes();\n"
+		"\n"
+		"    return _keyframe;\n"
+		"  }\n"
+		"\n"
+		"  List<int> get delta()\n"
+		"  {\n"
+		"    if (_delta == null)\n"
+		"      _delta = _toDelta();\n"
+		"\n"
+		"    return _delta;\n"
+		"  }\n"
+		"\n"
+		"  String get json()\n"
+		"  {\n"
+		"    if (_json == null)\n"
+		"      _json = _toJson();\n"
+		"\n"
+		"    return _json;\n"
+		"  }\n"
+		"\n"
+		"  bool _update() native 'GamePadFeed_Update';\n"
+		"  List<int> _toBytes() native 'GamePadFeed_ToBytes';\n"
+		"  List<int> _toDelta() native 'GamePadFeed_ToDelta';\n"
+		"  String _toJson() native 'GamePadFeed_ToJson';\n"
+		"\n"
+		"  List<int> _keyframe;\n"
+		"  List<int> _delta;\n"
+		"  String _json;\n"
+		"}\n"
+		"\n"
+		"class ControlMessage extends NativeFieldWrapperClass1\n"
+		"{\n"
+		"  static final int UNKNOWN = 0;\n"
+		"  static final int FORMAT = 1;\n"
+		"  static final int INDEX = 2;\n"
+		"  static final int VIBRATION = 3;\n"
+		"  static final int SUBSCRIBE = 4;\n"
+		"  static final int PING = 5;\n"
+		"\n"
+		"  ControlMessage() { _initialize(); }\n"
+		"  void _initialize() native 'ControlMessage_New';\n"
+		"  bool parse(String message) native 'ControlMessage_Parse';\n"
+		"  int get type() native 'ControlMessage_GetType';\n"
+		"  int get index() native 'ControlMessage_GetIndex';\n"
+		"  int get pads() native 'ControlMessage_GetPads';\n"
+		"  double get time() native 'ControlMessage_GetTime';\n"
+		"  bool get isBinary() native 'ControlMessage_IsBinary';\n"
+		"}\n"
+		"\n"
+		"class FrameClock\n"
+		"{\n"
+		"  FrameClock(void onTick(int frame))\n"
+		"  {\n"
+		"    _port = new ReceivePort();\n"
+		"    _port.receive((frame, replyTo) { onTick(frame); });\n"
+		"    _service().send(true, _port.toSendPort());\n"
+		"  }\n"
+		"\n"
+		"  void stop()\n"
+		"  {\n"
+		"    _service().send(false, _port.toSendPort());\n"
+		"    _port.close();\n"
+		"  }\n"
+		"\n"
+		"  static int get framesPerSecond() native 'FrameClock_GetFramesPerSecond';\n"
+		"\n"
+		"  static SendPort _service()\n"
+		"  {\n"
+		"    if (_servicePort == null)\n"
+		"      _servicePort = _newServicePort();\n"
+		"\n"
+		"    return _servicePort;\n"
+		"  }\n"
+		"\n"
+		"  static SendPort _newServicePort() native 'FrameClock_NewServicePort';\n"
+		"\n"
+		"  static SendPort _servicePort;\n"
+		"  ReceivePort _port;\n"
 		"}\n";
 
+	//---------------------------------------------------------------------
+	// Frame clock
+	//---------------------------------------------------------------------
+
+	/// Guards the frame clock
+	Mutex __clockMutex;
+	/// Signaled when the subscribers change or the clock is stopped
+	ConditionVariable __clockChanged;
+	/// Thread ticking the frames
+	Thread __clockThread;
+	/// Whether the clock thread should exit
+	bool __clockShutdown = false;
+	/// The port subscriptions are posted to
+	Dart_Port __clockServicePort = kIllegalPort;
+	/// The ports receiving ticks
+	std::vector<Dart_Port> __clockSubscribers;
+	/// The number of ticks per second
+	std::uint32_t __framesPerSecond = 60;
+
+	/**
+	 * Posts a tick to every subscriber once per frame.
+	 *
+	 * Deadlines are computed from when the clock started rather than from
+	 * the previous tick so waking late doesn't accumulate drift. Frames
+	 * missed entirely are skipped rather than delivered in a burst.
+	 *
+	 * \param argument Unused.
+	 */
+	void __runFrameClock(void* argument)
+	{
+		const std::uint64_t period = 1000000 / __framesPerSecond;
+		const std::uint64_t start = Clock::getMicroseconds();
+		std::uint64_t frame = 0;
+
+		__clockMutex.lock();
+
+		while (!__clockShutdown)
+		{
+			if (__clockSubscribers.empty())
+			{
+				__clockChanged.wait(__clockMutex);
+				continue;
+			}
+
+			std::uint64_t now = Clock::getMicroseconds();
+			std::uint64_t deadline = start + (frame + 1) * period;
+
+			if (now < deadline)
+			{
+				__clockChanged.wait(__clockMutex, static_cast<std::uint32_t>((deadline - now + 999) / 1000));
+				continue;
+			}
+
+			frame = (now - start) / period;
+
+			Dart_CObject message;
+			message.type = Dart_CObject::kInt64;
+			message.value.as_int64 = static_cast<std::int64_t>(frame);
+
+			// Ports closed without unsubscribing are dropped
+			std::size_t i = 0;
+
+			while (i < __clockSubscribers.size())
+			{
+				if (Dart_PostCObject(__clockSubscribers[i], &message))
+				{
+					++i;
+				}
+				else
+				{
+					__clockSubscribers[i] = __clockSubscribers.back();
+					__clockSubscribers.pop_back();
+				}
+			}
+		}
+
+		__clockMutex.unlock();
+	}
+
+	/**
+	 * Receives subscriptions posted to the frame clock's service port.
+	 *
+	 * The message is true to start receiving ticks on the reply port and
+	 * false to stop.
+	 *
+	 * \param destinationPort The service port.
+	 * \param replyPort The port to tick.
+	 * \param message The message received.
+	 */
+	void __handleFrameClockMessage(Dart_Port destinationPort, Dart_Port replyPort, Dart_CObject* message)
+	{
+		if ((replyPort == kIllegalPort) || (message->type != Dart_CObject::kBool))
+			return;
+
+		ScopedLock lock(__clockMutex);
+
+		std::vector<Dart_Port>::iterator found = std::find(__clockSubscribers.begin(), __clockSubscribers.end(), replyPort);
+
+		if (message->value.as_bool)
+		{
+			if (found == __clockSubscribers.end())
+				__clockSubscribers.push_back(replyPort);
+
+			if (!__clockThread.isStarted())
+			{
+				__clockShutdown = false;
+				__clockThread.start(__runFrameClock, 0, ThreadConfiguration::getOptions(ThreadRole::FrameClock));
+			}
+		}
+		else if (found != __clockSubscribers.end())
+		{
+			__clockSubscribers.erase(found);
+		}
+
+		__clockChanged.signal();
+	}
+
+	//---------------------------------------------------------------------
+	// Serialization
+	//---------------------------------------------------------------------
+
+	/**
+	 * Backs a string of JSON handed to Dart.
+	 *
+	 * Buffers are returned to a free list once Dart no longer references
+	 * the string so serializing every frame doesn't allocate.
+	 */
+	struct JsonBuffer
+	{
+		/// The characters of the string
+		char data[GamePadSerialization::MaximumJsonLength];
+		/// The next free buffer
+		JsonBuffer* next;
+	} ; // end struct JsonBuffer
+
+	/// Guards the free buffers
+	Mutex __jsonMutex;
+	/// Buffers not referenced by Dart
+	JsonBuffer* __freeJsonBuffers = 0;
+
+	/**
+	 * Takes a buffer from the free list.
+	 *
+	 * \returns A buffer to write to.
+	 */
+	JsonBuffer* __acquireJsonBuffer()
+	{
+		ScopedLock lock(__jsonMutex);
+
+		JsonBuffer* buffer = __freeJsonBuffers;
+
+		if (buffer)
+			__freeJsonBuffers = buffer->next;
+		else
+			buffer = new JsonBuffer();
+
+		return buffer;
+	}
+
+	/**
+	 * Returns a buffer to the free list once its string is collected.
+	 *
+	 * \param peer The buffer.
+	 */
+	void __releaseJsonBuffer(void* peer)
+	{
+		JsonBuffer* buffer = static_cast<JsonBuffer*>(peer);
+
+		ScopedLock lock(__jsonMutex);
+
+		buffer->next = __freeJsonBuffers;
+		__freeJsonBuffers = buffer;
+	}
+
+	/**
+	 * Serializes a game pad state as a JSON string.
+	 *
+	 * The string references a pooled buffer rather than copying it.
+	 *
+	 * \param state The state to serialize.
+	 * \param index The index of the game pad or -1 to leave it out.
+	 * \returns The string or an error.
+	 */
+	Dart_Handle __newJsonString(const GamePadState& state, std::int32_t index)
+	{
+		JsonBuffer* buffer = __acquireJsonBuffer();
+		std::size_t length = GamePadSerialization::writeJson(state, index, buffer->data, sizeof(buffer->data));
+
+		Dart_Handle json = Dart_NewExternalString8(
+			reinterpret_cast<const std::uint8_t*>(buffer->data),
+			static_cast<intptr_t>(length),
+			buffer,
+			__releaseJsonBuffer
+		);
+
+		if (Dart_IsError(json))
+			__releaseJsonBuffer(buffer);
+
+		return json;
+	}
+
+	/**
+	 * Copies bytes into a new byte array.
+	 *
+	 * \param bytes The bytes to copy.
+	 * \param length The number of bytes.
+	 * \returns The byte array or an error.
+	 */
+	Dart_Handle __newByteArray(const std::uint8_t* bytes, std::size_t length)
+	{
+		Dart_Handle array = Dart_NewByteArray(static_cast<intptr_t>(length));
+
+		if (!Dart_IsError(array))
+			Dart_ListSetAsBytes(array, 0, const_cast<std::uint8_t*>(bytes), static_cast<intptr_t>(length));
+
+		return array;
+	}
+
+	//---------------------------------------------------------------------
+	// Feeds
+	//---------------------------------------------------------------------
+
+	/**
+	 * The state of a game pad serialized once per frame for every viewer.
+	 *
+	 * The version increases whenever something a client sees changes, so
+	 * a client knows it is current by the version it was last sent. The
+	 * delta moves a client from the previous version to the current one.
+	 */
+	struct GamePadFeed
+	{
+		/// The game pad fed
+		PlayerIndex::Enum player;
+		/// The state of the game pad
+		GamePadState state;
+		/// The current state as a binary frame
+		std::uint8_t frame[GamePadSerialization::BinaryLength];
+		/// The delta from the previous version
+		std::uint8_t delta[GamePadSerialization::MaximumDeltaLength];
+		/// The length of the delta; 0 if there is no previous version
+		std::size_t deltaLength;
+		/// The version of the state; 0 before the first update
+		std::int64_t version;
+	} ; // end struct GamePadFeed
+
+	/**
+	 * Reads the state of the game pad and checks for changes.
+	 *
+	 * \param feed The feed to update.
+	 * \returns true if the version changed; false otherwise.
+	 */
+	bool __updateFeed(GamePadFeed* feed)
+	{
+		feed->state = GamePad::getState(feed->player);
+
+		std::uint8_t current[GamePadSerialization::BinaryLength];
+		GamePadSerialization::writeBinary(feed->state, feed->player, current);
+
+		if (feed->version == 0)
+		{
+			memcpy(feed->frame, current, sizeof(current));
+			feed->deltaLength = 0;
+			feed->version = 1;
+
+			return true;
+		}
+
+		std::uint8_t delta[GamePadSerialization::MaximumDeltaLength];
+		std::size_t deltaLength = GamePadSerialization::writeDelta(feed->frame, current, delta);
+
+		// The packet number can change without anything a client sees changing
+		memcpy(feed->frame, current, sizeof(current));
+
+		if (deltaLength == 0)
+			return false;
+
+		memcpy(feed->delta, delta, deltaLength);
+		feed->deltaLength = deltaLength;
+		feed->version++;
+
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	// Vibration
+	//---------------------------------------------------------------------
+
+	/// Guards creating the vibration port
+	Mutex __vibrationMutex;
+	/// The port vibration requests are posted to
+	Dart_Port __vibrationPort = kIllegalPort;
+
+	/**
+	 * Reads a motor speed sent from Dart.
+	 *
+	 * \param value The value sent.
+	 * \param speed The speed read.
+	 * \returns true if the value was a number; false otherwise.
+	 */
+	bool __getMotorSpeed(const Dart_CObject* value, float* speed)
+	{
+		if (value->type == Dart_CObject::kDouble)
+			*speed = static_cast<float>(value->value.as_double);
+		else if (value->type == Dart_CObject::kInt32)
+			*speed = static_cast<float>(value->value.as_int32);
+		else
+			return false;
+
+		*speed = std::min(std::max(*speed, 0.0f), 1.0f);
+
+		return true;
+	}
+
+	/**
+	 * Receives requests posted to the vibration port.
+	 *
+	 * Messages are a list of the controller and the two motor speeds. The
+	 * speeds go through the VibrationQueue so a later request always wins
+	 * over an earlier one, and the future completes once they are queued.
+	 *
+	 * \param message The message received.
+	 * \param completion Completes the future returned to Dart.
+	 */
+	void __handleVibrationMessage(Dart_CObject* message, const AsyncCompletion& completion)
+	{
+		if ((message->type != Dart_CObject::kArray) ||
+		    (message->value.as_array.length != 3) ||
+		    (message->value.as_array.values[0]->type != Dart_CObject::kInt32))
+		{
+			completion.completeWithError("Invalid vibration request");
+			return;
+		}
+
+		std::int32_t player = message->value.as_array.values[0]->value.as_int32;
+
+		if ((player < 0) || (player >= PlayerIndex::Size))
+		{
+			completion.completeWithError("Invalid player index");
+			return;
+		}
+
+		float leftMotor;
+		float rightMotor;
+
+		if ((!__getMotorSpeed(message->value.as_array.values[1], &leftMotor)) ||
+		    (!__getMotorSpeed(message->value.as_array.values[2], &rightMotor)))
+		{
+			completion.completeWithError("Motor speeds must be numbers");
+			return;
+		}
+
+		if (VibrationQueue::set(static_cast<PlayerIndex::Enum>(player), leftMotor, rightMotor))
+			completion.complete();
+		else
+			completion.completeWithError("Workers are not running");
+	}
+
 	//---------------------------------------------------------------------
 	// Native functions
 	//---------------------------------------------------------------------
@@ -74,7 +561,7 @@ namespace
 	inline PlayerIndex::Enum __getPlayerIndex(Dart_NativeArguments args, int index)
 	{
 		std::int32_t player;
-		getValue(args, 0, &player);
+		getValue(args, index, &player);
 
 		if ((player < 0) || (player >= PlayerIndex::Size))
 			return PlayerIndex::One;
@@ -92,25 +579,33 @@ namespace
 		*state = GamePad::getState(index);
 	}
 
-	void GamePad_SetVibration(Dart_NativeArguments args)
+	void GamePad_NewVibrationPort(Dart_NativeArguments args)
 	{
-		PlayerIndex::Enum index = __getPlayerIndex(args, 0);
+		ScopedLock lock(__vibrationMutex);
 
-		float leftMotor;
-		getValue(args, 1, &leftMotor);
-
-		float rightMotor;
-		getValue(args, 2, &rightMotor);
+		if (__vibrationPort == kIllegalPort)
+			__vibrationPort = AsyncNatives::createPort("VibrationService", __handleVibrationMessage);
 
-		GamePad::setVibration(index, leftMotor, rightMotor);
+		Dart_SetReturnValue(args, Dart_NewSendPort(__vibrationPort));
 	}
 
-	void GamePadState_Delete(Dart_Handle handle, void* data)
+	void GamePadState_Free(void* data)
 	{
 		GamePadState* state = static_cast<GamePadState*>(data);
 		delete state;
 	}
 
+	void GamePadState_Delete(Dart_Handle handle, void* data)
+	{
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+
+		// Anything still owned at shutdown is freed with the isolate data
+		if (isolateData->removeNativeObject(data))
+			GamePadState_Free(data);
+
+		Dart_DeletePersistentHandle(handle);
+	}
+
 	void GamePadState_New(Dart_NativeArguments args)
 	{
 		Dart_Handle instance = Dart_GetNativeArgument(args, 0);
@@ -118,6 +613,9 @@ namespace
 		GamePadState* state = new GamePadState();
 		Dart_SetNativeInstanceField(instance, 0, reinterpret_cast<intptr_t>(state));
 
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+		isolateData->addNativeObject(state, sizeof(GamePadState), GamePadState_Free);
+
 		Dart_NewWeakPersistentHandle(instance, state, GamePadState_Delete);
 	}
 
@@ -185,6 +683,285 @@ namespace
 		Dart_SetReturnValue(args, Dart_NewInteger(state->getButtons()));
 	}
 
+	void GamePadState_ToJson(Dart_NativeArguments args)
+	{
+		GamePadState* state = 0;
+		getNativeField(args, 0, &state);
+
+		std::int32_t index;
+		getValue(args, 1, &index);
+
+		Dart_SetReturnValue(args, __newJsonString(*state, index));
+	}
+
+	void GamePadState_GetPacketNumber(Dart_NativeArguments args)
+	{
+		GamePadState* state = 0;
+		getNativeField(args, 0, &state);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(state->getPacketNumber()));
+	}
+
+	void GamePadFeed_Free(void* data)
+	{
+		GamePadFeed* feed = static_cast<GamePadFeed*>(data);
+		delete feed;
+	}
+
+	void GamePadFeed_Delete(Dart_Handle handle, void* data)
+	{
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+
+		// Anything still owned at shutdown is freed with the isolate data
+		if (isolateData->removeNativeObject(data))
+			GamePadFeed_Free(data);
+
+		Dart_DeletePersistentHandle(handle);
+	}
+
+	void GamePadFeed_New(Dart_NativeArguments args)
+	{
+		Dart_Handle instance = Dart_GetNativeArgument(args, 0);
+
+		GamePadFeed* feed = new GamePadFeed();
+		feed->player = __getPlayerIndex(args, 1);
+		feed->deltaLength = 0;
+		feed->version = 0;
+
+		Dart_SetNativeInstanceField(instance, 0, reinterpret_cast<intptr_t>(feed));
+
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+		isolateData->addNativeObject(feed, sizeof(GamePadFeed), GamePadFeed_Free);
+
+		Dart_NewWeakPersistentHandle(instance, feed, GamePadFeed_Delete);
+	}
+
+	void GamePadFeed_Update(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		Dart_SetReturnValue(args, Dart_NewBoolean(__updateFeed(feed)));
+	}
+
+	void GamePadFeed_GetIndex(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(feed->player));
+	}
+
+	void GamePadFeed_GetVersion(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(feed->version));
+	}
+
+	void GamePadFeed_ToBytes(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		Dart_SetReturnValue(args, __newByteArray(feed->frame, sizeof(feed->frame)));
+	}
+
+	void GamePadFeed_ToDelta(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		if (feed->deltaLength > 0)
+			Dart_SetReturnValue(args, __newByteArray(feed->delta, feed->deltaLength));
+		else
+			Dart_SetReturnValue(args, Dart_Null());
+	}
+
+	/**
+	 * Joins the binary frames of several game pads into one.
+	 *
+	 * Each frame starts with the index and flags of its game pad, which
+	 * give its length, so a client reads them back to back.
+	 */
+	void GamePadFeed_Combine(Dart_NativeArguments args)
+	{
+		Dart_Handle frames = Dart_GetNativeArgument(args, 0);
+
+		std::uint8_t combined[PlayerIndex::Size * GamePadSerialization::MaximumDeltaLength];
+		std::size_t length = 0;
+		intptr_t count = 0;
+
+		if (Dart_IsError(Dart_ListLength(frames, &count)))
+		{
+			Dart_SetReturnValue(args, Dart_Null());
+			return;
+		}
+
+		for (intptr_t i = 0; i < count; ++i)
+		{
+			Dart_Handle frame = Dart_ListGetAt(frames, i);
+			intptr_t frameLength = 0;
+
+			if ((Dart_IsError(Dart_ListLength(frame, &frameLength))) ||
+			    (length + frameLength > sizeof(combined)) ||
+			    (Dart_IsError(Dart_ListGetAsBytes(frame, 0, combined + length, frameLength))))
+			{
+				Dart_SetReturnValue(args, Dart_Null());
+				return;
+			}
+
+			length += frameLength;
+		}
+
+		Dart_SetReturnValue(args, __newByteArray(combined, length));
+	}
+
+	void GamePadFeed_ToJson(Dart_NativeArguments args)
+	{
+		GamePadFeed* feed = 0;
+		getNativeField(args, 0, &feed);
+
+		Dart_SetReturnValue(args, __newJsonString(feed->state, feed->player));
+	}
+
+	void ControlMessage_Free(void* data)
+	{
+		ControlMessage* message = static_cast<ControlMessage*>(data);
+		delete message;
+	}
+
+	void ControlMessage_Delete(Dart_Handle handle, void* data)
+	{
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+
+		// Anything still owned at shutdown is freed with the isolate data
+		if (isolateData->removeNativeObject(data))
+			ControlMessage_Free(data);
+
+		Dart_DeletePersistentHandle(handle);
+	}
+
+	void ControlMessage_New(Dart_NativeArguments args)
+	{
+		Dart_Handle instance = Dart_GetNativeArgument(args, 0);
+
+		ControlMessage* message = new ControlMessage();
+		message->type = ControlType::Unknown;
+		message->index = -1;
+		message->pads = 0;
+		message->binary = false;
+		message->time = 0.0;
+
+		Dart_SetNativeInstanceField(instance, 0, reinterpret_cast<intptr_t>(message));
+
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+		isolateData->addNativeObject(message, sizeof(ControlMessage), ControlMessage_Free);
+
+		Dart_NewWeakPersistentHandle(instance, message, ControlMessage_Delete);
+	}
+
+	/**
+	 * Reads a control message sent by a client.
+	 *
+	 * The characters are copied onto the stack and read in place rather
+	 * than going through JSON.parse. Vibration is applied here, so the
+	 * isolate only has to look at the messages that change what the
+	 * client is sent.
+	 */
+	void ControlMessage_Parse(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_Handle text = Dart_GetNativeArgument(args, 1);
+
+		std::uint8_t characters[GamePadSerialization::MaximumControlLength + 1];
+		intptr_t length = GamePadSerialization::MaximumControlLength;
+		intptr_t actualLength = 0;
+
+		// Anything longer or outside of Latin-1 isn't a control message
+		if ((!Dart_IsString8(text)) ||
+		    (Dart_IsError(Dart_StringLength(text, &actualLength))) ||
+		    (actualLength > length) ||
+		    (Dart_IsError(Dart_StringGet8(text, characters, &length))))
+		{
+			message->type = ControlType::Unknown;
+			Dart_SetReturnValue(args, Dart_False());
+			return;
+		}
+
+		characters[length] = '\0';
+
+		bool parsed = GamePadSerialization::readControl(reinterpret_cast<const char*>(characters), message);
+
+		if (parsed && (message->type == ControlType::Vibration))
+		{
+			if (message->index < PlayerIndex::Size)
+				VibrationQueue::set(static_cast<PlayerIndex::Enum>(message->index), message->leftMotor, message->rightMotor);
+			else
+				parsed = false;
+		}
+
+		Dart_SetReturnValue(args, Dart_NewBoolean(parsed));
+	}
+
+	void ControlMessage_GetType(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(message->type));
+	}
+
+	void ControlMessage_GetIndex(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(message->index));
+	}
+
+	void ControlMessage_GetPads(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_SetReturnValue(args, Dart_NewInteger(message->pads));
+	}
+
+	void ControlMessage_GetTime(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_SetReturnValue(args, Dart_NewDouble(message->time));
+	}
+
+	void ControlMessage_IsBinary(Dart_NativeArguments args)
+	{
+		ControlMessage* message = 0;
+		getNativeField(args, 0, &message);
+
+		Dart_SetReturnValue(args, Dart_NewBoolean(message->binary));
+	}
+
+	void FrameClock_GetFramesPerSecond(Dart_NativeArguments args)
+	{
+		Dart_SetReturnValue(args, Dart_NewInteger(__framesPerSecond));
+	}
+
+	void FrameClock_NewServicePort(Dart_NativeArguments args)
+	{
+		ScopedLock lock(__clockMutex);
+
+		if (__clockServicePort == kIllegalPort)
+			__clockServicePort = Dart_NewNativePort("FrameClockService", __handleFrameClockMessage, false);
+
+		Dart_SetReturnValue(args, Dart_NewSendPort(__clockServicePort));
+	}
+
 	//---------------------------------------------------------------------
 	// Virtual machine entries
 	//---------------------------------------------------------------------
@@ -192,20 +969,26 @@ namespace
 	/// Whether the library has been initialized
 	bool __libraryInitialized = false;
 	/// Class entries for the input library
-	NativeClassEntry __libraryEntries[2];
+	NativeClassEntry __libraryEntries[6];
 
 	/// Native entries for the GamePad class
 	NativeEntry __gamePadNativeEntries[3];
+	/// Native entries for the GamePadFeed class
+	NativeEntry __gamePadFeedNativeEntries[9];
 	/// Native entries for the GamePadState class
-	NativeEntry __gamePadStateNativeEntries[10];
+	NativeEntry __gamePadStateNativeEntries[12];
+	/// Native entries for the ControlMessage class
+	NativeEntry __controlMessageNativeEntries[8];
+	/// Native entries for the FrameClock class
+	NativeEntry __frameClockNativeEntries[3];
 
 	/**
 	 * Setup hooks to the GamePad class entries.
 	 */
 	void __setupGamePadEntries()
 	{
-		setNativeEntry(&__gamePadNativeEntries[0], "GetState",     GamePad_GetState,     2);
-		setNativeEntry(&__gamePadNativeEntries[1], "SetVibration", GamePad_SetVibration, 3);
+		setNativeEntry(&__gamePadNativeEntries[0], "GetState",         GamePad_GetState,         2);
+		setNativeEntry(&__gamePadNativeEntries[1], "NewVibrationPort", GamePad_NewVibrationPort, 0);
 		// Set the sentinal value
 		setNativeEntry(&__gamePadNativeEntries[2], "", 0, 0);
 	}
@@ -215,17 +998,63 @@ namespace
 	 */
 	void __setupGamePadStateEntries()
 	{
-		setNativeEntry(&__gamePadStateNativeEntries[0], "New",                 GamePadState_New,                 1);
-		setNativeEntry(&__gamePadStateNativeEntries[1], "IsConnected",         GamePadState_IsConnected,         1);
-		setNativeEntry(&__gamePadStateNativeEntries[2], "GetLeftThumbstickX",  GamePadState_GetLeftThumbstickX,  1);
-		setNativeEntry(&__gamePadStateNativeEntries[3], "GetLeftThumbstickY",  GamePadState_GetLeftThumbstickY,  1);
-		setNativeEntry(&__gamePadStateNativeEntries[4], "GetRightThumbstickX", GamePadState_GetRightThumbstickX, 1);
-		setNativeEntry(&__gamePadStateNativeEntries[5], "GetRightThumbstickY", GamePadState_GetRightThumbstickY, 1);
-		setNativeEntry(&__gamePadStateNativeEntries[6], "GetLeftTrigger",      GamePadState_GetLeftTrigger,      1);
-		setNativeEntry(&__gamePadStateNativeEntries[7], "GetRightTrigger",     GamePadState_GetRightTrigger,     1);
-		setNativeEntry(&__gamePadStateNativeEntries[8], "GetButtons",          GamePadState_GetButtons,          1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 0], "New",                 GamePadState_New,                 1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 1], "IsConnected",         GamePadState_IsConnected,         1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 2], "GetLeftThumbstickX",  GamePadState_GetLeftThumbstickX,  1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 3], "GetLeftThumbstickY",  GamePadState_GetLeftThumbstickY,  1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 4], "GetRightThumbstickX", GamePadState_GetRightThumbstickX, 1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 5], "GetRightThumbstickY", GamePadState_GetRightThumbstickY, 1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 6], "GetLeftTrigger",      GamePadState_GetLeftTrigger,      1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 7], "GetRightTrigger",     GamePadState_GetRightTrigger,     1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 8], "GetButtons",          GamePadState_GetButtons,          1);
+		setNativeEntry(&__gamePadStateNativeEntries[ 9], "ToJson",              GamePadState_ToJson,              2);
+		setNativeEntry(&__gamePadStateNativeEntries[10], "GetPacketNumber",     GamePadState_GetPacketNumber,     1);
 		// Set the sentinal value
-		setNativeEntry(&__gamePadStateNativeEntries[9], "", 0, 0);
+		setNativeEntry(&__gamePadStateNativeEntries[11], "", 0, 0);
+	}
+
+	/**
+	 * Setup hooks to the GamePadFeed class entries.
+	 */
+	void __setupGamePadFeedEntries()
+	{
+		setNativeEntry(&__gamePadFeedNativeEntries[0], "New",        GamePadFeed_New,        2);
+		setNativeEntry(&__gamePadFeedNativeEntries[1], "Update",     GamePadFeed_Update,     1);
+		setNativeEntry(&__gamePadFeedNativeEntries[2], "GetIndex",   GamePadFeed_GetIndex,   1);
+		setNativeEntry(&__gamePadFeedNativeEntries[3], "GetVersion", GamePadFeed_GetVersion, 1);
+		setNativeEntry(&__gamePadFeedNativeEntries[4], "ToBytes",    GamePadFeed_ToBytes,    1);
+		setNativeEntry(&__gamePadFeedNativeEntries[5], "ToDelta",    GamePadFeed_ToDelta,    1);
+		setNativeEntry(&__gamePadFeedNativeEntries[6], "ToJson",     GamePadFeed_ToJson,     1);
+		setNativeEntry(&__gamePadFeedNativeEntries[7], "Combine",    GamePadFeed_Combine,    1);
+		// Set the sentinal value
+		setNativeEntry(&__gamePadFeedNativeEntries[8], "", 0, 0);
+	}
+
+	/**
+	 * Setup hooks to the ControlMessage class entries.
+	 */
+	void __setupControlMessageEntries()
+	{
+		setNativeEntry(&__controlMessageNativeEntries[0], "New",      ControlMessage_New,      1);
+		setNativeEntry(&__controlMessageNativeEntries[1], "Parse",    ControlMessage_Parse,    2);
+		setNativeEntry(&__controlMessageNativeEntries[2], "GetType",  ControlMessage_GetType,  1);
+		setNativeEntry(&__controlMessageNativeEntries[3], "GetIndex", ControlMessage_GetIndex, 1);
+		setNativeEntry(&__controlMessageNativeEntries[4], "GetPads",  ControlMessage_GetPads,  1);
+		setNativeEntry(&__controlMessageNativeEntries[5], "GetTime",  ControlMessage_GetTime,  1);
+		setNativeEntry(&__controlMessageNativeEntries[6], "IsBinary", ControlMessage_IsBinary, 1);
+		// Set the sentinal value
+		setNativeEntry(&__controlMessageNativeEntries[7], "", 0, 0);
+	}
+
+	/**
+	 * Setup hooks to the FrameClock class entries.
+	 */
+	void __setupFrameClockEntries()
+	{
+		setNativeEntry(&__frameClockNativeEntries[0], "GetFramesPerSecond", FrameClock_GetFramesPerSecond, 0);
+		setNativeEntry(&__frameClockNativeEntries[1], "NewServicePort",     FrameClock_NewServicePort,     0);
+		// Set the sentinal value
+		setNativeEntry(&__frameClockNativeEntries[2], "", 0, 0);
 	}
 
 	/**
@@ -233,10 +1062,13 @@ namespace
 	 */
 	void __setupClassEntries()
 	{
-		setNativeClassEntry(&__libraryEntries[0], "GamePad",      __gamePadNativeEntries);
-		setNativeClassEntry(&__libraryEntries[1], "GamePadState", __gamePadStateNativeEntries);
+		setNativeClassEntry(&__libraryEntries[0], "GamePad",        __gamePadNativeEntries);
+		setNativeClassEntry(&__libraryEntries[1], "GamePadState",   __gamePadStateNativeEntries);
+		setNativeClassEntry(&__libraryEntries[2], "GamePadFeed",    __gamePadFeedNativeEntries);
+		setNativeClassEntry(&__libraryEntries[3], "ControlMessage", __controlMessageNativeEntries);
+		setNativeClassEntry(&__libraryEntries[4], "FrameClock",     __frameClockNativeEntries);
 		// Set the sentinal value
-		setNativeClassEntry(&__libraryEntries[2], "", 0);
+		setNativeClassEntry(&__libraryEntries[5], "", 0);
 	}
 
 	/**
@@ -250,6 +1082,9 @@ namespace
 
 			__setupGamePadEntries();
 			__setupGamePadStateEntries();
+			__setupGamePadFeedEntries();
+			__setupControlMessageEntries();
+			__setupFrameClockEntries();
 		}
 
 		__libraryInitialized = true;
@@ -302,10 +1137,39 @@ namespace
 
 //---------------------------------------------------------------------
 
-void EmbedLibraries::createInputLibrary()
+void EmbedLibraries::createInputLibrary(std::uint32_t framesPerSecond)
 {
 	// Setup the native entries
 	__setupInputLibrary();
 
+	if (framesPerSecond > 0)
+		__framesPerSecond = std::min(framesPerSecond, MaxFramesPerSecond);
+
 	VirtualMachine::loadScriptLibrary("embed:input", __sourceCode, __inputLibraryResolver);
 }
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::terminateInputLibrary()
+{
+	__clockMutex.lock();
+
+	if (__clockServicePort != kIllegalPort)
+		Dart_CloseNativePort(__clockServicePort);
+
+	__clockServicePort = kIllegalPort;
+	__clockSubscribers.clear();
+	__clockShutdown = true;
+	__clockChanged.signal();
+
+	__clockMutex.unlock();
+
+	__clockThread.join();
+
+	ScopedLock lock(__vibrationMutex);
+
+	if (__vibrationPort != kIllegalPort)
+		AsyncNatives::closePort(__vibrationPort);
+
+	__vibrationPort = kIllegalPort;
+}
@@ -33,6 +33,7 @@
 #include <DartEmbed/VirtualMachine.hpp>
 #include <vector>
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #define NOKERNEL
@@ -42,17 +43,45 @@
 #define NOMCX
 
 #include <windows.h>
+#else
+#include <climits>
+#include <unistd.h>
+#endif
 
 #include "dart_api.h"
-#include "isolate_data.h"
+#include "EmbedIsolateData.hpp"
 #include "NativeResolution.hpp"
 #include "ScriptLibrary.hpp"
 #include "BuiltinLibraries.hpp"
+#include "UriResolution.hpp"
+#include "IsolatePool.hpp"
+#include "Thread.hpp"
+#include "StartupReport.hpp"
+#include "Clock.hpp"
+#include "Shards.hpp"
+#include "Watchdog.hpp"
+#include <algorithm>
 using namespace DartEmbed;
 
 /// The snapshot data
 extern const uint8_t* snapshot_buffer;
 
+/**
+ * Handles I/O for dart:io within an isolate.
+ *
+ * Provided by the Dart runtime, which starts one for an isolate the first
+ * time dart:io needs it.
+ */
+class EventHandler
+{
+	public:
+
+		/**
+		 * Stops the event handler, which frees itself once stopped.
+		 */
+		void Shutdown();
+} ;
+
 namespace
 {
 	//----------------------------------------------------------------------
@@ -65,6 +94,12 @@ namespace
 	bool __initialized = false;
 	/// The isolates currently running in the virtual machine
 	std::vector<Isolate*> __runningIsolates;
+	/// Guards the running isolates as pooled isolates are created on another thread
+	Mutex __runningIsolatesMutex;
+	/// Whether a function has been invoked, marking the end of startup
+	bool __functionInvoked = false;
+	/// When scripts are compiled ahead of their first use
+	WarmUpMode::Enum __warmUpMode = WarmUpMode::Disabled;
 
 	//----------------------------------------------------------------------
 	// ScriptLibrary instances
@@ -82,24 +117,101 @@ namespace
 	ScriptLibrary* __cryptoLibrary;
 	/// The dart:utf library
 	ScriptLibrary* __utfLibrary;
+	/// The dart:isolate library
+	ScriptLibrary* __isolateLibrary;
 
 	/// Any additional libraries specified
 	std::vector<ScriptLibrary*> __libraries;
+	/// Maps the URL of a library to the ScriptLibrary providing it
+	StringMap<ScriptLibrary*> __libraryRegistry;
+
+	/**
+	 * Creates one of the builtin libraries while timing it.
+	 *
+	 * \param name The name of the phase.
+	 * \param create The function creating the library.
+	 * \returns The library that was created.
+	 */
+	ScriptLibrary* __createBuiltinLibrary(const char* name, ScriptLibrary* (*create)())
+	{
+		StartupPhase phase(name);
+		return create();
+	}
+
+	//----------------------------------------------------------------------
+	// Library binding
+	//----------------------------------------------------------------------
+
+	/**
+	 * Loads a library into the current isolate if it hasn't been already.
+	 *
+	 * Libraries are bound to an isolate lazily, the first time they're
+	 * referenced, so isolates only pay for the libraries they use.
+	 *
+	 * \param scriptLibrary The library to load.
+	 * \returns The library if no error occurs; an error handle otherwise.
+	 */
+	Dart_Handle __bindLibrary(ScriptLibrary* scriptLibrary)
+	{
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+		const char* name = scriptLibrary->getName();
+
+		CanonicalUrl* entry = isolateData->canonicalUrls.find(name);
+
+		if (!entry)
+		{
+			CanonicalUrl value = { scriptLibrary, false };
+			entry = isolateData->canonicalUrls.insert(name, value);
+		}
+
+		if (entry->loaded)
+			return Dart_LookupLibrary(Dart_NewString(name));
+
+		// Mark the library before loading as the initializer can recurse
+		entry->loaded = true;
+
+		Dart_Handle library = scriptLibrary->load();
+
+		// The cache may have grown while loading so look the entry up again
+		if (Dart_IsError(library))
+			isolateData->canonicalUrls.find(name)->loaded = false;
+
+		return library;
+	}
+
+	/**
+	 * Initialize the dart:isolate library.
+	 *
+	 * Timers within dart:isolate are created through a factory that
+	 * dart:io provides so it needs to be bound as well.
+	 *
+	 * \param library The isolate library to initialize.
+	 */
+	void __isolateLibraryInitializer(Dart_Handle library)
+	{
+		__bindLibrary(__ioLibrary);
+	}
 
 	//----------------------------------------------------------------------
 	// URI/URL functions
 	//----------------------------------------------------------------------
 
+	/**
+	 * Whether the host uses Windows path rules.
+	 *
+	 * \returns Dart_True if the host is Windows; Dart_False otherwise.
+	 */
+	inline Dart_Handle __isWindowsHost()
+	{
+		return Dart_NewBoolean(UriResolution::getHostPathStyle() == PathStyle::Windows);
+	}
+
 	/**
 	 * Resolves the script's URI.
 	 *
 	 * Invokes _resolveScriptUri from within the core library to determine the
-	 * full URI to the file.
-	 *
-	 * \note Could be moved to aux lib. Should be overloadable assuming that
-	 *       _resolveScriptUri doesn't have to be invoked. This would allow
-	 *       for embedders who already have their own URI implementation and
-	 *       file system accessor to be used.
+	 * full URI to the file. Only used when the native resolution can't handle
+	 * the URI.
 	 *
 	 * \param scriptUri The path to the script.
 	 * \param coreLibrary Handle to the core library.
@@ -112,7 +224,7 @@ namespace
 		Dart_Handle args[numberOfArgs];
 		args[0] = Dart_NewString(__currentDirectory);
 		args[1] = Dart_NewString(scriptUri);
-		args[2] = Dart_True(); // Windows host is always true
+		args[2] = __isWindowsHost();
 
 		return Dart_Invoke(coreLibrary, Dart_NewString("_resolveScriptUri"), numberOfArgs, args);
 	}
@@ -121,12 +233,8 @@ namespace
 	 * Determines the file path from the given URI.
 	 *
 	 * Invokes _filePathFromUri from within the core library to determine the
-	 * path to the file.
-	 *
-	 * \note Could be moved to aux lib. Should be overloadable assuming that
-	 *       _filePathFromUri doesn't have to be invoked. This would allow
-	 *       for embedders who already have their own URI implementation and
-	 *       file system accessor to be used.
+	 * path to the file. Only used when the native resolution can't handle
+	 * the URI.
 	 *
 	 * \param scriptUri URI to the script.
 	 * \param coreLibrary Handle to the core library.
@@ -137,11 +245,94 @@ namespace
 		const std::int32_t numberOfArgs = 2;
 		Dart_Handle args[numberOfArgs];
 		args[0] = scriptUri;
-		args[1] = Dart_True(); // Windows host is always true
+		args[1] = __isWindowsHost();
 
 		return Dart_Invoke(coreLibrary, Dart_NewString("_filePathFromUri"), numberOfArgs, args);
 	}
 
+	/**
+	 * Copies the contents of a Dart string into a buffer.
+	 *
+	 * \param string The string to copy.
+	 * \param buffer The buffer to copy into.
+	 * \param size The size of the buffer.
+	 * \returns A valid handle if no error occurs during the operation.
+	 */
+	Dart_Handle __copyString(Dart_Handle string, char* buffer, std::size_t size)
+	{
+		const char* value;
+		Dart_Handle result = Dart_StringToCString(string, &value);
+
+		if (Dart_IsError(result))
+			return result;
+
+		if (strlen(value) >= size)
+			return Dart_Error("URI is too long '%s'", value);
+
+		strcpy(buffer, value);
+
+		return result;
+	}
+
+	/**
+	 * Determines the URI and file path of a script.
+	 *
+	 * The native resolver is used first. If it is unable to handle the
+	 * URI then the dart:builtin implementation is used, which binds the
+	 * library to the isolate.
+	 *
+	 * \param scriptUri The path to the script.
+	 * \param resolve Whether the script's location needs to be resolved.
+	 * \param uri Buffer to hold the URI of the script.
+	 * \param path Buffer to hold the file path of the script.
+	 * \returns A valid handle if no error occurs during the operation.
+	 */
+	Dart_Handle __resolveScript(const char* scriptUri, bool resolve, char* uri, char* path)
+	{
+		const std::size_t size = UriResolution::MaxLength;
+		PathStyle::Enum style = UriResolution::getHostPathStyle();
+
+		bool resolved = false;
+
+		if (resolve)
+		{
+			resolved = UriResolution::resolveScriptUri(__currentDirectory, scriptUri, style, uri, size);
+		}
+		else if (strlen(scriptUri) < size)
+		{
+			strcpy(uri, scriptUri);
+			resolved = true;
+		}
+
+		if (resolved && UriResolution::filePathFromUri(uri, style, path, size))
+			return Dart_Null();
+
+		// Fall back to dart:builtin
+		Dart_Handle coreLibrary = __bindLibrary(__coreLibrary);
+
+		if (Dart_IsError(coreLibrary))
+			return coreLibrary;
+
+		Dart_Handle resolvedScriptUri = (resolve)
+			? __resolveScriptUri(scriptUri, coreLibrary)
+			: Dart_NewString(scriptUri);
+
+		if (Dart_IsError(resolvedScriptUri))
+			return resolvedScriptUri;
+
+		Dart_Handle scriptPath = __filePathFromUri(resolvedScriptUri, coreLibrary);
+
+		if (Dart_IsError(scriptPath))
+			return scriptPath;
+
+		Dart_Handle result = __copyString(resolvedScriptUri, uri, size);
+
+		if (Dart_IsError(result))
+			return result;
+
+		return __copyString(scriptPath, path, size);
+	}
+
 	/**
 	 * Detemines if the URL signifies a Dart library.
 	 *
@@ -158,22 +349,16 @@ namespace
 	//----------------------------------------------------------------------
 
 	/**
-	 * Reads the source from the given URI.
+	 * Reads the source from the given path.
 	 *
 	 * \note Could be moved to the aux lib. Should be overloadable so file handling
 	 *       can be handled by the embedder.
 	 *
-	 * \param scriptUri URI for the script.
-	 * \param coreLibrary Handle to the core library.
+	 * \param scriptPath Path to the script.
 	 */
-	Dart_Handle __readSource(Dart_Handle scriptUri, Dart_Handle coreLibrary)
+	Dart_Handle __readSource(const char* scriptPath)
 	{
-		Dart_Handle scriptPath = __filePathFromUri(scriptUri, coreLibrary);
-
-		const char* scriptPathString;
-		Dart_StringToCString(scriptPath, &scriptPathString);
-
-		FILE* file = fopen(scriptPathString, "r");
+		FILE* file = fopen(scriptPath, "r");
 
 		if (file)
 		{
@@ -193,7 +378,7 @@ namespace
 			return source;
 		}
 
-		return Dart_Error("Unable to read file");
+		return Dart_Error("Unable to read file '%s'", scriptPath);
 	}
 
 	/**
@@ -201,34 +386,38 @@ namespace
 	 *
 	 * \param scriptUri URI pointing to the script's location.
 	 * \param resolve Whether the script's location needs to be resolved.
-	 * \param coreLibrary The dart:core library.
 	 */
-	Dart_Handle __loadScript(const char* scriptUri, bool resolve, Dart_Handle coreLibrary)
+	Dart_Handle __loadScript(const char* scriptUri, bool resolve)
 	{
-		Dart_Handle resolvedScriptUri;
+		char resolvedScriptUri[UriResolution::MaxLength];
+		char scriptPath[UriResolution::MaxLength];
 
-		if (resolve)
-		{
-			resolvedScriptUri = __resolveScriptUri(scriptUri, coreLibrary);
+		Dart_Handle result;
 
-			if (Dart_IsError(resolvedScriptUri))
-			{
-				return resolvedScriptUri;
-			}
+		{
+			StartupPhase phase("resolve", scriptUri);
+			result = __resolveScript(scriptUri, resolve, resolvedScriptUri, scriptPath);
 		}
-		else
+
+		if (Dart_IsError(result))
 		{
-			resolvedScriptUri = Dart_NewString(scriptUri);
+			return result;
 		}
 
-		Dart_Handle source = __readSource(resolvedScriptUri, coreLibrary);
+		Dart_Handle source;
+
+		{
+			StartupPhase phase("read", scriptPath);
+			source = __readSource(scriptPath);
+		}
 
 		if (Dart_IsError(source))
 		{
 			return source;
 		}
 
-		return Dart_LoadScript(resolvedScriptUri, source);
+		StartupPhase phase("compile", resolvedScriptUri);
+		return Dart_LoadScript(Dart_NewString(resolvedScriptUri), source);
 	}
 
 	//----------------------------------------------------------------------
@@ -249,40 +438,43 @@ namespace
 
 		if (Dart_IsError(result))
 			return result;
-		bool isDartScheme = __isDartSchemeUrl(urlString);
 
-		if (tag == kCanonicalizeUrl)
-		{
-			if (isDartScheme)
-				return url;
+		// See if the URL was seen before within the isolate
+		EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData());
+		CanonicalUrl* entry = isolateData->canonicalUrls.find(urlString);
 
+		if (!entry)
+		{
 			// Check other libraries that were added
-			std::int32_t hash = fnv1aHash(urlString);
-			std::size_t count = __libraries.size();
+			ScriptLibrary** registered = __libraryRegistry.find(urlString);
 
-			for (std::size_t i = 0; i < count; ++i)
-			{
-				ScriptLibrary* library = __libraries[i];
+			if (!registered && !__isDartSchemeUrl(urlString))
+				return Dart_Error("Do not know how to load '%s'", urlString);
 
-				if (hash == library->getHashedName())
-					return url;
-			}
+			CanonicalUrl value = { (registered) ? *registered : 0, false };
+			entry = isolateData->canonicalUrls.insert(urlString, value);
 		}
-		else
-		{
-			// Check other libraries that were added
-			std::int32_t hash = fnv1aHash(urlString);
-			std::size_t count = __libraries.size();
 
-			for (std::size_t i = 0; i < count; ++i)
+		ScriptLibrary* scriptLibrary = entry->library;
+
+		if (tag == kCanonicalizeUrl)
+		{
+			// Libraries within the snapshot are already present so an import
+			// tag is never received for them. Bind on first reference instead.
+			if (scriptLibrary)
 			{
-				ScriptLibrary* library = __libraries[i];
+				Dart_Handle loaded = __bindLibrary(scriptLibrary);
 
-				if (hash == library->getHashedName())
-					return library->load();
+				if (Dart_IsError(loaded))
+					return loaded;
 			}
+
+			return url;
 		}
 
+		if (scriptLibrary)
+			return __bindLibrary(scriptLibrary);
+
 		return Dart_Error("Do not know how to load '%s'", urlString);
 	}
 
@@ -292,11 +484,16 @@ namespace
 // Isolate methods
 //----------------------------------------------------------------------
 
-Isolate::Isolate(Dart_Isolate isolate, Dart_Handle library, Isolate* parent)
+Isolate::Isolate(Dart_Isolate isolate, Dart_Handle library, Isolate* parent, EmbedIsolateData* data)
 	: _isolate(isolate)
 	, _library(library)
 	, _parent(parent)
+	, _data(data)
 {
+	_data->isolate = this;
+
+	ScopedLock lock(__runningIsolatesMutex);
+
 	__runningIsolates.push_back(this);
 }
 
@@ -304,23 +501,81 @@ Isolate::Isolate(Dart_Isolate isolate, Dart_Handle library, Isolate* parent)
 
 Isolate::~Isolate()
 {
-	//Dart_ExitScope();
+	{
+		ScopedLock lock(__runningIsolatesMutex);
 
-	//Dart_EnterIsolate(_isolate);
-	//Dart_ShutdownIsolate();
+		std::vector<Isolate*>::iterator found = std::find(__runningIsolates.begin(), __runningIsolates.end(), this);
+
+		if (found != __runningIsolates.end())
+			__runningIsolates.erase(found);
+
+		// Children can outlive their parent
+		std::size_t count = __runningIsolates.size();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (__runningIsolates[i]->_parent == this)
+				__runningIsolates[i]->_parent = 0;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Isolate::setParent(Isolate* parent)
+{
+	ScopedLock lock(__runningIsolatesMutex);
+
+	_parent = parent;
+}
+
+//----------------------------------------------------------------------
+
+void Isolate::shutdown()
+{
+	Watchdog::detach(_isolate);
+
+	Dart_Isolate current = Dart_CurrentIsolate();
+
+	if (current != _isolate)
+	{
+		if (current)
+			Dart_ExitIsolate();
+
+		Dart_EnterIsolate(_isolate);
+	}
+
+	// Deletes this instance through isolateShutdownCallback
+	Dart_ShutdownIsolate();
 }
 
 //----------------------------------------------------------------------
 
 void Isolate::invokeFunction(const char* name)
 {
+	bool firstInvoke;
+
+	{
+		ScopedLock lock(__runningIsolatesMutex);
+
+		firstInvoke = !__functionInvoked;
+		__functionInvoked = true;
+	}
+
 	Dart_EnterScope();
-	Dart_Handle result = Dart_Invoke(_library, Dart_NewString(name), 0, NULL);
+	Dart_Handle result;
+
+	{
+		StartupPhase phase((firstInvoke) ? "invokeFunction" : 0, name);
+		result = Dart_Invoke(_library, Dart_NewString(name), 0, NULL);
+	}
+
+	// Startup is over once the first function returns
+	if (firstInvoke)
+		StartupReport::writeToOutputPath();
 
-	// Run the main loop
-	// This should probably be somewhere else.
-	// Wondering how requestAnimationFrame handles this situation.
-	Dart_RunLoop();
+	if (Dart_IsError(result))
+		printf("%s\n", Dart_GetError(result));
 
 	Dart_ExitScope();
 }
@@ -330,13 +585,41 @@ void Isolate::invokeFunction(const char* name)
 Isolate* Isolate::loadScript(const char* path)
 {
 	char* error = 0;
-	return createIsolate(path, "main", true, new IsolateData(), &error);
+	Isolate* isolate = createIsolate(path, "main", true, 0, &error);
+
+	// Compile before main runs so nothing it serves stalls on the compiler
+	if (isolate && (__warmUpMode == WarmUpMode::Startup))
+		compileAll(path);
+
+	return isolate;
 }
 
 //----------------------------------------------------------------------
 
-Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool resolveScript, void* data, char** error)
+bool Isolate::compileAll(const char* scriptUri)
 {
+	std::uint64_t start = Clock::getMicroseconds();
+	Dart_Handle result = Dart_CompileAll();
+	std::uint64_t end = Clock::getMicroseconds();
+
+	StartupReport::record("Dart_CompileAll", scriptUri, start, end);
+
+	if (Dart_IsError(result))
+	{
+		printf("Warm-up of %s failed: %s\n", scriptUri, Dart_GetError(result));
+		return false;
+	}
+
+	printf("Warm-up of %s took %llu us\n", scriptUri, static_cast<unsigned long long>(end - start));
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool resolveScript, Isolate* parent, char** error)
+{
+	// Freed by isolateShutdownCallback, including when creation fails below
+	EmbedIsolateData* data = new EmbedIsolateData();
 	Dart_Isolate isolate = Dart_CreateIsolate(scriptUri, main, snapshot_buffer, data, error);
 
 	if (isolate)
@@ -356,45 +639,24 @@ Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool re
 
 		// Should an import map be created?
 
-		// Setup URI library
-		Dart_Handle uriLibrary = __uriLibrary->load();
+		// Load the script into the isolate
+		// The builtin libraries are bound as the script imports them
+		Dart_Handle library = __loadScript(scriptUri, resolveScript);
 
-		if (Dart_IsError(uriLibrary))
+		if (Dart_IsError(library))
 		{
-			*error = strdup(Dart_GetError(result));
+			*error = strdup(Dart_GetError(library));
 			Dart_ExitScope();
 			Dart_ShutdownIsolate();
 			return 0;
 		}
 
 		// Setup core builtin library
-		Dart_Handle coreLibrary = __coreLibrary->load();
+		Dart_Handle coreLibrary = __bindLibrary(__coreLibrary);
 
 		if (Dart_IsError(coreLibrary))
 		{
-			*error = strdup(Dart_GetError(result));
-			Dart_ExitScope();
-			Dart_ShutdownIsolate();
-			return 0;
-		}
-
-		// Setup IO library
-		Dart_Handle ioLibrary = __ioLibrary->load();
-
-		if (Dart_IsError(ioLibrary))
-		{
-			*error = strdup(Dart_GetError(result));
-			Dart_ExitScope();
-			Dart_ShutdownIsolate();
-			return 0;
-		}
-
-		// Load the script into the isolate
-		Dart_Handle library = __loadScript(scriptUri, resolveScript, coreLibrary);
-
-		if (Dart_IsError(library))
-		{
-			*error = strdup(Dart_GetError(library));
+			*error = strdup(Dart_GetError(coreLibrary));
 			Dart_ExitScope();
 			Dart_ShutdownIsolate();
 			return 0;
@@ -407,7 +669,7 @@ Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool re
 
 		if (Dart_IsError(result))
 		{
-			*error = strdup(Dart_GetError(library));
+			*error = strdup(Dart_GetError(result));
 			Dart_ExitScope();
 			Dart_ShutdownIsolate();
 			return 0;
@@ -415,9 +677,11 @@ Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool re
 
 		//Dart_ExitScope();
 
-		return new Isolate(isolate, library, static_cast<Isolate*>(data));
+		return new Isolate(isolate, library, parent, data);
 	}
 
+	delete data;
+
 	return 0;
 }
 
@@ -425,7 +689,13 @@ Isolate* Isolate::createIsolate(const char* scriptUri, const char* main, bool re
 
 bool Isolate::isolateCreateCallback(const char* scriptUri, const char* main, void* callbackData, char** error)
 {
-	Isolate* isolate = createIsolate(scriptUri, main, true, new IsolateData(), error);
+	EmbedIsolateData* parentData = static_cast<EmbedIsolateData*>(callbackData);
+
+	// See if a pre-warmed isolate is available
+	if (IsolatePool::claim(scriptUri, parentData))
+		return true;
+
+	Isolate* isolate = createIsolate(scriptUri, main, true, (parentData) ? parentData->isolate : 0, error);
 
 	// See if the isolate was created successfully
 	return isolate != 0;
@@ -435,7 +705,17 @@ bool Isolate::isolateCreateCallback(const char* scriptUri, const char* main, voi
 
 void Isolate::isolateShutdownCallback(void* callbackData)
 {
-	
+	EmbedIsolateData* isolateData = static_cast<EmbedIsolateData*>(callbackData);
+
+	if (!isolateData)
+		return;
+
+	if (isolateData->event_handler)
+		isolateData->event_handler->Shutdown();
+
+	// The isolate is 0 if creation failed after Dart_CreateIsolate
+	delete isolateData->isolate;
+	delete isolateData;
 }
 
 //----------------------------------------------------------------------
@@ -446,22 +726,55 @@ bool VirtualMachine::initialize()
 {
 	if (!__initialized)
 	{
-		if (Dart_SetVMFlags(0, 0))
+		bool flagsSet;
+
+		{
+			StartupPhase phase("Dart_SetVMFlags");
+			flagsSet = Dart_SetVMFlags(0, 0);
+		}
+
+		if (flagsSet)
 		{
-			if (Dart_Initialize(Isolate::isolateCreateCallback, 0, Isolate::isolateShutdownCallback))
+			bool vmInitialized;
+
+			{
+				StartupPhase phase("Dart_Initialize");
+				vmInitialized = Dart_Initialize(Isolate::isolateCreateCallback, Watchdog::interruptCallback, Isolate::isolateShutdownCallback);
+			}
+
+			if (vmInitialized)
 			{
 				// Setup the core libraries
-				__coreLibrary   = BuiltinLibraries::createCoreLibrary();
-				__ioLibrary     = BuiltinLibraries::createIOLibrary();
-				__jsonLibrary   = BuiltinLibraries::createJsonLibrary();
-				__uriLibrary    = BuiltinLibraries::createUriLibrary();
-				__cryptoLibrary = BuiltinLibraries::createCryptoLibrary();
-				__utfLibrary    = BuiltinLibraries::createUtfLibrary();
+				__coreLibrary   = __createBuiltinLibrary("createCoreLibrary",   BuiltinLibraries::createCoreLibrary);
+				__ioLibrary     = __createBuiltinLibrary("createIOLibrary",     BuiltinLibraries::createIOLibrary);
+				__jsonLibrary   = __createBuiltinLibrary("createJsonLibrary",   BuiltinLibraries::createJsonLibrary);
+				__uriLibrary    = __createBuiltinLibrary("createUriLibrary",    BuiltinLibraries::createUriLibrary);
+				__cryptoLibrary = __createBuiltinLibrary("createCryptoLibrary", BuiltinLibraries::createCryptoLibrary);
+				__utfLibrary    = __createBuiltinLibrary("createUtfLibrary",    BuiltinLibraries::createUtfLibrary);
+
+				// dart:isolate needs the timer factory from dart:io
+				__isolateLibrary = new ScriptLibrary("dart:isolate", 0, 0, __isolateLibraryInitializer);
+
+				// Register the libraries so they're bound on first use
+				__libraryRegistry.insert(__coreLibrary->getName(),    __coreLibrary);
+				__libraryRegistry.insert(__ioLibrary->getName(),      __ioLibrary);
+				__libraryRegistry.insert(__jsonLibrary->getName(),    __jsonLibrary);
+				__libraryRegistry.insert(__uriLibrary->getName(),     __uriLibrary);
+				__libraryRegistry.insert(__cryptoLibrary->getName(),  __cryptoLibrary);
+				__libraryRegistry.insert(__utfLibrary->getName(),     __utfLibrary);
+				__libraryRegistry.insert(__isolateLibrary->getName(), __isolateLibrary);
 
 				// Get the current directory
+#ifdef _WIN32
 				std::int32_t length = GetCurrentDirectory(0, 0);
 				__currentDirectory = new char[length];
 				GetCurrentDirectory(length + 1, __currentDirectory);
+#else
+				__currentDirectory = new char[PATH_MAX];
+
+				if (!getcwd(__currentDirectory, PATH_MAX))
+					__currentDirectory[0] = '\0';
+#endif
 
 				__initialized = true;
 			}
@@ -477,6 +790,15 @@ void VirtualMachine::terminate()
 {
 	if (__initialized)
 	{
+		// Stop the serving isolates
+		Shards::stop();
+
+		// Shutdown any pooled isolates
+		IsolatePool::terminate();
+
+		// Stop expiring timers
+		BuiltinLibraries::terminateIOLibrary();
+
 		// Shutdown the libraries
 		delete __coreLibrary;
 		delete __ioLibrary;
@@ -484,6 +806,7 @@ void VirtualMachine::terminate()
 		delete __uriLibrary;
 		delete __cryptoLibrary;
 		delete __utfLibrary;
+		delete __isolateLibrary;
 
 		std::size_t count = __libraries.size();
 
@@ -491,6 +814,7 @@ void VirtualMachine::terminate()
 			delete __libraries[i];
 
 		__libraries.clear();
+		__libraryRegistry.clear();
 	}
 
 	__initialized = false;
@@ -507,11 +831,111 @@ void VirtualMachine::loadScriptLibrary(
 	ScriptLibrary* library = new ScriptLibrary(name, source, nativeResolver, initializer);
 
 	__libraries.push_back(library);
+	__libraryRegistry.insert(name, library);
 }
 
 //----------------------------------------------------------------------
 
 std::size_t VirtualMachine::getNumberOfIsolates()
 {
+	ScopedLock lock(__runningIsolatesMutex);
+
 	return __runningIsolates.size();
 }
+
+//----------------------------------------------------------------------
+
+std::size_t VirtualMachine::getIsolateMemoryUsage(IsolateMemoryUsage* usage, std::size_t count)
+{
+	ScopedLock lock(__runningIsolatesMutex);
+
+	std::size_t running = __runningIsolates.size();
+	std::size_t filled = std::min(running, count);
+
+	for (std::size_t i = 0; i < filled; ++i)
+	{
+		Isolate* isolate = __runningIsolates[i];
+		EmbedIsolateData* isolateData = isolate->_data;
+
+		usage[i].isolate       = isolate->_isolate;
+		usage[i].shard         = isolateData->shard;
+		usage[i].nativeObjects = isolateData->getNumberOfNativeObjects();
+		usage[i].nativeBytes   = isolateData->getNativeBytes();
+	}
+
+	return running;
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::setIsolatePoolSize(const char* path, std::size_t size)
+{
+	char scriptUri[UriResolution::MaxLength];
+
+	if (UriResolution::resolveScriptUri(__currentDirectory, path, UriResolution::getHostPathStyle(), scriptUri, sizeof(scriptUri)))
+		IsolatePool::setSize(scriptUri, size);
+}
+
+//----------------------------------------------------------------------
+
+bool VirtualMachine::getIsolatePoolStatistics(const char* path, IsolatePoolStatistics* statistics)
+{
+	char scriptUri[UriResolution::MaxLength];
+
+	if (UriResolution::resolveScriptUri(__currentDirectory, path, UriResolution::getHostPathStyle(), scriptUri, sizeof(scriptUri)))
+		return IsolatePool::getStatistics(scriptUri, statistics);
+
+	return false;
+}
+
+//----------------------------------------------------------------------
+
+bool VirtualMachine::startShards(const char* path, std::size_t count)
+{
+	if (count == 0)
+		count = Thread::getNumberOfProcessors();
+
+	return Shards::start(path, count);
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::stopShards()
+{
+	Shards::stop();
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::setStartupReportPath(const char* path)
+{
+	StartupReport::setOutputPath(path);
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::writeStartupReport(FILE* stream)
+{
+	StartupReport::write(stream);
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::setWarmUpMode(WarmUpMode::Enum mode)
+{
+	__warmUpMode = mode;
+}
+
+//----------------------------------------------------------------------
+
+WarmUpMode::Enum VirtualMachine::getWarmUpMode()
+{
+	return __warmUpMode;
+}
+
+//----------------------------------------------------------------------
+
+void VirtualMachine::setTimerResolution(std::uint32_t milliseconds)
+{
+	BuiltinLibraries::setTimerResolution(milliseconds);
+}
@@ -0,0 +1,336 @@
+/**
+ * \file IsolatePool.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "IsolatePool.hpp"
+#include <DartEmbed/Isolate.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "dart_api.h"
+#include "Clock.hpp"
+#include "EmbedIsolateData.hpp"
+#include "StringMap.hpp"
+#include "ThreadConfiguration.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// Time to wait before retrying a script that failed to load in milliseconds
+	const std::uint32_t __retryDelay = 1000;
+
+	/**
+	 * Isolates kept ready for a single script.
+	 */
+	struct Pool
+	{
+		/// The URI of the script
+		char* scriptUri;
+		/// The number of isolates to keep ready
+		std::size_t size;
+		/// The number of isolates currently being created
+		std::size_t pending;
+		/// Isolates ready to be claimed
+		std::vector<Isolate*> isolates;
+		/// Spawn requests served from the pool
+		std::uint64_t hits;
+		/// Spawn requests that found the pool empty
+		std::uint64_t misses;
+		/// Isolates that failed to be created
+		std::uint64_t failures;
+		/// The time in microseconds before which a failed script isn't retried
+		std::uint64_t retryTime;
+	} ; // end struct Pool
+
+	/// Guards all of the pool state
+	Mutex __mutex;
+	/// Signaled when a pool needs refilling or on shutdown
+	ConditionVariable __refillRequested;
+	/// Thread that refills the pools
+	Thread __refillThread;
+	/// Whether the refill thread should exit
+	bool __shutdown = false;
+
+	/// Maps the URI of a script to its pool
+	StringMap<Pool*> __poolsByUri;
+	/// All of the pools
+	std::vector<Pool*> __pools;
+	/// The index of the pool to look at first when refilling
+	std::size_t __nextPool = 0;
+
+	/**
+	 * Finds a pool that needs another isolate.
+	 *
+	 * Pools are visited in turn starting after the last one refilled so a
+	 * single pool can't starve the others. Pools whose script recently
+	 * failed to load are skipped until their retry time.
+	 *
+	 * The mutex must be held by the caller.
+	 *
+	 * \param now The current time in microseconds.
+	 * \param retryTime Set to the earliest retry time of a skipped pool; 0 if none were skipped.
+	 * \returns A pool below its size; 0 if no pool can be refilled now.
+	 */
+	Pool* __findPoolToRefill(std::uint64_t now, std::uint64_t* retryTime)
+	{
+		std::size_t count = __pools.size();
+
+		*retryTime = 0;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::size_t index = (__nextPool + i) % count;
+			Pool* pool = __pools[index];
+
+			if (pool->isolates.size() + pool->pending >= pool->size)
+				continue;
+
+			if (pool->retryTime > now)
+			{
+				if ((*retryTime == 0) || (pool->retryTime < *retryTime))
+					*retryTime = pool->retryTime;
+
+				continue;
+			}
+
+			__nextPool = (index + 1) % count;
+			return pool;
+		}
+
+		return 0;
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+void IsolatePool::setSize(const char* scriptUri, std::size_t size)
+{
+	ScopedLock lock(__mutex);
+
+	Pool** found = __poolsByUri.find(scriptUri);
+	Pool* pool;
+
+	if (found)
+	{
+		pool = *found;
+	}
+	else
+	{
+		pool = new Pool();
+		pool->scriptUri = strdup(scriptUri);
+
+		__poolsByUri.insert(scriptUri, pool);
+		__pools.push_back(pool);
+	}
+
+	pool->size = size;
+
+	if (!__refillThread.isStarted())
+	{
+		__shutdown = false;
+		__refillThread.start(refill, 0, ThreadConfiguration::getOptions(ThreadRole::IsolatePool));
+	}
+
+	__refillRequested.signal();
+}
+
+//----------------------------------------------------------------------
+
+bool IsolatePool::claim(const char* scriptUri, EmbedIsolateData* parentData)
+{
+	Isolate* isolate = 0;
+
+	{
+		ScopedLock lock(__mutex);
+
+		Pool** found = __poolsByUri.find(scriptUri);
+
+		if (!found)
+			return false;
+
+		Pool* pool = *found;
+
+		if (pool->isolates.empty())
+		{
+			pool->misses++;
+			return false;
+		}
+
+		isolate = pool->isolates.back();
+		pool->isolates.pop_back();
+		pool->hits++;
+
+		__refillRequested.signal();
+	}
+
+	// Pooled isolates are created without a parent
+	isolate->setParent((parentData) ? parentData->isolate : 0);
+
+	// Restore the state createIsolate leaves the isolate in
+	Dart_EnterIsolate(isolate->_isolate);
+	Dart_EnterScope();
+
+	// The library handle belonged to the scope used when loading
+	isolate->_library = Dart_RootLibrary();
+
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+bool IsolatePool::getStatistics(const char* scriptUri, IsolatePoolStatistics* statistics)
+{
+	ScopedLock lock(__mutex);
+
+	Pool** found = __poolsByUri.find(scriptUri);
+
+	if (!found)
+		return false;
+
+	Pool* pool = *found;
+
+	statistics->hits      = pool->hits;
+	statistics->misses    = pool->misses;
+	statistics->failures  = pool->failures;
+	statistics->available = pool->isolates.size();
+	statistics->size      = pool->size;
+
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+void IsolatePool::terminate()
+{
+	__mutex.lock();
+	__shutdown = true;
+	__refillRequested.broadcast();
+	__mutex.unlock();
+
+	__refillThread.join();
+
+	// Shutdown any isolates that were never claimed
+	std::size_t count = __pools.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Pool* pool = __pools[i];
+		std::size_t isolateCount = pool->isolates.size();
+
+		for (std::size_t j = 0; j < isolateCount; ++j)
+		{
+			pool->isolates[j]->shutdown();
+		}
+
+		free(pool->scriptUri);
+		delete pool;
+	}
+
+	__pools.clear();
+	__poolsByUri.clear();
+	__nextPool = 0;
+}
+
+//----------------------------------------------------------------------
+
+Isolate* IsolatePool::createIsolate(const char* scriptUri)
+{
+	char* error = 0;
+	Isolate* isolate = Isolate::createIsolate(scriptUri, "main", false, 0, &error);
+
+	if (isolate)
+	{
+		// Compile while still in the background so the claimer starts warm
+		if (VirtualMachine::getWarmUpMode() != WarmUpMode::Disabled)
+			Isolate::compileAll(scriptUri);
+
+		// Leave the isolate so any thread can claim it
+		Dart_ExitScope();
+		Dart_ExitIsolate();
+	}
+	else
+	{
+		printf("Unable to create pooled isolate for %s: %s\n", scriptUri, (error) ? error : "unknown error");
+		free(error);
+	}
+
+	return isolate;
+}
+
+//----------------------------------------------------------------------
+
+void IsolatePool::refill(void* argument)
+{
+	__mutex.lock();
+
+	while (!__shutdown)
+	{
+		std::uint64_t now = Clock::getMicroseconds();
+		std::uint64_t retryTime;
+		Pool* pool = __findPoolToRefill(now, &retryTime);
+
+		if (!pool)
+		{
+			// Sleep until asked or until a failed script can be retried
+			if (retryTime == 0)
+				__refillRequested.wait(__mutex);
+			else
+				__refillRequested.wait(__mutex, static_cast<std::uint32_t>((retryTime - now + 999) / 1000));
+
+			continue;
+		}
+
+		pool->pending++;
+
+		__mutex.unlock();
+
+		// Create the isolate outside the lock as it loads the script
+		Isolate* isolate = createIsolate(pool->scriptUri);
+
+		__mutex.lock();
+
+		pool->pending--;
+
+		if (isolate)
+		{
+			pool->isolates.push_back(isolate);
+			pool->retryTime = 0;
+		}
+		else
+		{
+			// Back off rather than spinning on a broken script while the
+			// other pools keep refilling
+			pool->failures++;
+			pool->retryTime = Clock::getMicroseconds() + static_cast<std::uint64_t>(__retryDelay) * 1000;
+		}
+	}
+
+	__mutex.unlock();
+}
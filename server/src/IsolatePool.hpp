@@ -0,0 +1,120 @@
+/**
+ * \file IsolatePool.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_ISOLATE_POOL_HPP_INCLUDED
+#define DART_EMBED_ISOLATE_POOL_HPP_INCLUDED
+
+#include <DartEmbed/VirtualMachine.hpp>
+
+namespace DartEmbed
+{
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class Isolate;
+	class EmbedIsolateData;
+
+	/**
+	 * Keeps isolates of a script ready to be claimed by spawn requests.
+	 *
+	 * Pooled isolates are created on a background thread with the script
+	 * and its libraries already loaded. When a script spawns an isolate the
+	 * create callback claims one from the pool instead of building it from
+	 * scratch. The pool is refilled in the background after each claim.
+	 */
+	class IsolatePool
+	{
+		public:
+
+			/**
+			 * Sets the number of isolates to keep ready for a script.
+			 *
+			 * Starts the refill thread if it isn't already running. Setting
+			 * the size to 0 stops refilling but keeps any ready isolates.
+			 *
+			 * \param scriptUri The resolved URI of the script.
+			 * \param size The number of isolates to keep ready.
+			 */
+			static void setSize(const char* scriptUri, std::size_t size);
+
+			/**
+			 * Claims a ready isolate for the script.
+			 *
+			 * On success the isolate is entered on the calling thread exactly
+			 * as if it had just been created, with the spawning isolate as
+			 * its parent.
+			 *
+			 * \param scriptUri The URI of the script.
+			 * \param parentData The data of the spawning isolate, or 0.
+			 * \returns true if an isolate was claimed; false otherwise.
+			 */
+			static bool claim(const char* scriptUri, EmbedIsolateData* parentData);
+
+			/**
+			 * Queries the statistics for a script's pool.
+			 *
+			 * \param scriptUri The resolved URI of the script.
+			 * \param statistics The structure to populate.
+			 * \returns true if the script has a pool; false otherwise.
+			 */
+			static bool getStatistics(const char* scriptUri, IsolatePoolStatistics* statistics);
+
+			/**
+			 * Stops the refill thread and shuts down any unclaimed isolates.
+			 */
+			static void terminate();
+
+		private:
+
+			/**
+			 * Creates an isolate for the pool.
+			 *
+			 * The isolate is exited before returning so it can be claimed
+			 * from any thread.
+			 *
+			 * \param scriptUri The resolved URI of the script.
+			 * \returns The isolate if it was created; 0 otherwise.
+			 */
+			static Isolate* createIsolate(const char* scriptUri);
+
+			/**
+			 * Refills the pools until shutdown.
+			 *
+			 * \param argument Unused.
+			 */
+			static void refill(void* argument);
+
+			IsolatePool() { }
+	} ; // end class IsolatePool
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_ISOLATE_POOL_HPP_INCLUDED
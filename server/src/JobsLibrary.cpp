@@ -0,0 +1,433 @@
+/**
+ * \file JobsLibrary.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "EmbedLibraries.hpp"
+#include <DartEmbed/VirtualMachine.hpp>
+#include "dart_api.h"
+#include "AsyncNative.hpp"
+#include "NativeResolution.hpp"
+#include "StringMap.hpp"
+#include "Thread.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	//---------------------------------------------------------------------
+	// Source code
+	//---------------------------------------------------------------------
+
+	const char* __sourceCode =
+		"#library('embed:jobs');\n"
+		"#import('dart:isolate');\n"
+		"#import('embed:async');\n"
+		"\n"
+		"class JobException implements Exception\n"
+		"{\n"
+		"  const JobException(String this.message);\n"
+		"  String toString() => 'JobException: $message';\n"
+		"  final String message;\n"
+		"}\n"
+		"\n"
+		"class Job\n"
+		"{\n"
+		"  Job(String kernel) : _kernel = _lookup(kernel)\n"
+		"  {\n"
+		"    if (_kernel < 0)\n"
+		"      throw new JobException('Unknown kernel $kernel');\n"
+		"  }\n"
+		"\n"
+		"  Future<List<int>> run(List<int> payload)\n"
+		"  {\n"
+		"    if (_native == null)\n"
+		"      _native = new AsyncNative(_newServicePort());\n"
+		"\n"
+		"    return _native.call([_kernel, payload]);\n"
+		"  }\n"
+		"\n"
+		"  static int _lookup(String kernel) native 'Job_Lookup';\n"
+		"  static SendPort _newServicePort() native 'Job_NewServicePort';\n"
+		"\n"
+		"  static AsyncNative _native;\n"
+		"  final int _kernel;\n"
+		"}\n";
+
+	//---------------------------------------------------------------------
+	// Jobs
+	//---------------------------------------------------------------------
+
+	/**
+	 * A job waiting on a worker.
+	 */
+	struct Job
+	{
+		/// The kernel to run
+		JobKernel kernel;
+		/// Completes the future returned to Dart
+		AsyncCompletion completion;
+		/// The payload to pass to the kernel
+		std::vector<std::uint8_t> input;
+	} ; // end struct Job
+
+	/// Guards creating the service port
+	Mutex __mutex;
+	/// The port jobs are posted to
+	Dart_Port __servicePort = kIllegalPort;
+	/// The registered kernels
+	std::vector<JobKernel> __kernels;
+	/// Maps the name of a kernel to its index
+	StringMap<std::size_t> __kernelsByName;
+
+	/**
+	 * Runs a job on a worker and replies with the result.
+	 *
+	 * \param argument The job to run.
+	 */
+	void __runJob(void* argument)
+	{
+		Job* job = static_cast<Job*>(argument);
+		std::vector<std::uint8_t>* output = new std::vector<std::uint8_t>();
+
+		const std::uint8_t* input = (job->input.empty()) ? 0 : &job->input[0];
+
+		if (job->kernel(input, job->input.size(), output))
+			job->completion.completeWithBytes(output);
+		else
+		{
+			job->completion.completeWithError("Job failed");
+			delete output;
+		}
+
+		delete job;
+	}
+
+	/**
+	 * Receives jobs posted to the service port.
+	 *
+	 * Messages are a list of the kernel index and the payload. The payload
+	 * is copied so the job can outlive the message.
+	 *
+	 * \param message The message received.
+	 * \param completion Completes the future returned to Dart.
+	 */
+	void __handleJobMessage(Dart_CObject* message, const AsyncCompletion& completion)
+	{
+		if ((message->type != Dart_CObject::kArray) ||
+		    (message->value.as_array.length != 2) ||
+		    (message->value.as_array.values[0]->type != Dart_CObject::kInt32))
+		{
+			completion.completeWithError("Invalid job request");
+			return;
+		}
+
+		std::int32_t kernel = message->value.as_array.values[0]->value.as_int32;
+
+		if ((kernel < 0) || (static_cast<std::size_t>(kernel) >= __kernels.size()))
+		{
+			completion.completeWithError("Unknown kernel");
+			return;
+		}
+
+		Job* job = new Job();
+		job->kernel = __kernels[kernel];
+		job->completion = completion;
+
+		Dart_CObject* payload = message->value.as_array.values[1];
+
+		if (payload->type == Dart_CObject::kUint8Array)
+		{
+			const std::uint8_t* values = payload->value.as_byte_array.values;
+			job->input.assign(values, values + payload->value.as_byte_array.length);
+		}
+		else if (payload->type == Dart_CObject::kArray)
+		{
+			// Lists of integers are accepted as well
+			std::size_t length = payload->value.as_array.length;
+			job->input.resize(length);
+
+			for (std::size_t i = 0; i < length; ++i)
+			{
+				Dart_CObject* value = payload->value.as_array.values[i];
+
+				if (value->type != Dart_CObject::kInt32)
+				{
+					completion.completeWithError("Payload must contain bytes");
+					delete job;
+					return;
+				}
+
+				job->input[i] = static_cast<std::uint8_t>(value->value.as_int32);
+			}
+		}
+		else if (payload->type != Dart_CObject::kNull)
+		{
+			completion.completeWithError("Payload must be a list of bytes");
+			delete job;
+			return;
+		}
+
+		if (!AsyncNatives::submit(__runJob, job))
+		{
+			completion.completeWithError("Jobs are not running");
+			delete job;
+		}
+	}
+
+	//---------------------------------------------------------------------
+	// Kernels
+	//---------------------------------------------------------------------
+
+	/**
+	 * Computes the CRC-32 of the payload.
+	 *
+	 * The checksum is returned as 4 bytes, most significant first.
+	 */
+	bool __crc32Kernel(const std::uint8_t* input, std::size_t length, std::vector<std::uint8_t>* output)
+	{
+		std::uint32_t crc = 0xffffffff;
+
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			crc ^= input[i];
+
+			for (std::int32_t bit = 0; bit < 8; ++bit)
+				crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+
+		crc = ~crc;
+
+		output->push_back(static_cast<std::uint8_t>(crc >> 24));
+		output->push_back(static_cast<std::uint8_t>(crc >> 16));
+		output->push_back(static_cast<std::uint8_t>(crc >>  8));
+		output->push_back(static_cast<std::uint8_t>(crc));
+
+		return true;
+	}
+
+	/**
+	 * Run-length encodes the payload as pairs of count and byte.
+	 */
+	bool __rleEncodeKernel(const std::uint8_t* input, std::size_t length, std::vector<std::uint8_t>* output)
+	{
+		std::size_t i = 0;
+
+		while (i < length)
+		{
+			std::uint8_t value = input[i];
+			std::size_t run = 1;
+
+			while ((i + run < length) && (input[i + run] == value) && (run < 255))
+				run++;
+
+			output->push_back(static_cast<std::uint8_t>(run));
+			output->push_back(value);
+
+			i += run;
+		}
+
+		return true;
+	}
+
+	/**
+	 * Decodes a payload encoded by the rleEncode kernel.
+	 */
+	bool __rleDecodeKernel(const std::uint8_t* input, std::size_t length, std::vector<std::uint8_t>* output)
+	{
+		if ((length % 2) != 0)
+			return false;
+
+		for (std::size_t i = 0; i < length; i += 2)
+			output->insert(output->end(), static_cast<std::size_t>(input[i]), input[i + 1]);
+
+		return true;
+	}
+
+	//---------------------------------------------------------------------
+	// Native functions
+	//---------------------------------------------------------------------
+
+	void Job_Lookup(Dart_NativeArguments args)
+	{
+		Dart_Handle name = Dart_GetNativeArgument(args, 0);
+		const char* kernel = 0;
+
+		if (Dart_IsError(Dart_StringToCString(name, &kernel)))
+		{
+			Dart_SetReturnValue(args, Dart_NewInteger(-1));
+			return;
+		}
+
+		std::size_t* found = __kernelsByName.find(kernel);
+
+		Dart_SetReturnValue(args, Dart_NewInteger((found) ? static_cast<std::int64_t>(*found) : -1));
+	}
+
+	void Job_NewServicePort(Dart_NativeArguments args)
+	{
+		ScopedLock lock(__mutex);
+
+		if (__servicePort == kIllegalPort)
+			__servicePort = AsyncNatives::createPort("JobsService", __handleJobMessage);
+
+		Dart_SetReturnValue(args, Dart_NewSendPort(__servicePort));
+	}
+
+	//---------------------------------------------------------------------
+	// Virtual machine entries
+	//---------------------------------------------------------------------
+
+	/// Whether the library has been initialized
+	bool __libraryInitialized = false;
+	/// Class entries for the jobs library
+	NativeClassEntry __libraryEntries[2];
+
+	/// Native entries for the Job class
+	NativeEntry __jobNativeEntries[3];
+
+	/**
+	 * Setup hooks to the Job class entries.
+	 */
+	void __setupJobEntries()
+	{
+		setNativeEntry(&__jobNativeEntries[0], "Lookup",         Job_Lookup,         1);
+		setNativeEntry(&__jobNativeEntries[1], "NewServicePort", Job_NewServicePort, 0);
+		// Set the sentinal value
+		setNativeEntry(&__jobNativeEntries[2], "", 0, 0);
+	}
+
+	/**
+	 * Setup the class entries.
+	 */
+	void __setupClassEntries()
+	{
+		setNativeClassEntry(&__libraryEntries[0], "Job", __jobNativeEntries);
+		// Set the sentinal value
+		setNativeClassEntry(&__libraryEntries[1], "", 0);
+	}
+
+	/**
+	 * Sets up the native entries for the jobs library.
+	 */
+	void __setupJobsLibrary()
+	{
+		if (!__libraryInitialized)
+		{
+			__setupClassEntries();
+			__setupJobEntries();
+
+			EmbedLibraries::registerJobKernel("crc32",     __crc32Kernel);
+			EmbedLibraries::registerJobKernel("rleEncode", __rleEncodeKernel);
+			EmbedLibraries::registerJobKernel("rleDecode", __rleDecodeKernel);
+		}
+
+		__libraryInitialized = true;
+	}
+
+	/**
+	 * Native resolver for the embed:jobs library.
+	 */
+	//CREATE_NATIVE_RESOLVER(__jobsLibraryResolver, __libraryEntries)
+	Dart_NativeFunction __jobsLibraryResolver(Dart_Handle name, int argumentCount)
+	{
+		const char* nativeFunctionName = 0;
+		Dart_Handle result = Dart_StringToCString(name, &nativeFunctionName);
+
+		assert(nativeFunctionName);
+
+		NativeCallHash hash;
+		fnv1aHashFunctionCall(nativeFunctionName, &hash);
+
+		NativeClassEntry* classEntry = __libraryEntries;
+
+		while (classEntry->entries != 0)
+		{
+			NativeEntry* functionEntry = classEntry->entries;
+
+			if (classEntry->hash == hash.classHash)
+			{
+				while (functionEntry->function != 0)
+				{
+					if (functionEntry->hash == hash.functionHash)
+					{
+						assert(functionEntry->argumentCount == argumentCount);
+						return functionEntry->function;
+					}
+
+					functionEntry++;
+				}
+
+				return 0;
+			}
+
+			classEntry++;
+		}
+
+		return 0;
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::createJobsLibrary()
+{
+	// Setup the native entries
+	__setupJobsLibrary();
+
+	VirtualMachine::loadScriptLibrary("embed:jobs", __sourceCode, __jobsLibraryResolver);
+}
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::registerJobKernel(const char* name, JobKernel kernel)
+{
+	std::size_t* found = __kernelsByName.find(name);
+
+	if (found)
+	{
+		__kernels[*found] = kernel;
+	}
+	else
+	{
+		__kernelsByName.insert(name, __kernels.size());
+		__kernels.push_back(kernel);
+	}
+}
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::terminateJobsLibrary()
+{
+	ScopedLock lock(__mutex);
+
+	if (__servicePort != kIllegalPort)
+		AsyncNatives::closePort(__servicePort);
+
+	__servicePort = kIllegalPort;
+}
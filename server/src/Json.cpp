@@ -0,0 +1,476 @@
+/**
+ * \file Json.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Json.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+using namespace DartEmbed;
+
+namespace DartEmbed
+{
+	/**
+	 * Recursive descent parser for JSON.
+	 */
+	struct JsonParser
+	{
+		/// The maximum nesting of arrays and objects
+		static const std::size_t MaxDepth = 64;
+
+		/// The current position within the document
+		const char* position;
+		/// The current nesting of arrays and objects
+		std::size_t depth;
+
+		/**
+		 * Skips any whitespace.
+		 */
+		void skipWhitespace()
+		{
+			while ((*position == ' ') || (*position == '\t') || (*position == '\n') || (*position == '\r'))
+				position++;
+		}
+
+		/**
+		 * Consumes a literal such as true.
+		 *
+		 * \param literal The literal to consume.
+		 * \returns true if the literal was present; false otherwise.
+		 */
+		bool consume(const char* literal)
+		{
+			std::size_t length = strlen(literal);
+
+			if (strncmp(position, literal, length) != 0)
+				return false;
+
+			position += length;
+			return true;
+		}
+
+		/**
+		 * Appends a code point to a string as UTF-8.
+		 *
+		 * \param codePoint The code point to append.
+		 * \param value The string to append to.
+		 */
+		static void appendUtf8(std::uint32_t codePoint, std::string& value)
+		{
+			if (codePoint < 0x80)
+			{
+				value += static_cast<char>(codePoint);
+			}
+			else if (codePoint < 0x800)
+			{
+				value += static_cast<char>(0xc0 | (codePoint >> 6));
+				value += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+			else if (codePoint < 0x10000)
+			{
+				value += static_cast<char>(0xe0 | (codePoint >> 12));
+				value += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				value += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+			else
+			{
+				value += static_cast<char>(0xf0 | (codePoint >> 18));
+				value += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+				value += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				value += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+		}
+
+		/**
+		 * Parses four hexadecimal digits.
+		 *
+		 * \param value The parsed value.
+		 * \returns true if the digits were valid; false otherwise.
+		 */
+		bool parseHex(std::uint32_t* value)
+		{
+			*value = 0;
+
+			for (std::size_t i = 0; i < 4; ++i)
+			{
+				char c = *position++;
+				*value <<= 4;
+
+				if ((c >= '0') && (c <= '9'))
+					*value |= c - '0';
+				else if ((c >= 'a') && (c <= 'f'))
+					*value |= c - 'a' + 10;
+				else if ((c >= 'A') && (c <= 'F'))
+					*value |= c - 'A' + 10;
+				else
+					return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * Parses a string.
+		 *
+		 * \returns A copy of the string or 0 if it is malformed.
+		 */
+		char* parseString()
+		{
+			if (*position != '"')
+				return 0;
+
+			position++;
+
+			std::string value;
+
+			while (*position != '"')
+			{
+				char c = *position++;
+
+				if ((c == '\0') || (static_cast<unsigned char>(c) < 0x20))
+					return 0;
+
+				if (c != '\\')
+				{
+					value += c;
+					continue;
+				}
+
+				switch (*position++)
+				{
+					case '"':  value += '"';  break;
+					case '\\': value += '\\'; break;
+					case '/':  value += '/';  break;
+					case 'b':  value += '\b'; break;
+					case 'f':  value += '\f'; break;
+					case 'n':  value += '\n'; break;
+					case 'r':  value += '\r'; break;
+					case 't':  value += '\t'; break;
+					case 'u':
+					{
+						std::uint32_t codePoint;
+
+						if (!parseHex(&codePoint))
+							return 0;
+
+						// Combine surrogate pairs
+						if ((codePoint >= 0xd800) && (codePoint < 0xdc00) && (position[0] == '\\') && (position[1] == 'u'))
+						{
+							position += 2;
+
+							std::uint32_t low;
+
+							if (!parseHex(&low) || (low < 0xdc00) || (low >= 0xe000))
+								return 0;
+
+							codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+						}
+
+						appendUtf8(codePoint, value);
+						break;
+					}
+					default:
+						return 0;
+				}
+			}
+
+			position++;
+
+			return strdup(value.c_str());
+		}
+
+		/**
+		 * Parses any value.
+		 *
+		 * \returns The value or 0 if it is malformed.
+		 */
+		JsonValue* parseValue()
+		{
+			skipWhitespace();
+
+			JsonValue* value = new JsonValue();
+			bool valid;
+
+			switch (*position)
+			{
+				case '{': valid = parseObject(value); break;
+				case '[': valid = parseArray(value);  break;
+				case '"':
+				{
+					value->_type = JsonType::String;
+					value->_string = parseString();
+					valid = value->_string != 0;
+					break;
+				}
+				case 't':
+				{
+					value->_type = JsonType::Boolean;
+					value->_boolean = true;
+					valid = consume("true");
+					break;
+				}
+				case 'f':
+				{
+					value->_type = JsonType::Boolean;
+					valid = consume("false");
+					break;
+				}
+				case 'n':
+				{
+					valid = consume("null");
+					break;
+				}
+				default:
+				{
+					char* end;
+					value->_type = JsonType::Number;
+					value->_number = strtod(position, &end);
+					valid = end != position;
+					position = end;
+					break;
+				}
+			}
+
+			if (!valid)
+			{
+				delete value;
+				return 0;
+			}
+
+			return value;
+		}
+
+		/**
+		 * Parses an array.
+		 *
+		 * \param value The value to populate.
+		 * \returns true if the array was valid; false otherwise.
+		 */
+		bool parseArray(JsonValue* value)
+		{
+			if (++depth > MaxDepth)
+				return false;
+
+			value->_type = JsonType::Array;
+			position++;
+
+			skipWhitespace();
+
+			if (*position == ']')
+			{
+				position++;
+				depth--;
+				return true;
+			}
+
+			while (true)
+			{
+				JsonValue* element = parseValue();
+
+				if (!element)
+					return false;
+
+				value->_values.push_back(element);
+
+				skipWhitespace();
+
+				if (*position == ']')
+					break;
+
+				if (*position++ != ',')
+					return false;
+			}
+
+			position++;
+			depth--;
+			return true;
+		}
+
+		/**
+		 * Parses an object.
+		 *
+		 * \param value The value to populate.
+		 * \returns true if the object was valid; false otherwise.
+		 */
+		bool parseObject(JsonValue* value)
+		{
+			if (++depth > MaxDepth)
+				return false;
+
+			value->_type = JsonType::Object;
+			position++;
+
+			skipWhitespace();
+
+			if (*position == '}')
+			{
+				position++;
+				depth--;
+				return true;
+			}
+
+			while (true)
+			{
+				skipWhitespace();
+
+				char* name = parseString();
+
+				if (!name)
+					return false;
+
+				value->_names.push_back(name);
+
+				skipWhitespace();
+
+				if (*position++ != ':')
+					return false;
+
+				JsonValue* member = parseValue();
+
+				if (!member)
+					return false;
+
+				value->_values.push_back(member);
+
+				skipWhitespace();
+
+				if (*position == '}')
+					break;
+
+				if (*position++ != ',')
+					return false;
+			}
+
+			position++;
+			depth--;
+			return true;
+		}
+	} ; // end struct JsonParser
+} // end namespace DartEmbed
+
+//----------------------------------------------------------------------
+
+JsonValue::JsonValue()
+	: _type(JsonType::Null)
+	, _boolean(false)
+	, _number(0.0)
+	, _string(0)
+{ }
+
+//----------------------------------------------------------------------
+
+JsonValue::~JsonValue()
+{
+	free(_string);
+
+	std::size_t count = _values.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+		delete _values[i];
+
+	count = _names.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+		free(_names[i]);
+}
+
+//----------------------------------------------------------------------
+
+const JsonValue* JsonValue::getMember(const char* name) const
+{
+	std::size_t count = _values.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (strcmp(_names[i], name) == 0)
+			return _values[i];
+	}
+
+	return 0;
+}
+
+//----------------------------------------------------------------------
+
+JsonValue* JsonValue::parse(const char* text)
+{
+	JsonParser parser;
+	parser.position = text;
+	parser.depth = 0;
+
+	JsonValue* value = parser.parseValue();
+
+	if (value)
+	{
+		parser.skipWhitespace();
+
+		// Nothing may follow the document
+		if (*parser.position != '\0')
+		{
+			delete value;
+			return 0;
+		}
+	}
+
+	return value;
+}
+
+//----------------------------------------------------------------------
+
+JsonValue* JsonValue::parseFile(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+
+	if (!file)
+		return 0;
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (length < 0)
+	{
+		fclose(file);
+		return 0;
+	}
+
+	char* text = new char[length + 1];
+	std::size_t read = fread(text, 1, length, file);
+	text[read] = '\0';
+
+	fclose(file);
+
+	JsonValue* value = parse(text);
+
+	delete[] text;
+
+	return value;
+}
@@ -0,0 +1,194 @@
+/**
+ * \file Json.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_JSON_HPP_INCLUDED
+#define DART_EMBED_JSON_HPP_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+namespace DartEmbed
+{
+	/**
+	 * The type of a JSON value.
+	 */
+	namespace JsonType
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// null
+			Null,
+			/// true or false
+			Boolean,
+			/// A number
+			Number,
+			/// A string
+			String,
+			/// An ordered list of values
+			Array,
+			/// A set of named values
+			Object,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace JsonType
+
+	/**
+	 * A parsed JSON document.
+	 *
+	 * Used for reading configuration before any isolates are running, so it
+	 * favors simplicity over speed.
+	 */
+	class JsonValue
+	{
+		//----------------------------------------------------------------------
+		// Construction/Destruction
+		//----------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Creates a null value.
+			 */
+			JsonValue();
+
+			/**
+			 * Destroys the value and any values it contains.
+			 */
+			~JsonValue();
+
+		//----------------------------------------------------------------------
+		// Properties
+		//----------------------------------------------------------------------
+
+		public:
+
+			inline JsonType::Enum getType() const
+			{
+				return _type;
+			}
+
+			inline bool getBoolean() const
+			{
+				return _boolean;
+			}
+
+			inline double getNumber() const
+			{
+				return _number;
+			}
+
+			/**
+			 * Gets the value of a string.
+			 *
+			 * \returns The string or 0 if the value is not a string.
+			 */
+			inline const char* getString() const
+			{
+				return _string;
+			}
+
+			/**
+			 * Gets the number of elements or members.
+			 *
+			 * \returns The number of elements or members.
+			 */
+			inline std::size_t getSize() const
+			{
+				return _values.size();
+			}
+
+			/**
+			 * Gets an element of an array or the value of a member.
+			 *
+			 * \param index The index of the element.
+			 * \returns The element.
+			 */
+			inline const JsonValue* getElement(std::size_t index) const
+			{
+				return _values[index];
+			}
+
+			/**
+			 * Gets the value of a member of an object.
+			 *
+			 * \param name The name of the member.
+			 * \returns The value or 0 if there is no such member.
+			 */
+			const JsonValue* getMember(const char* name) const;
+
+		//----------------------------------------------------------------------
+		// Parsing
+		//----------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Parses a JSON document.
+			 *
+			 * \param text The document to parse.
+			 * \returns The root of the document or 0 if it is malformed.
+			 */
+			static JsonValue* parse(const char* text);
+
+			/**
+			 * Parses a JSON document from a file.
+			 *
+			 * \param path The path to the file.
+			 * \returns The root of the document or 0 if it couldn't be read or is malformed.
+			 */
+			static JsonValue* parseFile(const char* path);
+
+		private:
+
+			friend struct JsonParser;
+
+			// Copying is not allowed
+			JsonValue(const JsonValue&);
+			JsonValue& operator= (const JsonValue&);
+
+			/// The type of the value
+			JsonType::Enum _type;
+			/// The value of a boolean
+			bool _boolean;
+			/// The value of a number
+			double _number;
+			/// The value of a string
+			char* _string;
+			/// The elements of an array or the values of an object's members
+			std::vector<JsonValue*> _values;
+			/// The names of an object's members
+			std::vector<char*> _names;
+	} ; // end class JsonValue
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_JSON_HPP_INCLUDED
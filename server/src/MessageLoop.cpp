@@ -0,0 +1,391 @@
+/**
+ * \file MessageLoop.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "MessageLoop.hpp"
+#include <DartEmbed/Isolate.hpp>
+#include <algorithm>
+#include <cstdio>
+#include "dart_api.h"
+#include "Clock.hpp"
+#include "Watchdog.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// All of the loops
+	std::vector<MessageLoop*> __loops;
+	/**
+	 * Guards the loops.
+	 *
+	 * Always acquired before the mutex of a loop.
+	 */
+	Mutex __loopsMutex;
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+MessageLoop::MessageLoop()
+	: _nextTimerId(1)
+	, _timeBudget(DefaultTimeBudget)
+	, _overBudgetCount(0)
+	, _stopped(false)
+{
+	ScopedLock lock(__loopsMutex);
+
+	__loops.push_back(this);
+}
+
+//----------------------------------------------------------------------
+
+MessageLoop::~MessageLoop()
+{
+	{
+		ScopedLock lock(__loopsMutex);
+
+		__loops.erase(std::find(__loops.begin(), __loops.end(), this));
+	}
+
+	while (!_isolates.empty())
+		removeIsolate(_isolates.back());
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::addIsolate(Isolate* isolate)
+{
+	Entry* entry = new Entry();
+	entry->isolate = isolate->_isolate;
+	// Handle anything posted before the callback was set
+	entry->pending = 1;
+	entry->queued = true;
+
+	Dart_SetMessageNotifyCallback(notify);
+	Watchdog::attach();
+
+	ScopedLock lock(_mutex);
+
+	_isolates.push_back(entry);
+	_ready.push_back(entry);
+	_wake.signal();
+}
+
+//----------------------------------------------------------------------
+
+std::size_t MessageLoop::getNumberOfIsolates()
+{
+	ScopedLock lock(_mutex);
+
+	return _isolates.size();
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::post(Function function, void* argument)
+{
+	Task task = { function, argument, 0, 0 };
+
+	ScopedLock lock(_mutex);
+
+	_tasks.push_back(task);
+	_wake.signal();
+}
+
+//----------------------------------------------------------------------
+
+std::uint32_t MessageLoop::addTimer(Function function, void* argument, std::uint32_t milliseconds)
+{
+	std::uint64_t deadline = Clock::getMicroseconds() + static_cast<std::uint64_t>(milliseconds) * 1000;
+
+	ScopedLock lock(_mutex);
+
+	Task timer = { function, argument, deadline, _nextTimerId++ };
+
+	_timers.push_back(timer);
+	std::push_heap(_timers.begin(), _timers.end(), LaterDeadline());
+	_wake.signal();
+
+	return timer.id;
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::cancelTimer(std::uint32_t id)
+{
+	ScopedLock lock(_mutex);
+
+	std::size_t count = _timers.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (_timers[i].id == id)
+		{
+			_timers.erase(_timers.begin() + i);
+			std::make_heap(_timers.begin(), _timers.end(), LaterDeadline());
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::setTimeBudget(std::uint32_t microseconds)
+{
+	ScopedLock lock(_mutex);
+
+	_timeBudget = microseconds;
+}
+
+//----------------------------------------------------------------------
+
+std::uint64_t MessageLoop::getOverBudgetCount()
+{
+	ScopedLock lock(_mutex);
+
+	return _overBudgetCount;
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::run()
+{
+	_mutex.lock();
+
+	while (!_stopped)
+	{
+		runTasks();
+
+		if (_ready.empty())
+		{
+			if (!_tasks.empty())
+				continue;
+
+			if (_timers.empty())
+			{
+				// Nothing can wake the loop again
+				if (_isolates.empty())
+					break;
+
+				_wake.wait(_mutex);
+			}
+			else
+			{
+				std::uint64_t now = Clock::getMicroseconds();
+				std::uint64_t deadline = _timers.front().deadline;
+
+				if (deadline > now)
+					_wake.wait(_mutex, static_cast<std::uint32_t>((deadline - now + 999) / 1000));
+			}
+
+			continue;
+		}
+
+		// Handle messages round robin until the budget for the turn is spent
+		std::uint64_t turnStart = Clock::getMicroseconds();
+
+		while (!_ready.empty() && !_stopped)
+		{
+			Entry* entry = _ready.front();
+			_ready.pop_front();
+
+			entry->pending--;
+
+			_mutex.unlock();
+
+			std::uint64_t start = Clock::getMicroseconds();
+			bool alive = handleMessage(entry);
+			std::uint64_t end = Clock::getMicroseconds();
+
+			_mutex.lock();
+
+			if (end - start > _timeBudget)
+			{
+				_overBudgetCount++;
+				printf("Message took %llu us, over the budget of %u us\n", static_cast<unsigned long long>(end - start), _timeBudget);
+			}
+
+			if (entry->pending > 0)
+			{
+				_ready.push_back(entry);
+			}
+			else if (!alive)
+			{
+				_mutex.unlock();
+				removeIsolate(entry);
+				_mutex.lock();
+			}
+			else
+			{
+				entry->queued = false;
+			}
+
+			// Service native work before handling more messages
+			if ((end - turnStart > _timeBudget) || !_tasks.empty())
+				break;
+		}
+	}
+
+	_stopped = false;
+
+	_mutex.unlock();
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::stop()
+{
+	ScopedLock lock(_mutex);
+
+	_stopped = true;
+	_wake.signal();
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::notify(Dart_Isolate isolate)
+{
+	ScopedLock loopsLock(__loopsMutex);
+
+	std::size_t loopCount = __loops.size();
+
+	for (std::size_t i = 0; i < loopCount; ++i)
+	{
+		MessageLoop* loop = __loops[i];
+		ScopedLock lock(loop->_mutex);
+
+		std::size_t count = loop->_isolates.size();
+
+		for (std::size_t j = 0; j < count; ++j)
+		{
+			Entry* entry = loop->_isolates[j];
+
+			if (entry->isolate == isolate)
+			{
+				entry->pending++;
+
+				if (!entry->queued)
+				{
+					entry->queued = true;
+					loop->_ready.push_back(entry);
+					loop->_wake.signal();
+				}
+
+				return;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+bool MessageLoop::handleMessage(Entry* entry)
+{
+	Dart_Isolate current = Dart_CurrentIsolate();
+
+	// Isolates stay entered until another needs the thread
+	if (current != entry->isolate)
+	{
+		if (current)
+			Dart_ExitIsolate();
+
+		Dart_EnterIsolate(entry->isolate);
+	}
+
+	Dart_EnterScope();
+
+	Watchdog::begin(entry->isolate);
+	Dart_Handle result = Dart_HandleMessage();
+	Watchdog::end(entry->isolate);
+
+	bool alive;
+
+	if (Dart_IsError(result))
+	{
+		printf("%s\n", Dart_GetError(result));
+		alive = false;
+	}
+	else
+	{
+		// Without live ports the isolate can't receive any more messages
+		alive = Dart_HasLivePorts();
+	}
+
+	Dart_ExitScope();
+
+	return alive;
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::removeIsolate(Entry* entry)
+{
+	ScopedLock lock(_mutex);
+
+	_isolates.erase(std::find(_isolates.begin(), _isolates.end(), entry));
+
+	std::deque<Entry*>::iterator queued = std::find(_ready.begin(), _ready.end(), entry);
+
+	if (queued != _ready.end())
+		_ready.erase(queued);
+
+	Watchdog::detach(entry->isolate);
+
+	delete entry;
+}
+
+//----------------------------------------------------------------------
+
+void MessageLoop::runTasks()
+{
+	std::vector<Task> due;
+	due.swap(_tasks);
+
+	std::uint64_t now = Clock::getMicroseconds();
+
+	while (!_timers.empty() && (_timers.front().deadline <= now))
+	{
+		due.push_back(_timers.front());
+
+		std::pop_heap(_timers.begin(), _timers.end(), LaterDeadline());
+		_timers.pop_back();
+	}
+
+	if (due.empty())
+		return;
+
+	_mutex.unlock();
+
+	std::size_t count = due.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+		due[i].function(due[i].argument);
+
+	_mutex.lock();
+}
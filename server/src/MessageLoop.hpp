@@ -0,0 +1,260 @@
+/**
+ * \file MessageLoop.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_MESSAGE_LOOP_HPP_INCLUDED
+#define DART_EMBED_MESSAGE_LOOP_HPP_INCLUDED
+
+#include <DartEmbed/VirtualMachine.hpp>
+#include <deque>
+#include <vector>
+#include "Thread.hpp"
+
+namespace DartEmbed
+{
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class Isolate;
+
+	/**
+	 * Event loop driving isolates from a thread owned by the embedder.
+	 *
+	 * Replaces Dart_RunLoop. The virtual machine notifies the loop whenever
+	 * a message is posted to one of its isolates and the loop handles the
+	 * messages one at a time, round robin, so several isolates can share a
+	 * thread. Native timers and tasks posted from other threads, such as
+	 * I/O readiness, run on the same thread between messages.
+	 */
+	class MessageLoop
+	{
+		public:
+
+			/// Work scheduled on the loop
+			typedef void (*Function)(void* argument);
+
+			/// The default time budget in microseconds
+			static const std::uint32_t DefaultTimeBudget = 16000;
+
+			/**
+			 * Creates an instance of the MessageLoop class.
+			 */
+			MessageLoop();
+
+			/**
+			 * Destroys an instance of the MessageLoop class.
+			 *
+			 * Any isolates still attached are detached but not shut down.
+			 */
+			~MessageLoop();
+
+			/**
+			 * Attaches an isolate to the loop.
+			 *
+			 * The isolate must be current on the thread that runs the loop,
+			 * and should be attached before any functions are invoked on it so
+			 * no messages are missed.
+			 *
+			 * \param isolate The isolate to attach.
+			 */
+			void addIsolate(Isolate* isolate);
+
+			/**
+			 * Queries the number of isolates attached to the loop.
+			 *
+			 * \returns The number of isolates attached to the loop.
+			 */
+			std::size_t getNumberOfIsolates();
+
+			/**
+			 * Runs a function on the loop's thread.
+			 *
+			 * Can be called from any thread.
+			 *
+			 * \param function The function to run.
+			 * \param argument The argument to pass to the function.
+			 */
+			void post(Function function, void* argument);
+
+			/**
+			 * Runs a function on the loop's thread after a delay.
+			 *
+			 * Can be called from any thread.
+			 *
+			 * \param function The function to run.
+			 * \param argument The argument to pass to the function.
+			 * \param milliseconds The delay before running the function.
+			 * \returns An identifier that can be used to cancel the timer.
+			 */
+			std::uint32_t addTimer(Function function, void* argument, std::uint32_t milliseconds);
+
+			/**
+			 * Cancels a timer that hasn't fired.
+			 *
+			 * \param id The identifier returned from addTimer.
+			 */
+			void cancelTimer(std::uint32_t id);
+
+			/**
+			 * Sets how long messages can run before native work is serviced.
+			 *
+			 * Once the messages handled in a turn of the loop exceed the budget
+			 * any due timers and posted functions are run before handling more.
+			 * A single message exceeding the budget is reported.
+			 *
+			 * \param microseconds The time budget in microseconds.
+			 */
+			void setTimeBudget(std::uint32_t microseconds);
+
+			/**
+			 * Queries the number of messages that exceeded the time budget.
+			 *
+			 * \returns The number of messages that exceeded the time budget.
+			 */
+			std::uint64_t getOverBudgetCount();
+
+			/**
+			 * Runs the loop.
+			 *
+			 * Returns once stop is called or when no isolates, timers or posted
+			 * functions remain.
+			 */
+			void run();
+
+			/**
+			 * Stops the loop.
+			 *
+			 * Can be called from any thread. The loop stops after the message
+			 * currently being handled.
+			 */
+			void stop();
+
+		private:
+
+			/**
+			 * An isolate attached to the loop.
+			 */
+			struct Entry
+			{
+				/// The isolate
+				Dart_Isolate isolate;
+				/// The number of messages waiting to be handled
+				std::size_t pending;
+				/// Whether the isolate is in the ready queue
+				bool queued;
+			} ; // end struct Entry
+
+			/**
+			 * A function waiting to run.
+			 */
+			struct Task
+			{
+				/// The function to run
+				Function function;
+				/// The argument to pass to the function
+				void* argument;
+				/// The time to run the function in microseconds
+				std::uint64_t deadline;
+				/// The identifier of the timer
+				std::uint32_t id;
+			} ; // end struct Task
+
+			/**
+			 * Orders timers so the earliest deadline is at the front of the heap.
+			 */
+			struct LaterDeadline
+			{
+				inline bool operator() (const Task& lhs, const Task& rhs) const
+				{
+					return lhs.deadline > rhs.deadline;
+				}
+			} ; // end struct LaterDeadline
+
+			/**
+			 * Callback from the virtual machine when a message is posted.
+			 *
+			 * \param isolate The isolate that received the message.
+			 */
+			static void notify(Dart_Isolate isolate);
+
+			/**
+			 * Handles the next message for an isolate.
+			 *
+			 * \param entry The isolate to handle the message for.
+			 * \returns true if the isolate can still receive messages; false otherwise.
+			 */
+			bool handleMessage(Entry* entry);
+
+			/**
+			 * Detaches an isolate from the loop.
+			 *
+			 * The mutex must not be held by the caller.
+			 *
+			 * \param entry The isolate to detach.
+			 */
+			void removeIsolate(Entry* entry);
+
+			/**
+			 * Runs any due timers and posted functions.
+			 *
+			 * The mutex must be held by the caller and is released while
+			 * running the functions.
+			 */
+			void runTasks();
+
+			// Copying is not allowed
+			MessageLoop(const MessageLoop&);
+			MessageLoop& operator= (const MessageLoop&);
+
+			/// Guards the state of the loop
+			Mutex _mutex;
+			/// Signaled when there is work for the loop
+			ConditionVariable _wake;
+			/// The isolates attached to the loop
+			std::vector<Entry*> _isolates;
+			/// Isolates with messages waiting
+			std::deque<Entry*> _ready;
+			/// Functions posted to the loop
+			std::vector<Task> _tasks;
+			/// Timers ordered as a heap by deadline
+			std::vector<Task> _timers;
+			/// The identifier for the next timer
+			std::uint32_t _nextTimerId;
+			/// The time budget in microseconds
+			std::uint32_t _timeBudget;
+			/// The number of messages that exceeded the time budget
+			std::uint64_t _overBudgetCount;
+			/// Whether the loop should stop
+			bool _stopped;
+	} ; // end class MessageLoop
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_MESSAGE_LOOP_HPP_INCLUDED
@@ -0,0 +1,117 @@
+/**
+ * \file PlatformLinux.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_PLATFORM_LINUX_HPP_INCLUDED
+#define DART_EMBED_PLATFORM_LINUX_HPP_INCLUDED
+
+#include <cstddef>
+
+/**
+ * Opens any game pads that were plugged in since the last scan.
+ *
+ * Game pads are read through the joystick interface at /dev/input/js0
+ * through /dev/input/js3, which map to the players in order. Rumble is
+ * driven through the event device belonging to the same controller.
+ */
+void scanGamePads();
+
+/**
+ * Reads the pending events of a game pad.
+ *
+ * Closes the game pad if it was unplugged.
+ *
+ * \param index The index of the game pad.
+ */
+void readGamePad(std::size_t index);
+
+/**
+ * Gets the file descriptor of a game pad.
+ *
+ * \param index The index of the game pad.
+ * \returns The file descriptor or -1 if the game pad isn't open.
+ */
+int getGamePadDescriptor(std::size_t index);
+
+/**
+ * Queries whether a game pad can apply vibration.
+ *
+ * Rumble goes through the event device of the controller, which may be
+ * missing, unreadable or lack force feedback.
+ *
+ * \param index The index of the game pad.
+ * \returns true if the game pad is open and can rumble; false otherwise.
+ */
+bool canVibrateGamePad(std::size_t index);
+
+/**
+ * Closes all the game pads.
+ */
+void closeGamePads();
+
+/**
+ * Gets the file descriptor the listening sockets are offered on.
+ *
+ * \returns The file descriptor or -1 if they aren't being offered.
+ */
+int getHandoverDescriptor();
+
+/**
+ * Accepts a new process and hands it the listening sockets.
+ *
+ * \returns The connection to the new process or -1 if it failed.
+ */
+int acceptSuccessor();
+
+/**
+ * Accepts a new process and closes it without handing anything over.
+ *
+ * Used while another new process is already taking over.
+ */
+void rejectSuccessor();
+
+/**
+ * Reads from the new process.
+ *
+ * Once the new process is listening the shards are asked to drain.
+ *
+ * \param successor The connection to the new process.
+ * \returns true if the connection should be kept open; false otherwise.
+ */
+bool readSuccessor(int successor);
+
+/**
+ * Queries whether the connections were drained after a handover.
+ *
+ * \returns true if the application should exit; false otherwise.
+ */
+bool isDrained();
+
+#endif // end DART_EMBED_PLATFORM_LINUX_HPP_INCLUDED
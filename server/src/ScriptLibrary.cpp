@@ -32,6 +32,7 @@
 #include "ScriptLibrary.hpp"
 #include "dart_api.h"
 #include "NativeResolution.hpp"
+#include "StartupReport.hpp"
 using namespace DartEmbed;
 
 //----------------------------------------------------------------------
@@ -52,6 +53,8 @@ ScriptLibrary::ScriptLibrary(
 
 Dart_Handle ScriptLibrary::load()
 {
+	StartupPhase phase("ScriptLibrary::load", _name);
+
 	// Lookup the library
 	Dart_Handle url = Dart_NewString(_name);
 	Dart_Handle library = Dart_LookupLibrary(url);
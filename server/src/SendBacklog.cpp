@@ -0,0 +1,190 @@
+/**
+ * \file SendBacklog.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "SendBacklog.hpp"
+
+#ifdef __linux__
+
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "Thread.hpp"
+#endif
+
+using namespace DartEmbed;
+
+#ifdef __linux__
+
+namespace
+{
+	/// Guards the accepted sockets
+	Mutex __mutex;
+	/// Sockets accepted that no connection has found yet
+	std::vector<std::intptr_t> __accepted;
+
+	/**
+	 * Gets the port of a socket address.
+	 *
+	 * \param address The socket address.
+	 * \returns The port; -1 if the address isn't an internet address.
+	 */
+	std::int64_t __getPort(const sockaddr_storage& address)
+	{
+		if (address.ss_family == AF_INET)
+			return ntohs(reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+		else if (address.ss_family == AF_INET6)
+			return ntohs(reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port);
+
+		return -1;
+	}
+
+	/**
+	 * Checks whether a socket is connected to a peer.
+	 *
+	 * \param socket The socket to check.
+	 * \param remoteHost The address of the peer.
+	 * \param remotePort The port of the peer.
+	 * \param localPort The port the peer connected to.
+	 * \param closed Set if the socket is no longer connected to anything.
+	 * \returns true if the socket is connected to the peer; false otherwise.
+	 */
+	bool __isConnectedTo(int socket, const char* remoteHost, std::int64_t remotePort, std::int64_t localPort, bool* closed)
+	{
+		sockaddr_storage remote;
+		socklen_t remoteLength = sizeof(remote);
+		sockaddr_storage local;
+		socklen_t localLength = sizeof(local);
+
+		if ((getpeername(socket, reinterpret_cast<sockaddr*>(&remote), &remoteLength) != 0) ||
+		    (getsockname(socket, reinterpret_cast<sockaddr*>(&local),  &localLength)  != 0))
+		{
+			*closed = true;
+			return false;
+		}
+
+		*closed = false;
+
+		if ((__getPort(remote) != remotePort) || (__getPort(local) != localPort))
+			return false;
+
+		// Compare the address the same way it was printed for the peer
+		char host[INET6_ADDRSTRLEN];
+		const void* address = (remote.ss_family == AF_INET)
+			? static_cast<const void*>(&reinterpret_cast<const sockaddr_in*>(&remote)->sin_addr)
+			: static_cast<const void*>(&reinterpret_cast<const sockaddr_in6*>(&remote)->sin6_addr);
+
+		if (inet_ntop(remote.ss_family, address, host, sizeof(host)) == 0)
+			return false;
+
+		return strcmp(host, remoteHost) == 0;
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+void SendBacklog::addSocket(std::intptr_t socket)
+{
+	ScopedLock lock(__mutex);
+
+	// Descriptors are reused once closed
+	for (std::size_t i = 0; i < __accepted.size(); ++i)
+	{
+		if (__accepted[i] == socket)
+			return;
+	}
+
+	__accepted.push_back(socket);
+}
+
+//---------------------------------------------------------------------
+
+std::intptr_t SendBacklog::findSocket(const char* remoteHost, std::int64_t remotePort, std::int64_t localPort)
+{
+	ScopedLock lock(__mutex);
+
+	std::intptr_t found = -1;
+	std::size_t count = 0;
+
+	// Forget sockets that were closed without a connection finding them
+	for (std::size_t i = 0; i < __accepted.size(); ++i)
+	{
+		std::intptr_t socket = __accepted[i];
+		bool closed = false;
+
+		if ((found == -1) && __isConnectedTo(static_cast<int>(socket), remoteHost, remotePort, localPort, &closed))
+			found = socket;
+		else if (!closed)
+			__accepted[count++] = socket;
+	}
+
+	__accepted.resize(count);
+
+	return found;
+}
+
+//---------------------------------------------------------------------
+
+std::int64_t SendBacklog::getUnsentBytes(std::intptr_t socket)
+{
+	int bytes = 0;
+
+	if (ioctl(static_cast<int>(socket), SIOCOUTQ, &bytes) != 0)
+		return -1;
+
+	return bytes;
+}
+
+#else
+
+//---------------------------------------------------------------------
+
+void SendBacklog::addSocket(std::intptr_t socket)
+{ }
+
+//---------------------------------------------------------------------
+
+std::intptr_t SendBacklog::findSocket(const char* remoteHost, std::int64_t remotePort, std::int64_t localPort)
+{
+	return -1;
+}
+
+//---------------------------------------------------------------------
+
+std::int64_t SendBacklog::getUnsentBytes(std::intptr_t socket)
+{
+	return 0;
+}
+
+#endif
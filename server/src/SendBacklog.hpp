@@ -0,0 +1,82 @@
+/**
+ * \file SendBacklog.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_SEND_BACKLOG_HPP_INCLUDED
+#define DART_EMBED_SEND_BACKLOG_HPP_INCLUDED
+
+#include <cstdint>
+
+namespace DartEmbed
+{
+	/**
+	 * Measures how far behind the clients of the server are.
+	 *
+	 * The WebSocket connections of dart:io don't say how much they have
+	 * buffered, so a client that can't keep up grows the outgoing buffer
+	 * without limit. Accepted sockets are recorded so a connection can
+	 * find its socket from the address of its peer, and the bytes the
+	 * peer hasn't acknowledged are read from the kernel.
+	 *
+	 * Only supported on Linux; elsewhere no socket is ever found and the
+	 * server sends as it always has.
+	 */
+	namespace SendBacklog
+	{
+		/**
+		 * Records a socket accepted by a server.
+		 *
+		 * \param socket The accepted socket.
+		 */
+		void addSocket(std::intptr_t socket);
+
+		/**
+		 * Finds the accepted socket connected to a peer.
+		 *
+		 * The socket is no longer recorded once found.
+		 *
+		 * \param remoteHost The address of the peer.
+		 * \param remotePort The port of the peer.
+		 * \param localPort The port the peer connected to.
+		 * \returns The socket if found; -1 otherwise.
+		 */
+		std::intptr_t findSocket(const char* remoteHost, std::int64_t remotePort, std::int64_t localPort);
+
+		/**
+		 * Gets the number of bytes written to a socket that the peer hasn't received.
+		 *
+		 * \param socket The socket to query.
+		 * \returns The number of bytes; -1 if the socket is closed.
+		 */
+		std::int64_t getUnsentBytes(std::intptr_t socket);
+	} // end namespace SendBacklog
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_SEND_BACKLOG_HPP_INCLUDED
@@ -0,0 +1,314 @@
+/**
+ * \file ShardLibrary.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "EmbedLibraries.hpp"
+#include <DartEmbed/VirtualMachine.hpp>
+#include "dart_api.h"
+#include "EmbedIsolateData.hpp"
+#include "NativeResolution.hpp"
+#include "SendBacklog.hpp"
+#include "Shards.hpp"
+#include "Thread.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	//---------------------------------------------------------------------
+	// Source code
+	//---------------------------------------------------------------------
+
+	const char* __sourceCode =
+		"#library('embed:shard');\n"
+		"#import('dart:isolate');\n"
+		"\n"
+		"class Shard\n"
+		"{\n"
+		"  static int get index() native 'Shard_GetIndex';\n"
+		"  static int get count() native 'Shard_GetCount';\n"
+		"  static int select() native 'Shard_Select';\n"
+		"  static void connectionOpened() native 'Shard_ConnectionOpened';\n"
+		"  static void connectionClosed() native 'Shard_ConnectionClosed';\n"
+		"\n"
+		"  static void onDrain(void callback(int milliseconds))\n"
+		"  {\n"
+		"    ReceivePort port = new ReceivePort();\n"
+		"    port.receive((milliseconds, replyTo) {\n"
+		"      port.close();\n"
+		"      callback(milliseconds);\n"
+		"    });\n"
+		"\n"
+		"    _newDrainServicePort().send(index, port.toSendPort());\n"
+		"  }\n"
+		"\n"
+		"  static SendPort _newDrainServicePort() native 'Shard_NewDrainServicePort';\n"
+		"}\n"
+		"\n"
+		"class SendBacklog\n"
+		"{\n"
+		"  static int findSocket(String remoteHost, int remotePort, int localPort) native 'SendBacklog_FindSocket';\n"
+		"  static int unsentBytes(int socket) native 'SendBacklog_GetUnsentBytes';\n"
+		"}\n";
+
+	//---------------------------------------------------------------------
+	// Draining
+	//---------------------------------------------------------------------
+
+	/// Guards creating the drain service port
+	Mutex __mutex;
+	/// The port drain callbacks are registered through
+	Dart_Port __drainServicePort = kIllegalPort;
+
+	/**
+	 * Registers the port a shard is notified on when it should drain.
+	 *
+	 * Messages are the index of the shard with the port to notify as the
+	 * reply port.
+	 *
+	 * \param destinationPort The service port.
+	 * \param replyPort The port to notify.
+	 * \param message The message received.
+	 */
+	void __handleDrainMessage(Dart_Port destinationPort, Dart_Port replyPort, Dart_CObject* message)
+	{
+		if ((replyPort != kIllegalPort) && (message->type == Dart_CObject::kInt32) && (message->value.as_int32 >= 0))
+			Shards::setDrainPort(static_cast<std::size_t>(message->value.as_int32), replyPort);
+	}
+
+	//---------------------------------------------------------------------
+	// Native functions
+	//---------------------------------------------------------------------
+
+	inline std::size_t __getShardIndex()
+	{
+		return static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData())->shard;
+	}
+
+	void Shard_GetIndex(Dart_NativeArguments args)
+	{
+		Dart_SetReturnValue(args, Dart_NewInteger(__getShardIndex()));
+	}
+
+	void Shard_GetCount(Dart_NativeArguments args)
+	{
+		Dart_SetReturnValue(args, Dart_NewInteger(Shards::getCount()));
+	}
+
+	void Shard_Select(Dart_NativeArguments args)
+	{
+		Dart_SetReturnValue(args, Dart_NewInteger(Shards::select()));
+	}
+
+	void Shard_ConnectionOpened(Dart_NativeArguments args)
+	{
+		Shards::connectionOpened(__getShardIndex());
+	}
+
+	void Shard_ConnectionClosed(Dart_NativeArguments args)
+	{
+		Shards::connectionClosed(__getShardIndex());
+	}
+
+	void Shard_NewDrainServicePort(Dart_NativeArguments args)
+	{
+		ScopedLock lock(__mutex);
+
+		if (__drainServicePort == kIllegalPort)
+			__drainServicePort = Dart_NewNativePort("ShardDrainService", __handleDrainMessage, false);
+
+		Dart_SetReturnValue(args, Dart_NewSendPort(__drainServicePort));
+	}
+
+	void SendBacklog_FindSocket(Dart_NativeArguments args)
+	{
+		Dart_EnterScope();
+
+		const char* remoteHost = 0;
+		std::int64_t remotePort = 0;
+		std::int64_t localPort = 0;
+		std::intptr_t socket = -1;
+
+		if (!Dart_IsError(Dart_StringToCString(Dart_GetNativeArgument(args, 0), &remoteHost)) &&
+		    !Dart_IsError(Dart_IntegerToInt64(Dart_GetNativeArgument(args, 1), &remotePort)) &&
+		    !Dart_IsError(Dart_IntegerToInt64(Dart_GetNativeArgument(args, 2), &localPort)))
+		{
+			socket = SendBacklog::findSocket(remoteHost, remotePort, localPort);
+		}
+
+		Dart_SetReturnValue(args, Dart_NewInteger(socket));
+
+		Dart_ExitScope();
+	}
+
+	void SendBacklog_GetUnsentBytes(Dart_NativeArguments args)
+	{
+		Dart_EnterScope();
+
+		std::int64_t socket = -1;
+		std::int64_t bytes = -1;
+
+		if (!Dart_IsError(Dart_IntegerToInt64(Dart_GetNativeArgument(args, 0), &socket)) && (socket >= 0))
+			bytes = SendBacklog::getUnsentBytes(static_cast<std::intptr_t>(socket));
+
+		Dart_SetReturnValue(args, Dart_NewInteger(bytes));
+
+		Dart_ExitScope();
+	}
+
+	//---------------------------------------------------------------------
+	// Virtual machine entries
+	//---------------------------------------------------------------------
+
+	/// Whether the library has been initialized
+	bool __libraryInitialized = false;
+	/// Class entries for the shard library
+	NativeClassEntry __libraryEntries[3];
+
+	/// Native entries for the Shard class
+	NativeEntry __shardNativeEntries[7];
+	/// Native entries for the SendBacklog class
+	NativeEntry __sendBacklogNativeEntries[3];
+
+	/**
+	 * Setup hooks to the Shard class entries.
+	 */
+	void __setupShardEntries()
+	{
+		setNativeEntry(&__shardNativeEntries[0], "GetIndex",            Shard_GetIndex,            0);
+		setNativeEntry(&__shardNativeEntries[1], "GetCount",            Shard_GetCount,            0);
+		setNativeEntry(&__shardNativeEntries[2], "Select",              Shard_Select,              0);
+		setNativeEntry(&__shardNativeEntries[3], "ConnectionOpened",    Shard_ConnectionOpened,    0);
+		setNativeEntry(&__shardNativeEntries[4], "ConnectionClosed",    Shard_ConnectionClosed,    0);
+		setNativeEntry(&__shardNativeEntries[5], "NewDrainServicePort", Shard_NewDrainServicePort, 0);
+		// Set the sentinal value
+		setNativeEntry(&__shardNativeEntries[6], "", 0, 0);
+	}
+
+	/**
+	 * Setup hooks to the SendBacklog class entries.
+	 */
+	void __setupSendBacklogEntries()
+	{
+		setNativeEntry(&__sendBacklogNativeEntries[0], "FindSocket",     SendBacklog_FindSocket,     3);
+		setNativeEntry(&__sendBacklogNativeEntries[1], "GetUnsentBytes", SendBacklog_GetUnsentBytes, 1);
+		// Set the sentinal value
+		setNativeEntry(&__sendBacklogNativeEntries[2], "", 0, 0);
+	}
+
+	/**
+	 * Setup the class entries.
+	 */
+	void __setupClassEntries()
+	{
+		setNativeClassEntry(&__libraryEntries[0], "Shard",       __shardNativeEntries);
+		setNativeClassEntry(&__libraryEntries[1], "SendBacklog", __sendBacklogNativeEntries);
+		// Set the sentinal value
+		setNativeClassEntry(&__libraryEntries[2], "", 0);
+	}
+
+	/**
+	 * Sets up the native entries for the shard library.
+	 */
+	void __setupShardLibrary()
+	{
+		if (!__libraryInitialized)
+		{
+			__setupClassEntries();
+			__setupShardEntries();
+			__setupSendBacklogEntries();
+		}
+
+		__libraryInitialized = true;
+	}
+
+	/**
+	 * Native resolver for the embed:shard library.
+	 */
+	//CREATE_NATIVE_RESOLVER(__shardLibraryResolver, __libraryEntries)
+	Dart_NativeFunction __shardLibraryResolver(Dart_Handle name, int argumentCount)
+	{
+		const char* nativeFunctionName = 0;
+		Dart_Handle result = Dart_StringToCString(name, &nativeFunctionName);
+
+		assert(nativeFunctionName);
+
+		NativeCallHash hash;
+		fnv1aHashFunctionCall(nativeFunctionName, &hash);
+
+		NativeClassEntry* classEntry = __libraryEntries;
+
+		while (classEntry->entries != 0)
+		{
+			NativeEntry* functionEntry = classEntry->entries;
+
+			if (classEntry->hash == hash.classHash)
+			{
+				while (functionEntry->function != 0)
+				{
+					if (functionEntry->hash == hash.functionHash)
+					{
+						assert(functionEntry->argumentCount == argumentCount);
+						return functionEntry->function;
+					}
+
+					functionEntry++;
+				}
+
+				return 0;
+			}
+
+			classEntry++;
+		}
+
+		return 0;
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::createShardLibrary()
+{
+	// Setup the native entries
+	__setupShardLibrary();
+
+	VirtualMachine::loadScriptLibrary("embed:shard", __sourceCode, __shardLibraryResolver);
+}
+
+//---------------------------------------------------------------------
+
+void EmbedLibraries::terminateShardLibrary()
+{
+	ScopedLock lock(__mutex);
+
+	if (__drainServicePort != kIllegalPort)
+		Dart_CloseNativePort(__drainServicePort);
+
+	__drainServicePort = kIllegalPort;
+}
@@ -0,0 +1,317 @@
+/**
+ * \file Shards.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Shards.hpp"
+#include <DartEmbed/Isolate.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "dart_api.h"
+#include "EmbedIsolateData.hpp"
+#include "MessageLoop.hpp"
+#include "ThreadConfiguration.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/**
+	 * A serving isolate and the thread running it.
+	 */
+	struct Shard
+	{
+		/// The index of the shard
+		std::size_t index;
+		/// The number of connections the shard holds
+		std::size_t connections;
+		/// The port notified when the shard should drain
+		Dart_Port drainPort;
+		/// The isolate serving the script
+		Dart_Isolate isolate;
+		/// Whether the isolate is serving messages
+		bool running;
+		/// The loop handling messages for the isolate
+		MessageLoop loop;
+		/// The thread running the loop
+		Thread thread;
+	} ; // end struct Shard
+
+	/// Guards the shards
+	Mutex __mutex;
+	/// The running shards
+	std::vector<Shard*> __shards;
+	/// The path to the script
+	char* __path = 0;
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+bool Shards::start(const char* path, std::size_t count)
+{
+	bool started = true;
+
+	{
+		ScopedLock lock(__mutex);
+
+		if (!__shards.empty() || (count == 0))
+			return false;
+
+		__path = strdup(path);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			Shard* shard = new Shard();
+			shard->index = i;
+			shard->connections = 0;
+			shard->drainPort = kIllegalPort;
+			shard->isolate = 0;
+			shard->running = false;
+
+			__shards.push_back(shard);
+		}
+
+		std::size_t processors = Thread::getNumberOfProcessors();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			ThreadOptions options = ThreadConfiguration::getOptions(ThreadRole::Shard, i);
+
+			// Keep each shard on its own processor unless configured otherwise
+			if ((options.affinity == 0) && (count > 1) && (i % processors < 64))
+				options.affinity = static_cast<std::uint64_t>(1) << (i % processors);
+
+			if (!__shards[i]->thread.start(run, __shards[i], options))
+			{
+				printf("Unable to start shard %u\n", static_cast<unsigned int>(i));
+				started = false;
+				break;
+			}
+		}
+	}
+
+	// Stop the shards that did start outside the lock as they use it while running
+	if (!started)
+		stop();
+
+	return started;
+}
+
+//----------------------------------------------------------------------
+
+void Shards::stop()
+{
+	std::vector<Shard*> shards;
+
+	{
+		ScopedLock lock(__mutex);
+
+		shards.swap(__shards);
+	}
+
+	std::size_t count = shards.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+		shards[i]->loop.stop();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		shards[i]->thread.join();
+		delete shards[i];
+	}
+
+	free(__path);
+	__path = 0;
+}
+
+//----------------------------------------------------------------------
+
+std::size_t Shards::getCount()
+{
+	ScopedLock lock(__mutex);
+
+	return __shards.size();
+}
+
+//----------------------------------------------------------------------
+
+std::size_t Shards::select()
+{
+	ScopedLock lock(__mutex);
+
+	Shard* selected = 0;
+	std::size_t count = __shards.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Shard* shard = __shards[i];
+
+		// Shards that failed to load or have exited aren't listening
+		if (!shard->running)
+			continue;
+
+		if ((!selected) || (shard->connections < selected->connections))
+			selected = shard;
+	}
+
+	return (selected) ? selected->index : 0;
+}
+
+//----------------------------------------------------------------------
+
+void Shards::connectionOpened(std::size_t index)
+{
+	ScopedLock lock(__mutex);
+
+	if (index < __shards.size())
+		__shards[index]->connections++;
+}
+
+//----------------------------------------------------------------------
+
+void Shards::connectionClosed(std::size_t index)
+{
+	ScopedLock lock(__mutex);
+
+	if ((index < __shards.size()) && (__shards[index]->connections > 0))
+		__shards[index]->connections--;
+}
+
+//----------------------------------------------------------------------
+
+std::size_t Shards::getNumberOfConnections()
+{
+	ScopedLock lock(__mutex);
+
+	std::size_t connections = 0;
+	std::size_t count = __shards.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+		connections += __shards[i]->connections;
+
+	return connections;
+}
+
+//----------------------------------------------------------------------
+
+void Shards::setDrainPort(std::size_t index, Dart_Port port)
+{
+	ScopedLock lock(__mutex);
+
+	if (index < __shards.size())
+		__shards[index]->drainPort = port;
+}
+
+//----------------------------------------------------------------------
+
+void Shards::drain(std::uint32_t timeout)
+{
+	ScopedLock lock(__mutex);
+
+	std::size_t count = __shards.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (__shards[i]->drainPort == kIllegalPort)
+			continue;
+
+		Dart_CObject message;
+		message.type = Dart_CObject::kInt32;
+		message.value.as_int32 = static_cast<std::int32_t>(timeout);
+
+		Dart_PostCObject(__shards[i]->drainPort, &message);
+
+		__shards[i]->drainPort = kIllegalPort;
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Shards::run(void* argument)
+{
+	Shard* shard = static_cast<Shard*>(argument);
+
+	Isolate* isolate = Isolate::loadScript(__path);
+
+	if (!isolate)
+	{
+		printf("Unable to load %s for shard %u\n", __path, static_cast<unsigned int>(shard->index));
+		return;
+	}
+
+	static_cast<EmbedIsolateData*>(Dart_CurrentIsolateData())->shard = shard->index;
+	shard->isolate = Dart_CurrentIsolate();
+
+	// Attach before invoking so no messages are missed
+	shard->loop.addIsolate(isolate);
+	isolate->invokeFunction("main");
+
+	{
+		ScopedLock lock(__mutex);
+
+		shard->running = true;
+	}
+
+	// Main is already accepting connections so compile between messages
+	if (VirtualMachine::getWarmUpMode() == WarmUpMode::Background)
+		shard->loop.post(warmUp, shard);
+
+	// Handle messages until the isolate is done or the loop is stopped
+	shard->loop.run();
+
+	{
+		ScopedLock lock(__mutex);
+
+		shard->running = false;
+	}
+
+	isolate->shutdown();
+}
+
+//----------------------------------------------------------------------
+
+void Shards::warmUp(void* argument)
+{
+	Shard* shard = static_cast<Shard*>(argument);
+	Dart_Isolate current = Dart_CurrentIsolate();
+
+	// Isolates stay entered until another needs the thread
+	if (current != shard->isolate)
+	{
+		if (current)
+			Dart_ExitIsolate();
+
+		Dart_EnterIsolate(shard->isolate);
+	}
+
+	Dart_EnterScope();
+	Isolate::compileAll(__path);
+	Dart_ExitScope();
+}
@@ -0,0 +1,150 @@
+/**
+ * \file Shards.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_SHARDS_HPP_INCLUDED
+#define DART_EMBED_SHARDS_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include "dart_api.h"
+
+namespace DartEmbed
+{
+	/**
+	 * Runs several serving isolates of the same script.
+	 *
+	 * Each shard is an isolate with its own thread and MessageLoop. When
+	 * there is more than one shard each thread is pinned to a processor.
+	 * Shards track how many connections they hold so new connections can
+	 * be directed to the least loaded one.
+	 */
+	class Shards
+	{
+		public:
+
+			/**
+			 * Starts the shards.
+			 *
+			 * Every shard loads the script and invokes main. If any shard fails
+			 * to start the ones already started are stopped.
+			 *
+			 * \param path The path to the script.
+			 * \param count The number of shards to start.
+			 * \returns true if the shards were started; false otherwise.
+			 */
+			static bool start(const char* path, std::size_t count);
+
+			/**
+			 * Stops the message loops of the shards and waits for their threads.
+			 */
+			static void stop();
+
+			/**
+			 * Queries the number of shards running.
+			 *
+			 * \returns The number of shards running.
+			 */
+			static std::size_t getCount();
+
+			/**
+			 * Selects the running shard holding the fewest connections.
+			 *
+			 * Shards whose script failed to load or whose isolate has exited
+			 * are skipped.
+			 *
+			 * \returns The index of the shard, or 0 if no shard is running.
+			 */
+			static std::size_t select();
+
+			/**
+			 * Records a connection being opened on a shard.
+			 *
+			 * \param index The index of the shard.
+			 */
+			static void connectionOpened(std::size_t index);
+
+			/**
+			 * Records a connection being closed on a shard.
+			 *
+			 * \param index The index of the shard.
+			 */
+			static void connectionClosed(std::size_t index);
+
+			/**
+			 * Queries the number of connections held by all the shards.
+			 *
+			 * \returns The number of connections.
+			 */
+			static std::size_t getNumberOfConnections();
+
+			/**
+			 * Sets the port notified when a shard should drain.
+			 *
+			 * \param index The index of the shard.
+			 * \param port The port to notify.
+			 */
+			static void setDrainPort(std::size_t index, Dart_Port port);
+
+			/**
+			 * Asks the shards to stop accepting and close their connections.
+			 *
+			 * Each drain port receives the time allowed so the shards can
+			 * spread the closes out rather than have every client reconnect
+			 * at once.
+			 *
+			 * \param timeout Time allowed to drain in milliseconds.
+			 */
+			static void drain(std::uint32_t timeout);
+
+		private:
+
+			/**
+			 * Runs a shard until its loop is stopped.
+			 *
+			 * \param argument The shard to run.
+			 */
+			static void run(void* argument);
+
+			/**
+			 * Compiles the isolate of a shard.
+			 *
+			 * Posted to the shard's loop after main returns when warming up
+			 * in the background.
+			 *
+			 * \param argument The shard to compile.
+			 */
+			static void warmUp(void* argument);
+
+			Shards() { }
+	} ; // end class Shards
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_SHARDS_HPP_INCLUDED
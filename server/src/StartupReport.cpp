@@ -0,0 +1,224 @@
+/**
+ * \file StartupReport.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "StartupReport.hpp"
+#include <cstdlib>
+#include <cstring>
+#include "dart_api.h"
+#include "Clock.hpp"
+#include "Thread.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// The maximum number of phases kept
+	const std::size_t __maxPhases = 256;
+	/// The maximum length of the detail kept for a phase
+	const std::size_t __maxDetailLength = 128;
+
+	/**
+	 * A recorded phase of startup.
+	 */
+	struct Phase
+	{
+		/// The name of the phase
+		const char* name;
+		/// Additional information about the phase
+		char detail[__maxDetailLength];
+		/// The isolate the phase ran in or 0 for the virtual machine
+		std::uintptr_t isolate;
+		/// The time the phase started
+		std::uint64_t start;
+		/// The time the phase ended
+		std::uint64_t end;
+	} ; // end struct Phase
+
+	/// Guards the recorded phases
+	Mutex __mutex;
+	/// The recorded phases
+	Phase __phases[__maxPhases];
+	/// The number of recorded phases
+	std::size_t __phaseCount = 0;
+	/// The number of phases dropped as the report was full
+	std::size_t __droppedCount = 0;
+	/// The time the first phase started
+	std::uint64_t __origin = 0;
+	/// The path to write the report to
+	char* __outputPath = 0;
+
+	/**
+	 * Writes a string as a JSON string literal.
+	 *
+	 * \param stream The stream to write to.
+	 * \param value The string to write.
+	 */
+	void __writeString(FILE* stream, const char* value)
+	{
+		fputc('"', stream);
+
+		while (*value != '\0')
+		{
+			char c = *value++;
+
+			if ((c == '"') || (c == '\\'))
+			{
+				fputc('\\', stream);
+				fputc(c, stream);
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				fprintf(stream, "\\u%04x", c);
+			}
+			else
+			{
+				fputc(c, stream);
+			}
+		}
+
+		fputc('"', stream);
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+void StartupReport::record(const char* name, const char* detail, std::uint64_t start, std::uint64_t end)
+{
+	std::uintptr_t isolate = reinterpret_cast<std::uintptr_t>(Dart_CurrentIsolate());
+
+	ScopedLock lock(__mutex);
+
+	if (__phaseCount == __maxPhases)
+	{
+		__droppedCount++;
+		return;
+	}
+
+	if ((__phaseCount == 0) || (start < __origin))
+		__origin = start;
+
+	Phase& phase = __phases[__phaseCount++];
+
+	phase.name = name;
+	phase.isolate = isolate;
+	phase.start = start;
+	phase.end = end;
+
+	if (detail)
+	{
+		strncpy(phase.detail, detail, __maxDetailLength - 1);
+		phase.detail[__maxDetailLength - 1] = '\0';
+	}
+	else
+	{
+		phase.detail[0] = '\0';
+	}
+}
+
+//----------------------------------------------------------------------
+
+void StartupReport::setOutputPath(const char* path)
+{
+	ScopedLock lock(__mutex);
+
+	free(__outputPath);
+	__outputPath = (path) ? strdup(path) : 0;
+}
+
+//----------------------------------------------------------------------
+
+void StartupReport::writeToOutputPath()
+{
+	char* path;
+
+	{
+		ScopedLock lock(__mutex);
+
+		if (!__outputPath)
+			return;
+
+		path = strdup(__outputPath);
+	}
+
+	FILE* stream = fopen(path, "w");
+
+	if (stream)
+	{
+		write(stream);
+		fclose(stream);
+	}
+	else
+	{
+		printf("Unable to write startup report to %s\n", path);
+	}
+
+	free(path);
+}
+
+//----------------------------------------------------------------------
+
+void StartupReport::write(FILE* stream)
+{
+	ScopedLock lock(__mutex);
+
+	fprintf(stream, "{\n  \"unit\": \"us\",\n  \"dropped\": %u,\n  \"phases\": [", static_cast<unsigned int>(__droppedCount));
+
+	for (std::size_t i = 0; i < __phaseCount; ++i)
+	{
+		const Phase& phase = __phases[i];
+
+		fprintf(stream, (i == 0) ? "\n    { \"name\": " : ",\n    { \"name\": ");
+		__writeString(stream, phase.name);
+		fprintf(stream, ", \"detail\": ");
+		__writeString(stream, phase.detail);
+		fprintf(stream, ", \"isolate\": %llu, \"start\": %llu, \"duration\": %llu }",
+			static_cast<unsigned long long>(phase.isolate),
+			static_cast<unsigned long long>(phase.start - __origin),
+			static_cast<unsigned long long>(phase.end - phase.start));
+	}
+
+	fprintf(stream, "\n  ]\n}\n");
+}
+
+//----------------------------------------------------------------------
+
+StartupPhase::StartupPhase(const char* name, const char* detail)
+	: _name(name)
+	, _detail(detail)
+	, _start((name) ? Clock::getMicroseconds() : 0)
+{ }
+
+//----------------------------------------------------------------------
+
+StartupPhase::~StartupPhase()
+{
+	if (_name)
+		StartupReport::record(_name, _detail, _start, Clock::getMicroseconds());
+}
@@ -0,0 +1,115 @@
+/**
+ * \file StartupReport.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_STARTUP_REPORT_HPP_INCLUDED
+#define DART_EMBED_STARTUP_REPORT_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+
+namespace DartEmbed
+{
+	/**
+	 * Records how long each phase of startup takes.
+	 *
+	 * Phases are recorded from any thread with timestamps taken from the
+	 * monotonic clock. Only the first phases up to a fixed limit are kept
+	 * so isolates spawned later in the life of the process can't grow the
+	 * report without bound.
+	 */
+	namespace StartupReport
+	{
+		/**
+		 * Records a phase of startup.
+		 *
+		 * \param name The name of the phase. Must be a string literal.
+		 * \param detail Additional information such as a library name. May be 0.
+		 * \param start The time the phase started in microseconds.
+		 * \param end The time the phase ended in microseconds.
+		 */
+		void record(const char* name, const char* detail, std::uint64_t start, std::uint64_t end);
+
+		/**
+		 * Sets the file the report is written to once startup completes.
+		 *
+		 * \param path The path to write the report to.
+		 */
+		void setOutputPath(const char* path);
+
+		/**
+		 * Writes the report to the output path if one was set.
+		 */
+		void writeToOutputPath();
+
+		/**
+		 * Writes the report as JSON.
+		 *
+		 * \param stream The stream to write to.
+		 */
+		void write(FILE* stream);
+	} // end namespace StartupReport
+
+	/**
+	 * Records a phase of startup for the lifetime of the object.
+	 */
+	class StartupPhase
+	{
+		public:
+
+			/**
+			 * Starts timing a phase.
+			 *
+			 * \param name The name of the phase or 0 to record nothing.
+			 * \param detail Additional information such as a library name. May be 0.
+			 */
+			StartupPhase(const char* name, const char* detail = 0);
+
+			/**
+			 * Records the phase.
+			 */
+			~StartupPhase();
+
+		private:
+
+			// Copying is not allowed
+			StartupPhase(const StartupPhase&);
+			StartupPhase& operator= (const StartupPhase&);
+
+			/// The name of the phase
+			const char* _name;
+			/// Additional information about the phase
+			const char* _detail;
+			/// The time the phase started
+			std::uint64_t _start;
+	} ; // end class StartupPhase
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_STARTUP_REPORT_HPP_INCLUDED
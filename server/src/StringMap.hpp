@@ -0,0 +1,257 @@
+/**
+ * \file StringMap.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_STRING_MAP_HPP_INCLUDED
+#define DART_EMBED_STRING_MAP_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "NativeResolution.hpp"
+
+namespace DartEmbed
+{
+	/**
+	 * Maps strings to values using open addressing.
+	 *
+	 * Entries are located by their FNV1A hash and then verified against the
+	 * full key so colliding hashes never return the wrong value. The map
+	 * holds its own copy of every key.
+	 *
+	 * The map is not synchronized. Either populate it before it is shared
+	 * between threads or keep it local to a single isolate.
+	 */
+	template <typename T>
+	class StringMap
+	{
+		//---------------------------------------------------------------------
+		// Creation/Destruction
+		//---------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Creates an instance of the StringMap class.
+			 *
+			 * \param capacity The initial number of slots. Rounded up to a power of two.
+			 */
+			explicit StringMap(std::size_t capacity = 16)
+				: _entries(0)
+				, _capacity(8)
+				, _size(0)
+			{
+				while (_capacity < capacity)
+					_capacity <<= 1;
+
+				_entries = new Entry[_capacity]();
+			}
+
+			/**
+			 * Destroys the StringMap.
+			 */
+			~StringMap()
+			{
+				clear();
+
+				delete[] _entries;
+			}
+
+		//---------------------------------------------------------------------
+		// Properties
+		//---------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Gets the number of entries within the map.
+			 *
+			 * \returns The number of entries within the map.
+			 */
+			inline std::size_t getSize() const
+			{
+				return _size;
+			}
+
+		//---------------------------------------------------------------------
+		// Class methods
+		//---------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Finds the value associated with the key.
+			 *
+			 * \param key The key to search for.
+			 * \returns A pointer to the value if found; 0 otherwise.
+			 */
+			T* find(const char* key) const
+			{
+				Entry* entry = findEntry(key, fnv1aHash(key));
+
+				return (entry->key != 0) ? &entry->value : 0;
+			}
+
+			/**
+			 * Associates a value with the key.
+			 *
+			 * Any value already associated with the key is replaced.
+			 *
+			 * \param key The key to associate the value with.
+			 * \param value The value to store.
+			 * \returns A pointer to the stored value.
+			 */
+			T* insert(const char* key, const T& value)
+			{
+				std::int32_t hash = fnv1aHash(key);
+				Entry* entry = findEntry(key, hash);
+
+				if (entry->key == 0)
+				{
+					// Keep the load factor at or below one half
+					if ((_size + 1) * 2 > _capacity)
+					{
+						grow();
+						entry = findEntry(key, hash);
+					}
+
+					std::size_t length = strlen(key) + 1;
+					entry->key = static_cast<char*>(malloc(length));
+					memcpy(entry->key, key, length);
+					entry->hash = hash;
+
+					_size++;
+				}
+
+				entry->value = value;
+
+				return &entry->value;
+			}
+
+			/**
+			 * Removes all entries from the map.
+			 */
+			void clear()
+			{
+				for (std::size_t i = 0; i < _capacity; ++i)
+				{
+					free(_entries[i].key);
+
+					_entries[i].key = 0;
+					_entries[i].value = T();
+				}
+
+				_size = 0;
+			}
+
+		private:
+
+			/**
+			 * An entry within the map.
+			 */
+			struct Entry
+			{
+				/// Hash of the key
+				std::int32_t hash;
+				/// The key or 0 if the slot is empty
+				char* key;
+				/// The value associated with the key
+				T value;
+			} ; // end struct Entry
+
+			/**
+			 * Locates the slot for the key.
+			 *
+			 * \param key The key to search for.
+			 * \param hash The hash of the key.
+			 * \returns The slot holding the key or the empty slot where it belongs.
+			 */
+			Entry* findEntry(const char* key, std::int32_t hash) const
+			{
+				std::size_t mask = _capacity - 1;
+				std::size_t index = static_cast<std::uint32_t>(hash) & mask;
+
+				while (true)
+				{
+					Entry* entry = &_entries[index];
+
+					if (entry->key == 0)
+						return entry;
+
+					if ((entry->hash == hash) && (strcmp(entry->key, key) == 0))
+						return entry;
+
+					index = (index + 1) & mask;
+				}
+			}
+
+			/**
+			 * Doubles the number of slots within the map.
+			 */
+			void grow()
+			{
+				Entry* entries = _entries;
+				std::size_t capacity = _capacity;
+
+				_capacity <<= 1;
+				_entries = new Entry[_capacity]();
+
+				for (std::size_t i = 0; i < capacity; ++i)
+				{
+					if (entries[i].key != 0)
+					{
+						Entry* entry = findEntry(entries[i].key, entries[i].hash);
+						*entry = entries[i];
+					}
+				}
+
+				delete[] entries;
+			}
+
+			// Copying is not allowed
+			StringMap(const StringMap&);
+			StringMap& operator= (const StringMap&);
+
+		//---------------------------------------------------------------------
+		// Member variables
+		//---------------------------------------------------------------------
+
+		private:
+
+			/// The slots within the map
+			Entry* _entries;
+			/// The number of slots
+			std::size_t _capacity;
+			/// The number of entries
+			std::size_t _size;
+	} ; // end class StringMap
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_STRING_MAP_HPP_INCLUDED
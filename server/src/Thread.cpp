@@ -0,0 +1,587 @@
+/**
+ * \file Thread.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Thread.hpp"
+#include <cstdio>
+
+#ifdef _WIN32
+#include "PlatformWindows.hpp"
+#else
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+using namespace DartEmbed;
+
+namespace DartEmbed
+{
+	/**
+	 * Entry point for threads created through the Thread class.
+	 */
+	struct ThreadEntry
+	{
+		/**
+		 * Applies the thread's options and runs its function.
+		 *
+		 * \param thread The Thread to run.
+		 */
+		static void run(Thread* thread)
+		{
+			Thread::configureCurrent(thread->_options);
+			thread->_function(thread->_argument);
+		}
+
+#ifdef _WIN32
+		static DWORD WINAPI start(LPVOID param)
+		{
+			run(static_cast<Thread*>(param));
+			return 0;
+		}
+#else
+		static void* start(void* param)
+		{
+			run(static_cast<Thread*>(param));
+			return 0;
+		}
+#endif
+	} ; // end struct ThreadEntry
+} // end namespace DartEmbed
+
+namespace
+{
+#if defined(_WIN32) && defined(_MSC_VER)
+	/// Exception code debuggers use to name a thread
+	const DWORD __setThreadNameException = 0x406D1388;
+
+#pragma pack(push, 8)
+	/**
+	 * Information passed to the debugger when naming a thread.
+	 */
+	struct ThreadNameInfo
+	{
+		/// Must be 0x1000
+		DWORD type;
+		/// The name of the thread
+		LPCSTR name;
+		/// The thread to name or -1 for the calling thread
+		DWORD threadId;
+		/// Reserved
+		DWORD flags;
+	} ; // end struct ThreadNameInfo
+#pragma pack(pop)
+#endif
+
+	/**
+	 * Names the calling thread.
+	 *
+	 * \param name The name of the thread.
+	 * \returns true if the thread was named; false otherwise.
+	 */
+	bool __setCurrentName(const char* name)
+	{
+#if defined(_WIN32)
+#if defined(_MSC_VER)
+		ThreadNameInfo info;
+		info.type = 0x1000;
+		info.name = name;
+		info.threadId = static_cast<DWORD>(-1);
+		info.flags = 0;
+
+		// Only an attached debugger sees the name
+		__try
+		{
+			RaiseException(__setThreadNameException, 0, sizeof(info) / sizeof(ULONG_PTR), reinterpret_cast<ULONG_PTR*>(&info));
+		}
+		__except (EXCEPTION_EXECUTE_HANDLER)
+		{ }
+
+		return true;
+#else
+		return false;
+#endif
+#elif defined(__APPLE__)
+		return pthread_setname_np(name) == 0;
+#elif defined(__linux__)
+		// Linux limits names to 15 characters
+		char truncated[16];
+		strncpy(truncated, name, sizeof(truncated) - 1);
+		truncated[sizeof(truncated) - 1] = '\0';
+
+		return pthread_setname_np(pthread_self(), truncated) == 0;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Restricts the calling thread to a set of processors.
+	 *
+	 * \param mask Mask of the processors the thread may run on.
+	 * \returns true if the affinity was set; false otherwise.
+	 */
+	bool __setCurrentAffinity(std::uint64_t mask)
+	{
+#if defined(_WIN32)
+		return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(mask)) != 0;
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+
+		for (std::size_t i = 0; i < 64; ++i)
+		{
+			if (mask & (static_cast<std::uint64_t>(1) << i))
+				CPU_SET(i, &set);
+		}
+
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	/**
+	 * Sets how the calling thread is scheduled.
+	 *
+	 * \param policy The scheduling policy.
+	 * \param priority The nice level or real-time priority.
+	 * \returns true if the scheduling was set; false otherwise.
+	 */
+	bool __setCurrentScheduling(SchedulingPolicy::Enum policy, std::int32_t priority)
+	{
+#if defined(_WIN32)
+		// Windows has priority classes rather than policies
+		int value;
+
+		if (policy != SchedulingPolicy::Normal)
+			value = THREAD_PRIORITY_TIME_CRITICAL;
+		else if (priority <= -10)
+			value = THREAD_PRIORITY_HIGHEST;
+		else if (priority < 0)
+			value = THREAD_PRIORITY_ABOVE_NORMAL;
+		else if (priority == 0)
+			value = THREAD_PRIORITY_NORMAL;
+		else if (priority < 10)
+			value = THREAD_PRIORITY_BELOW_NORMAL;
+		else
+			value = THREAD_PRIORITY_LOWEST;
+
+		return SetThreadPriority(GetCurrentThread(), value) != FALSE;
+#else
+		if (policy != SchedulingPolicy::Normal)
+		{
+			sched_param parameters;
+			parameters.sched_priority = priority;
+
+			return pthread_setschedparam(pthread_self(), (policy == SchedulingPolicy::Fifo) ? SCHED_FIFO : SCHED_RR, &parameters) == 0;
+		}
+
+		if (priority == 0)
+			return true;
+
+#if defined(__linux__)
+		// Nice levels apply to individual threads on Linux
+		return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), priority) == 0;
+#else
+		return false;
+#endif
+#endif
+	}
+} // end anonymous namespace
+
+#ifdef _WIN32
+
+//----------------------------------------------------------------------
+// Mutex
+//----------------------------------------------------------------------
+
+Mutex::Mutex()
+	: _handle(new CRITICAL_SECTION)
+{
+	InitializeCriticalSection(static_cast<CRITICAL_SECTION*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+Mutex::~Mutex()
+{
+	CRITICAL_SECTION* criticalSection = static_cast<CRITICAL_SECTION*>(_handle);
+
+	DeleteCriticalSection(criticalSection);
+	delete criticalSection;
+}
+
+//----------------------------------------------------------------------
+
+void Mutex::lock()
+{
+	EnterCriticalSection(static_cast<CRITICAL_SECTION*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+void Mutex::unlock()
+{
+	LeaveCriticalSection(static_cast<CRITICAL_SECTION*>(_handle));
+}
+
+//----------------------------------------------------------------------
+// ConditionVariable
+//----------------------------------------------------------------------
+
+ConditionVariable::ConditionVariable()
+	: _handle(new CONDITION_VARIABLE)
+{
+	InitializeConditionVariable(static_cast<CONDITION_VARIABLE*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+ConditionVariable::~ConditionVariable()
+{
+	delete static_cast<CONDITION_VARIABLE*>(_handle);
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::wait(Mutex& mutex)
+{
+	SleepConditionVariableCS(
+		static_cast<CONDITION_VARIABLE*>(_handle),
+		static_cast<CRITICAL_SECTION*>(mutex._handle),
+		INFINITE);
+}
+
+//----------------------------------------------------------------------
+
+bool ConditionVariable::wait(Mutex& mutex, std::uint32_t milliseconds)
+{
+	return SleepConditionVariableCS(
+		static_cast<CONDITION_VARIABLE*>(_handle),
+		static_cast<CRITICAL_SECTION*>(mutex._handle),
+		milliseconds) != FALSE;
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::signal()
+{
+	WakeConditionVariable(static_cast<CONDITION_VARIABLE*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::broadcast()
+{
+	WakeAllConditionVariable(static_cast<CONDITION_VARIABLE*>(_handle));
+}
+
+//----------------------------------------------------------------------
+// Thread
+//----------------------------------------------------------------------
+
+bool Thread::start(Function function, void* argument, const ThreadOptions& options)
+{
+	if (_handle != 0)
+		return false;
+
+	_function = function;
+	_argument = argument;
+	_options = options;
+
+	DWORD threadId;
+	_handle = CreateThread(0, options.stackSize, ThreadEntry::start, this, 0, &threadId);
+
+	return _handle != 0;
+}
+
+//----------------------------------------------------------------------
+
+void Thread::join()
+{
+	if (_handle != 0)
+	{
+		WaitForSingleObject(_handle, INFINITE);
+		CloseHandle(_handle);
+
+		_handle = 0;
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Thread::sleep(std::uint32_t milliseconds)
+{
+	Sleep(milliseconds);
+}
+
+//----------------------------------------------------------------------
+
+std::size_t Thread::getNumberOfProcessors()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors;
+}
+
+#else
+
+//----------------------------------------------------------------------
+// Mutex
+//----------------------------------------------------------------------
+
+Mutex::Mutex()
+	: _handle(new pthread_mutex_t)
+{
+	pthread_mutex_init(static_cast<pthread_mutex_t*>(_handle), 0);
+}
+
+//----------------------------------------------------------------------
+
+Mutex::~Mutex()
+{
+	pthread_mutex_t* mutex = static_cast<pthread_mutex_t*>(_handle);
+
+	pthread_mutex_destroy(mutex);
+	delete mutex;
+}
+
+//----------------------------------------------------------------------
+
+void Mutex::lock()
+{
+	pthread_mutex_lock(static_cast<pthread_mutex_t*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+void Mutex::unlock()
+{
+	pthread_mutex_unlock(static_cast<pthread_mutex_t*>(_handle));
+}
+
+//----------------------------------------------------------------------
+// ConditionVariable
+//----------------------------------------------------------------------
+
+ConditionVariable::ConditionVariable()
+	: _handle(new pthread_cond_t)
+{
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+
+#ifdef __linux__
+	// Timed waits shouldn't be affected by changes to the wall clock
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+#endif
+
+	pthread_cond_init(static_cast<pthread_cond_t*>(_handle), &attributes);
+	pthread_condattr_destroy(&attributes);
+}
+
+//----------------------------------------------------------------------
+
+ConditionVariable::~ConditionVariable()
+{
+	pthread_cond_t* condition = static_cast<pthread_cond_t*>(_handle);
+
+	pthread_cond_destroy(condition);
+	delete condition;
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::wait(Mutex& mutex)
+{
+	pthread_cond_wait(
+		static_cast<pthread_cond_t*>(_handle),
+		static_cast<pthread_mutex_t*>(mutex._handle));
+}
+
+//----------------------------------------------------------------------
+
+bool ConditionVariable::wait(Mutex& mutex, std::uint32_t milliseconds)
+{
+	timespec deadline;
+
+#ifdef __linux__
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+#else
+	clock_gettime(CLOCK_REALTIME, &deadline);
+#endif
+
+	deadline.tv_sec  += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec  += 1;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	return pthread_cond_timedwait(
+		static_cast<pthread_cond_t*>(_handle),
+		static_cast<pthread_mutex_t*>(mutex._handle),
+		&deadline) != ETIMEDOUT;
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::signal()
+{
+	pthread_cond_signal(static_cast<pthread_cond_t*>(_handle));
+}
+
+//----------------------------------------------------------------------
+
+void ConditionVariable::broadcast()
+{
+	pthread_cond_broadcast(static_cast<pthread_cond_t*>(_handle));
+}
+
+//----------------------------------------------------------------------
+// Thread
+//----------------------------------------------------------------------
+
+bool Thread::start(Function function, void* argument, const ThreadOptions& options)
+{
+	if (_handle != 0)
+		return false;
+
+	_function = function;
+	_argument = argument;
+	_options = options;
+
+	pthread_attr_t attributes;
+	pthread_attr_init(&attributes);
+
+	if (options.stackSize != 0)
+		pthread_attr_setstacksize(&attributes, options.stackSize);
+
+	pthread_t* thread = new pthread_t;
+
+	if (pthread_create(thread, &attributes, ThreadEntry::start, this) == 0)
+		_handle = thread;
+	else
+		delete thread;
+
+	pthread_attr_destroy(&attributes);
+
+	return _handle != 0;
+}
+
+//----------------------------------------------------------------------
+
+void Thread::join()
+{
+	if (_handle != 0)
+	{
+		pthread_t* thread = static_cast<pthread_t*>(_handle);
+
+		pthread_join(*thread, 0);
+		delete thread;
+
+		_handle = 0;
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Thread::sleep(std::uint32_t milliseconds)
+{
+	timespec duration;
+	duration.tv_sec  = milliseconds / 1000;
+	duration.tv_nsec = (milliseconds % 1000) * 1000000;
+
+	while ((nanosleep(&duration, &duration) != 0) && (errno == EINTR))
+	{ }
+}
+
+//----------------------------------------------------------------------
+
+std::size_t Thread::getNumberOfProcessors()
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (count > 0) ? static_cast<std::size_t>(count) : 1;
+}
+
+#endif
+
+//----------------------------------------------------------------------
+
+Thread::Thread()
+	: _handle(0)
+	, _function(0)
+	, _argument(0)
+{ }
+
+//----------------------------------------------------------------------
+
+Thread::~Thread()
+{
+	join();
+}
+
+//----------------------------------------------------------------------
+
+bool Thread::configureCurrent(const ThreadOptions& options)
+{
+	bool applied = true;
+
+	if ((options.name[0] != '\0') && !__setCurrentName(options.name))
+	{
+		printf("Unable to name thread %s\n", options.name);
+		applied = false;
+	}
+
+	if ((options.affinity != 0) && !__setCurrentAffinity(options.affinity))
+	{
+		printf("Unable to set the affinity of thread %s\n", options.name);
+		applied = false;
+	}
+
+	if (((options.policy != SchedulingPolicy::Normal) || (options.priority != 0)) &&
+	    !__setCurrentScheduling(options.policy, options.priority))
+	{
+		printf("Unable to set the scheduling of thread %s\n", options.name);
+		applied = false;
+	}
+
+	return applied;
+}
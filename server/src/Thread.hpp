@@ -0,0 +1,344 @@
+/**
+ * \file Thread.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_THREAD_HPP_INCLUDED
+#define DART_EMBED_THREAD_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace DartEmbed
+{
+	/**
+	 * Specifies how the operating system schedules a thread.
+	 */
+	namespace SchedulingPolicy
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// Time shared with other threads; the priority is a nice level
+			Normal,
+			/// Real-time, first in first out; the priority is 1 to 99
+			Fifo,
+			/// Real-time, round robin; the priority is 1 to 99
+			RoundRobin,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace SchedulingPolicy
+
+	/**
+	 * Options applied to a thread when it starts.
+	 *
+	 * The defaults leave the thread as the operating system creates it.
+	 */
+	struct ThreadOptions
+	{
+		/// The maximum length of a name, including the terminator
+		static const std::size_t MaxNameLength = 32;
+
+		/**
+		 * Creates an instance of the ThreadOptions struct.
+		 */
+		ThreadOptions()
+			: affinity(0)
+			, policy(SchedulingPolicy::Normal)
+			, priority(0)
+			, stackSize(0)
+		{
+			name[0] = '\0';
+		}
+
+		/**
+		 * Sets the name of the thread.
+		 *
+		 * Names are truncated to fit; some platforms truncate them further.
+		 *
+		 * \param value The name of the thread.
+		 */
+		inline void setName(const char* value)
+		{
+			strncpy(name, value, MaxNameLength - 1);
+			name[MaxNameLength - 1] = '\0';
+		}
+
+		/// The name shown in debuggers and profilers; empty to leave unnamed
+		char name[MaxNameLength];
+		/// Mask of the processors the thread may run on; 0 for any
+		std::uint64_t affinity;
+		/// How the thread is scheduled
+		SchedulingPolicy::Enum policy;
+		/// The nice level or real-time priority depending on the policy
+		std::int32_t priority;
+		/// The size of the stack in bytes; 0 for the default
+		std::size_t stackSize;
+	} ; // end struct ThreadOptions
+
+	/**
+	 * Mutual exclusion lock.
+	 */
+	class Mutex
+	{
+		public:
+
+			/**
+			 * Creates an instance of the Mutex class.
+			 */
+			Mutex();
+
+			/**
+			 * Destroys the Mutex.
+			 */
+			~Mutex();
+
+			/**
+			 * Acquires the lock, blocking until it is available.
+			 */
+			void lock();
+
+			/**
+			 * Releases the lock.
+			 */
+			void unlock();
+
+		private:
+
+			friend class ConditionVariable;
+
+			// Copying is not allowed
+			Mutex(const Mutex&);
+			Mutex& operator= (const Mutex&);
+
+			/// Platform specific handle
+			void* _handle;
+	} ; // end class Mutex
+
+	/**
+	 * Holds a Mutex for the lifetime of the object.
+	 */
+	class ScopedLock
+	{
+		public:
+
+			/**
+			 * Acquires the given Mutex.
+			 *
+			 * \param mutex The Mutex to hold.
+			 */
+			explicit ScopedLock(Mutex& mutex)
+				: _mutex(mutex)
+			{
+				_mutex.lock();
+			}
+
+			/**
+			 * Releases the Mutex.
+			 */
+			~ScopedLock()
+			{
+				_mutex.unlock();
+			}
+
+		private:
+
+			// Copying is not allowed
+			ScopedLock(const ScopedLock&);
+			ScopedLock& operator= (const ScopedLock&);
+
+			/// The Mutex being held
+			Mutex& _mutex;
+	} ; // end class ScopedLock
+
+	/**
+	 * Allows threads to wait until they are signaled.
+	 */
+	class ConditionVariable
+	{
+		public:
+
+			/**
+			 * Creates an instance of the ConditionVariable class.
+			 */
+			ConditionVariable();
+
+			/**
+			 * Destroys the ConditionVariable.
+			 */
+			~ConditionVariable();
+
+			/**
+			 * Waits until the condition is signaled.
+			 *
+			 * The mutex must be held by the caller. It is released while
+			 * waiting and reacquired before returning.
+			 *
+			 * \param mutex The Mutex protecting the condition.
+			 */
+			void wait(Mutex& mutex);
+
+			/**
+			 * Waits until the condition is signaled or the time elapses.
+			 *
+			 * \param mutex The Mutex protecting the condition.
+			 * \param milliseconds The maximum amount of time to wait.
+			 * \returns true if the condition was signaled; false if the time elapsed.
+			 */
+			bool wait(Mutex& mutex, std::uint32_t milliseconds);
+
+			/**
+			 * Wakes a single waiting thread.
+			 */
+			void signal();
+
+			/**
+			 * Wakes all waiting threads.
+			 */
+			void broadcast();
+
+		private:
+
+			// Copying is not allowed
+			ConditionVariable(const ConditionVariable&);
+			ConditionVariable& operator= (const ConditionVariable&);
+
+			/// Platform specific handle
+			void* _handle;
+	} ; // end class ConditionVariable
+
+	/**
+	 * A thread of execution.
+	 */
+	class Thread
+	{
+		public:
+
+			/// Entry point for a thread
+			typedef void (*Function)(void* argument);
+
+			/**
+			 * Creates an instance of the Thread class.
+			 *
+			 * The thread does not run until start is called.
+			 */
+			Thread();
+
+			/**
+			 * Destroys the Thread.
+			 *
+			 * A running thread is joined before the object is destroyed.
+			 */
+			~Thread();
+
+		//---------------------------------------------------------------------
+		// Properties
+		//---------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Whether the thread has been started and not yet joined.
+			 *
+			 * \returns true if the thread has been started; false otherwise.
+			 */
+			inline bool isStarted() const
+			{
+				return _handle != 0;
+			}
+
+		//---------------------------------------------------------------------
+		// Class methods
+		//---------------------------------------------------------------------
+
+		public:
+
+			/**
+			 * Starts the thread.
+			 *
+			 * \param function The function to run.
+			 * \param argument The argument to pass to the function.
+			 * \param options The options to apply to the thread.
+			 * \returns true if the thread was started; false otherwise.
+			 */
+			bool start(Function function, void* argument, const ThreadOptions& options = ThreadOptions());
+
+			/**
+			 * Waits for the thread to finish.
+			 */
+			void join();
+
+			/**
+			 * Applies options to the calling thread.
+			 *
+			 * The stack size is ignored as the thread is already running.
+			 * Options the platform doesn't support, or the process lacks the
+			 * privileges for, are reported and skipped.
+			 *
+			 * \param options The options to apply.
+			 * \returns true if every option was applied; false otherwise.
+			 */
+			static bool configureCurrent(const ThreadOptions& options);
+
+			/**
+			 * Suspends the calling thread.
+			 *
+			 * \param milliseconds The amount of time to sleep.
+			 */
+			static void sleep(std::uint32_t milliseconds);
+
+			/**
+			 * Queries the number of processors available.
+			 *
+			 * \returns The number of processors available.
+			 */
+			static std::size_t getNumberOfProcessors();
+
+		private:
+
+			friend struct ThreadEntry;
+
+			// Copying is not allowed
+			Thread(const Thread&);
+			Thread& operator= (const Thread&);
+
+			/// Platform specific handle
+			void* _handle;
+			/// The function to run
+			Function _function;
+			/// The argument to pass to the function
+			void* _argument;
+			/// The options applied when the thread starts
+			ThreadOptions _options;
+	} ; // end class Thread
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_THREAD_HPP_INCLUDED
@@ -0,0 +1,198 @@
+/**
+ * \file ThreadConfiguration.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "ThreadConfiguration.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "Json.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/**
+	 * The configuration of a role.
+	 */
+	struct RoleConfiguration
+	{
+		/// The options shared by the threads
+		ThreadOptions options;
+		/// The processors the threads may run on
+		std::vector<std::size_t> processors;
+	} ; // end struct RoleConfiguration
+
+	/// The name of each role within the configuration
+	const char* __roleMembers[ThreadRole::Size] =
+	{
+		"input",
+		"shards",
+		"jobs",
+		"isolatePool",
+		"watchdog",
+		"frameClock",
+		"timers",
+		"transport"
+	};
+
+	/// The default name of the threads for each role
+	const char* __roleNames[ThreadRole::Size] =
+	{
+		"input",
+		"shard",
+		"jobs",
+		"isolate pool",
+		"watchdog",
+		"frame clock",
+		"timers",
+		"transport"
+	};
+
+	/// Whether a role has several threads
+	const bool __roleIsShared[ThreadRole::Size] =
+	{
+		false,
+		true,
+		true,
+		false,
+		false,
+		false,
+		false,
+		false
+	};
+
+	/// The configuration for each role
+	RoleConfiguration __roles[ThreadRole::Size];
+
+	/**
+	 * Reads the configuration of a role.
+	 *
+	 * \param value The configuration of the role.
+	 * \param role The configuration to populate.
+	 */
+	void __readRole(const JsonValue* value, RoleConfiguration* role)
+	{
+		const JsonValue* name = value->getMember("name");
+
+		if (name && (name->getType() == JsonType::String))
+			role->options.setName(name->getString());
+
+		const JsonValue* affinity = value->getMember("affinity");
+
+		if (affinity && (affinity->getType() == JsonType::Array))
+		{
+			std::size_t count = affinity->getSize();
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const JsonValue* processor = affinity->getElement(i);
+
+				if ((processor->getType() == JsonType::Number) && (processor->getNumber() >= 0) && (processor->getNumber() < 64))
+					role->processors.push_back(static_cast<std::size_t>(processor->getNumber()));
+			}
+		}
+
+		const JsonValue* policy = value->getMember("policy");
+
+		if (policy && (policy->getType() == JsonType::String))
+		{
+			const char* type = policy->getString();
+
+			if (strcmp(type, "fifo") == 0)
+				role->options.policy = SchedulingPolicy::Fifo;
+			else if (strcmp(type, "rr") == 0)
+				role->options.policy = SchedulingPolicy::RoundRobin;
+			else if (strcmp(type, "normal") == 0)
+				role->options.policy = SchedulingPolicy::Normal;
+			else
+				printf("Unknown scheduling policy %s\n", type);
+		}
+
+		const JsonValue* priority = value->getMember("priority");
+
+		if (priority && (priority->getType() == JsonType::Number))
+			role->options.priority = static_cast<std::int32_t>(priority->getNumber());
+
+		const JsonValue* stackSize = value->getMember("stackSize");
+
+		if (stackSize && (stackSize->getType() == JsonType::Number) && (stackSize->getNumber() > 0))
+			role->options.stackSize = static_cast<std::size_t>(stackSize->getNumber());
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+void ThreadConfiguration::configure(const JsonValue* configuration)
+{
+	const JsonValue* threads = configuration->getMember("threads");
+
+	if (threads && (threads->getType() == JsonType::Object))
+	{
+		for (std::size_t i = 0; i < ThreadRole::Size; ++i)
+		{
+			const JsonValue* role = threads->getMember(__roleMembers[i]);
+
+			if (role && (role->getType() == JsonType::Object))
+				__readRole(role, &__roles[i]);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+ThreadOptions ThreadConfiguration::getOptions(ThreadRole::Enum role, std::size_t index)
+{
+	const RoleConfiguration& configuration = __roles[role];
+	ThreadOptions options = configuration.options;
+
+	const char* name = (configuration.options.name[0] != '\0') ? configuration.options.name : __roleNames[role];
+	std::size_t processorCount = configuration.processors.size();
+
+	if (__roleIsShared[role])
+	{
+		// The name is bounded so the number always fits
+		char numbered[ThreadOptions::MaxNameLength + 16];
+		sprintf(numbered, "%.*s %u", static_cast<int>(ThreadOptions::MaxNameLength - 1), name, static_cast<unsigned int>(index));
+
+		options.setName(numbered);
+
+		if (processorCount > 0)
+			options.affinity = static_cast<std::uint64_t>(1) << configuration.processors[index % processorCount];
+	}
+	else
+	{
+		options.setName(name);
+
+		for (std::size_t i = 0; i < processorCount; ++i)
+			options.affinity |= static_cast<std::uint64_t>(1) << configuration.processors[i];
+	}
+
+	return options;
+}
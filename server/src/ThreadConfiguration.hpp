@@ -0,0 +1,113 @@
+/**
+ * \file ThreadConfiguration.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_THREAD_CONFIGURATION_HPP_INCLUDED
+#define DART_EMBED_THREAD_CONFIGURATION_HPP_INCLUDED
+
+#include "Thread.hpp"
+
+namespace DartEmbed
+{
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class JsonValue;
+
+	/**
+	 * The jobs threads perform within the application.
+	 */
+	namespace ThreadRole
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// Polls the game pads
+			Input,
+			/// Runs a serving isolate
+			Shard,
+			/// Runs jobs from embed:jobs
+			Jobs,
+			/// Refills the isolate pool
+			IsolatePool,
+			/// Watches the isolates handling messages
+			Watchdog,
+			/// Ticks the frame clock from embed:input
+			FrameClock,
+			/// Expires the timers from dart:io
+			Timers,
+			/// Serves the UDP transport
+			Transport,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace ThreadRole
+
+	/**
+	 * Options for the application's threads read from config.json.
+	 *
+	 * The "threads" member of the configuration holds an object per role,
+	 * named input, shards, jobs, isolatePool, watchdog, frameClock, timers
+	 * and transport. Each may contain:
+	 *
+	 *   name      - The name of the thread
+	 *   affinity  - An array of processor indices
+	 *   policy    - normal, fifo or rr
+	 *   priority  - The nice level, or the real-time priority for fifo and rr
+	 *   stackSize - The size of the stack in bytes
+	 *
+	 * Roles with several threads number their names, and the thread at an
+	 * index is pinned to the processor at that index of the affinity array
+	 * rather than to all of them.
+	 */
+	namespace ThreadConfiguration
+	{
+		/**
+		 * Reads the threads member of the configuration.
+		 *
+		 * A missing threads member leaves the defaults in place.
+		 *
+		 * \param configuration The root of the configuration.
+		 */
+		void configure(const JsonValue* configuration);
+
+		/**
+		 * Gets the options for a thread.
+		 *
+		 * \param role The role of the thread.
+		 * \param index The index of the thread within the role.
+		 * \returns The options to start the thread with.
+		 */
+		ThreadOptions getOptions(ThreadRole::Enum role, std::size_t index = 0);
+	} // end namespace ThreadConfiguration
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_THREAD_CONFIGURATION_HPP_INCLUDED
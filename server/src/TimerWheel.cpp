@@ -0,0 +1,229 @@
+/**
+ * \file TimerWheel.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "TimerWheel.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// Mask for the index of a slot
+	const std::uint64_t __slotMask = TimerWheel::Slots - 1;
+	/// The furthest a timer can be scheduled in ticks
+	const std::uint64_t __maximumDelay = (static_cast<std::uint64_t>(1) << (TimerWheel::Levels * TimerWheel::SlotBits)) - 1;
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+TimerWheel::TimerWheel(std::uint64_t tick)
+	: _current(tick)
+{
+	for (std::size_t level = 0; level < Levels; ++level)
+	{
+		for (std::size_t slot = 0; slot < Slots; ++slot)
+		{
+			Timer& sentinel = _slots[level][slot];
+			sentinel.previous = &sentinel;
+			sentinel.next = &sentinel;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+TimerWheel::~TimerWheel()
+{
+	for (TimerMap::iterator itr = _timers.begin(); itr != _timers.end(); ++itr)
+		delete itr->second;
+}
+
+//----------------------------------------------------------------------
+
+void TimerWheel::schedule(std::uint64_t key, std::uint64_t expires)
+{
+	Timer* timer;
+	TimerMap::iterator found = _timers.find(key);
+
+	if (found != _timers.end())
+	{
+		timer = found->second;
+		unlink(timer);
+	}
+	else
+	{
+		timer = new Timer();
+		timer->key = key;
+
+		_timers[key] = timer;
+	}
+
+	timer->expires = expires;
+
+	link(timer);
+}
+
+//----------------------------------------------------------------------
+
+bool TimerWheel::cancel(std::uint64_t key)
+{
+	TimerMap::iterator found = _timers.find(key);
+
+	if (found == _timers.end())
+		return false;
+
+	unlink(found->second);
+	delete found->second;
+
+	_timers.erase(found);
+
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+void TimerWheel::advance(std::uint64_t tick, std::vector<std::uint64_t>* expired)
+{
+	while (_current <= tick)
+	{
+		// Nothing can expire so skip ahead
+		if (_timers.empty())
+		{
+			_current = tick + 1;
+			return;
+		}
+
+		if ((_current & __slotMask) == 0)
+			cascade();
+
+		Timer& sentinel = _slots[0][_current & __slotMask];
+
+		while (sentinel.next != &sentinel)
+		{
+			Timer* timer = sentinel.next;
+			unlink(timer);
+
+			expired->push_back(timer->key);
+			_timers.erase(timer->key);
+
+			delete timer;
+		}
+
+		_current++;
+	}
+}
+
+//----------------------------------------------------------------------
+
+bool TimerWheel::getNextTick(std::uint64_t* tick) const
+{
+	if (_timers.empty())
+		return false;
+
+	// Search the lowest level up to where it wraps
+	std::uint64_t wrap = (_current | __slotMask) + 1;
+
+	for (std::uint64_t i = _current; i < wrap; ++i)
+	{
+		const Timer& sentinel = _slots[0][i & __slotMask];
+
+		if (sentinel.next != &sentinel)
+		{
+			*tick = i;
+			return true;
+		}
+	}
+
+	// Timers in the higher levels move down when the lowest level wraps
+	*tick = wrap;
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+void TimerWheel::link(Timer* timer)
+{
+	std::uint64_t expires = timer->expires;
+
+	if (expires < _current)
+		expires = _current;
+	else if (expires - _current > __maximumDelay)
+		expires = _current + __maximumDelay;
+
+	timer->expires = expires;
+
+	// Find the lowest level that can hold the delay
+	std::uint64_t delay = expires - _current;
+	std::size_t level = 0;
+
+	while ((level < Levels - 1) && (delay >> ((level + 1) * SlotBits)) != 0)
+		level++;
+
+	Timer& sentinel = _slots[level][(expires >> (level * SlotBits)) & __slotMask];
+
+	timer->previous = sentinel.previous;
+	timer->next = &sentinel;
+	sentinel.previous->next = timer;
+	sentinel.previous = timer;
+}
+
+//----------------------------------------------------------------------
+
+void TimerWheel::unlink(Timer* timer)
+{
+	timer->previous->next = timer->next;
+	timer->next->previous = timer->previous;
+}
+
+//----------------------------------------------------------------------
+
+void TimerWheel::cascade()
+{
+	for (std::size_t level = 1; level < Levels; ++level)
+	{
+		std::uint64_t index = (_current >> (level * SlotBits)) & __slotMask;
+		Timer& sentinel = _slots[level][index];
+
+		// Relink against the current tick, which places them lower
+		Timer* timer = sentinel.next;
+		sentinel.previous = &sentinel;
+		sentinel.next = &sentinel;
+
+		while (timer != &sentinel)
+		{
+			Timer* next = timer->next;
+			link(timer);
+			timer = next;
+		}
+
+		// Only continue up when this level wrapped as well
+		if (index != 0)
+			break;
+	}
+}
@@ -0,0 +1,176 @@
+/**
+ * \file TimerWheel.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_TIMER_WHEEL_HPP_INCLUDED
+#define DART_EMBED_TIMER_WHEEL_HPP_INCLUDED
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace DartEmbed
+{
+	/**
+	 * Hierarchical timer wheel.
+	 *
+	 * Time is measured in ticks, whose length the owner chooses. Timers are
+	 * kept in four levels of 256 slots, each level covering 256 times the
+	 * span of the one below. Scheduling and cancelling take constant time.
+	 * Timers move down a level as their expiry comes within range of it.
+	 *
+	 * All timers expiring in the same tick are returned together, so the
+	 * owner wakes once for them. Not thread safe.
+	 */
+	class TimerWheel
+	{
+		public:
+
+			/// The number of levels in the wheel
+			static const std::size_t Levels = 4;
+			/// The number of bits used to index the slots of a level
+			static const std::size_t SlotBits = 8;
+			/// The number of slots in a level
+			static const std::size_t Slots = 1 << SlotBits;
+
+			/**
+			 * Creates an instance of the TimerWheel class.
+			 *
+			 * \param tick The current tick.
+			 */
+			explicit TimerWheel(std::uint64_t tick);
+
+			/**
+			 * Destroys the TimerWheel.
+			 */
+			~TimerWheel();
+
+			/**
+			 * Schedules a timer, replacing any timer with the same key.
+			 *
+			 * Timers due at or before the current tick expire on the next
+			 * call to advance.
+			 *
+			 * \param key Identifies the timer.
+			 * \param expires The tick the timer expires on.
+			 */
+			void schedule(std::uint64_t key, std::uint64_t expires);
+
+			/**
+			 * Cancels a timer.
+			 *
+			 * \param key Identifies the timer.
+			 * \returns true if the timer was scheduled; false otherwise.
+			 */
+			bool cancel(std::uint64_t key);
+
+			/**
+			 * Advances the wheel, collecting the timers that expired.
+			 *
+			 * \param tick The current tick.
+			 * \param expired Receives the keys of the expired timers.
+			 */
+			void advance(std::uint64_t tick, std::vector<std::uint64_t>* expired);
+
+			/**
+			 * Gets the tick the wheel next needs to be advanced on.
+			 *
+			 * This is either the expiry of the earliest timer in the lowest
+			 * level or the tick where timers move down from a higher level.
+			 *
+			 * \param tick Receives the tick.
+			 * \returns false if no timers are scheduled; true otherwise.
+			 */
+			bool getNextTick(std::uint64_t* tick) const;
+
+			/**
+			 * Gets the number of timers scheduled.
+			 *
+			 * \returns The number of timers scheduled.
+			 */
+			inline std::size_t getSize() const
+			{
+				return _timers.size();
+			}
+
+		private:
+
+			/**
+			 * A scheduled timer.
+			 *
+			 * Timers are linked into the slot they expire from.
+			 */
+			struct Timer
+			{
+				/// Identifies the timer
+				std::uint64_t key;
+				/// The tick the timer expires on
+				std::uint64_t expires;
+				/// The previous timer in the slot
+				Timer* previous;
+				/// The next timer in the slot
+				Timer* next;
+			} ; // end struct Timer
+
+			/**
+			 * Links a timer into the slot for its expiry.
+			 *
+			 * \param timer The timer to link.
+			 */
+			void link(Timer* timer);
+
+			/**
+			 * Removes a timer from its slot.
+			 *
+			 * \param timer The timer to unlink.
+			 */
+			static void unlink(Timer* timer);
+
+			/**
+			 * Moves the timers of the slots that came into range down a level.
+			 */
+			void cascade();
+
+			TimerWheel(const TimerWheel&);
+			TimerWheel& operator= (const TimerWheel&);
+
+			/// Timers by key
+			typedef std::unordered_map<std::uint64_t, Timer*> TimerMap;
+
+			/// The current tick
+			std::uint64_t _current;
+			/// Sentinels of the circular list of timers in each slot
+			Timer _slots[Levels][Slots];
+			/// Timers by key
+			TimerMap _timers;
+	} ; // end class TimerWheel
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_TIMER_WHEEL_HPP_INCLUDED
@@ -0,0 +1,635 @@
+/**
+ * \file UdpTransport.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "UdpTransport.hpp"
+#include <cstdio>
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <DartEmbed/GamePad.hpp>
+#include "Clock.hpp"
+#include "EmbedLibraries.hpp"
+#include "GamePadSerialization.hpp"
+#include "PlatformLinux.hpp"
+#include "Thread.hpp"
+#include "ThreadConfiguration.hpp"
+#include "VibrationQueue.hpp"
+#endif
+
+using namespace DartEmbed;
+
+#ifdef __linux__
+
+namespace
+{
+	/**
+	 * A client registered for game pads.
+	 */
+	struct UdpClient
+	{
+		/// The address of the client
+		sockaddr_storage address;
+		/// The length of the address
+		socklen_t addressLength;
+		/// Bitmask of the game pads the client receives
+		std::uint8_t pads;
+		/// When the client was last heard from in milliseconds
+		std::uint64_t lastHeard;
+		/// When the client was last sent a frame in milliseconds; 0 if never
+		std::uint64_t lastSent;
+		/// Whether the client has set the vibration
+		bool vibrated;
+		/// The sequence number of the newest vibration answered
+		std::uint16_t vibrationSequence;
+		/// The status the newest vibration was answered with
+		VibrationStatus::Enum vibrationStatus;
+	} ; // end struct UdpClient
+
+	/// Time a client is remembered without hearing from it in milliseconds
+	const std::uint64_t __clientTimeout = 5000;
+	/// The most clients served at once
+	const std::size_t __maximumClients = 64;
+	/// The length of a Register
+	const std::size_t __registerLength = 6;
+	/// The length of a RegisterAck
+	const std::size_t __registerAckLength = 7;
+	/// The length of a VibrationAck
+	const std::size_t __vibrationAckLength = 4;
+	/// Time between frames sent to a client with idle game pads in milliseconds
+	const std::uint64_t __keyframeInterval = 1000;
+	/// The length of the header of a frame
+	const std::size_t __frameHeaderLength = 6;
+	/// The longest datagram sent or received
+	const std::size_t __maximumDatagramLength = __frameHeaderLength + PlayerIndex::Size * GamePadSerialization::BinaryLength;
+	/// Every game pad
+	const std::uint8_t __allPads = (1 << PlayerIndex::Size) - 1;
+
+	/// Guards shutting down
+	Mutex __mutex;
+	/// Whether the transport thread should exit
+	bool __shutdown = false;
+	/// Thread serving the transport
+	Thread __transportThread;
+	/// The socket of the transport
+	int __socket = -1;
+	/// Pipe written to wake the transport thread
+	int __wakeup[2] = { -1, -1 };
+	/// The rate the game pads are sent at
+	std::uint32_t __framesPerSecond = 60;
+	/// The registered clients; only touched by the transport thread
+	std::vector<UdpClient> __clients;
+	/// The sequence number of the last frame sent
+	std::uint32_t __sequence = 0;
+	/// Secret mixed into the cookies; chosen when the transport starts
+	std::uint64_t __secret = 0;
+
+	/**
+	 * Gets the current time in milliseconds.
+	 *
+	 * \returns The current time in milliseconds.
+	 */
+	inline std::uint64_t __getMilliseconds()
+	{
+		return Clock::getMicroseconds() / 1000;
+	}
+
+	/**
+	 * Checks whether two addresses are the same.
+	 *
+	 * \param first The first address.
+	 * \param second The second address.
+	 * \returns true if the addresses are the same; false otherwise.
+	 */
+	bool __isSameAddress(const sockaddr_storage& first, const sockaddr_storage& second)
+	{
+		if (first.ss_family != second.ss_family)
+			return false;
+
+		if (first.ss_family == AF_INET)
+		{
+			const sockaddr_in* a = reinterpret_cast<const sockaddr_in*>(&first);
+			const sockaddr_in* b = reinterpret_cast<const sockaddr_in*>(&second);
+
+			return (a->sin_port == b->sin_port) && (a->sin_addr.s_addr == b->sin_addr.s_addr);
+		}
+		else if (first.ss_family == AF_INET6)
+		{
+			const sockaddr_in6* a = reinterpret_cast<const sockaddr_in6*>(&first);
+			const sockaddr_in6* b = reinterpret_cast<const sockaddr_in6*>(&second);
+
+			return (a->sin6_port == b->sin6_port) && (memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(in6_addr)) == 0);
+		}
+
+		return false;
+	}
+
+	/**
+	 * Chooses the secret the cookies are made from.
+	 *
+	 * Falls back to the clock if /dev/urandom can't be read.
+	 */
+	void __chooseSecret()
+	{
+		int random = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+		if ((random == -1) || (read(random, &__secret, sizeof(__secret)) != sizeof(__secret)))
+			__secret = Clock::getMicroseconds() ^ (static_cast<std::uint64_t>(getpid()) << 32);
+
+		if (random != -1)
+			close(random);
+	}
+
+	/**
+	 * Mixes bytes into an FNV-1a hash.
+	 *
+	 * \param hash The hash so far.
+	 * \param data The bytes to mix in.
+	 * \param length The number of bytes.
+	 * \returns The new hash.
+	 */
+	std::uint32_t __mix(std::uint32_t hash, const void* data, std::size_t length)
+	{
+		const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	/**
+	 * Computes the cookie a client at the address registers with.
+	 *
+	 * Only the holder of the secret can compute it, so a client that
+	 * echoes it must have received the RegisterAck at that address.
+	 *
+	 * \param address The address of the client.
+	 * \returns The cookie; never 0.
+	 */
+	std::uint32_t __getCookie(const sockaddr_storage& address)
+	{
+		std::uint32_t hash = __mix(2166136261u, &__secret, sizeof(__secret));
+
+		if (address.ss_family == AF_INET)
+		{
+			const sockaddr_in* ip = reinterpret_cast<const sockaddr_in*>(&address);
+
+			hash = __mix(hash, &ip->sin_addr, sizeof(ip->sin_addr));
+			hash = __mix(hash, &ip->sin_port, sizeof(ip->sin_port));
+		}
+		else if (address.ss_family == AF_INET6)
+		{
+			const sockaddr_in6* ip = reinterpret_cast<const sockaddr_in6*>(&address);
+
+			hash = __mix(hash, &ip->sin6_addr, sizeof(ip->sin6_addr));
+			hash = __mix(hash, &ip->sin6_port, sizeof(ip->sin6_port));
+		}
+
+		return (hash != 0) ? hash : 1;
+	}
+
+	/**
+	 * Finds a registered client.
+	 *
+	 * \param address The address of the client.
+	 * \returns The index of the client; -1 if it isn't registered.
+	 */
+	std::ptrdiff_t __findClient(const sockaddr_storage& address)
+	{
+		for (std::size_t i = 0; i < __clients.size(); ++i)
+		{
+			if (__isSameAddress(__clients[i].address, address))
+				return static_cast<std::ptrdiff_t>(i);
+		}
+
+		return -1;
+	}
+
+	/**
+	 * Sends a datagram.
+	 *
+	 * Failures are treated like any other lost datagram.
+	 *
+	 * \param data The datagram.
+	 * \param length The length of the datagram.
+	 * \param address The address to send to.
+	 * \param addressLength The length of the address.
+	 */
+	inline void __send(const std::uint8_t* data, std::size_t length, const sockaddr_storage& address, socklen_t addressLength)
+	{
+		sendto(__socket, data, length, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&address), addressLength);
+	}
+
+	/**
+	 * Handles a datagram sent by a client.
+	 *
+	 * \param data The datagram.
+	 * \param length The length of the datagram.
+	 * \param address The address of the client.
+	 * \param addressLength The length of the address.
+	 * \param now The current time in milliseconds.
+	 */
+	void __receive(std::uint8_t* data, std::size_t length, const sockaddr_storage& address, socklen_t addressLength, std::uint64_t now)
+	{
+		if (length == 0)
+			return;
+
+		std::ptrdiff_t index = __findClient(address);
+		UdpClient* client = (index != -1) ? &__clients[index] : 0;
+
+		switch (data[0])
+		{
+			case UdpMessage::Register:
+			{
+				// Short requests are ignored so the reply is hardly larger than the request
+				if (length < __registerLength)
+					return;
+
+				std::uint8_t pads = data[1] & __allPads;
+				std::uint32_t cookie = __getCookie(address);
+				std::uint32_t echoed = data[2] | (data[3] << 8) | (data[4] << 16) | (static_cast<std::uint32_t>(data[5]) << 24);
+
+				// Only addresses that proved they receive the acknowledgements are sent frames
+				if ((!client) && (echoed == cookie) && (__clients.size() < __maximumClients))
+				{
+					UdpClient added;
+					memset(&added, 0, sizeof(UdpClient));
+					memcpy(&added.address, &address, addressLength);
+					added.addressLength = addressLength;
+
+					__clients.push_back(added);
+					client = &__clients.back();
+				}
+
+				if (client)
+				{
+					// A new subscription is sent its state on the next frame
+					if (client->pads != pads)
+						client->lastSent = 0;
+
+					client->pads = pads;
+					client->lastHeard = now;
+				}
+
+				std::uint8_t reply[__registerAckLength] =
+				{
+					UdpMessage::RegisterAck,
+					pads,
+					static_cast<std::uint8_t>(cookie),
+					static_cast<std::uint8_t>(cookie >> 8),
+					static_cast<std::uint8_t>(cookie >> 16),
+					static_cast<std::uint8_t>(cookie >> 24),
+					static_cast<std::uint8_t>((client) ? 1 : 0)
+				};
+
+				__send(reply, sizeof(reply), address, addressLength);
+			}
+			break;
+
+			case UdpMessage::Vibration:
+			{
+				if ((length < 6) || (!client))
+					return;
+
+				std::uint16_t sequence = static_cast<std::uint16_t>(data[1] | (data[2] << 8));
+				std::uint8_t player = data[3];
+
+				// Requests that arrive after a newer one are stale
+				bool newer = (!client->vibrated) || (static_cast<std::int16_t>(sequence - client->vibrationSequence) > 0);
+
+				VibrationStatus::Enum status;
+
+				if (player >= PlayerIndex::Size)
+				{
+					status = VibrationStatus::Invalid;
+				}
+				else if (!newer)
+				{
+					// A resend of the newest request means its acknowledgement was lost
+					status = (sequence == client->vibrationSequence) ? client->vibrationStatus : VibrationStatus::Stale;
+				}
+				else
+				{
+					// Remember the request even if it can't be applied so older ones stay stale
+					client->vibrated = true;
+					client->vibrationSequence = sequence;
+
+					if (canVibrateGamePad(player) && VibrationQueue::set(static_cast<PlayerIndex::Enum>(player), data[4] / 255.0f, data[5] / 255.0f))
+						status = VibrationStatus::Applied;
+					else
+						status = VibrationStatus::Unavailable;
+
+					client->vibrationStatus = status;
+				}
+
+				client->lastHeard = now;
+
+				std::uint8_t reply[__vibrationAckLength] = { UdpMessage::VibrationAck, data[1], data[2], static_cast<std::uint8_t>(status) };
+				__send(reply, sizeof(reply), address, addressLength);
+			}
+			break;
+
+			case UdpMessage::Ping:
+			{
+				if (client)
+					client->lastHeard = now;
+
+				data[0] = UdpMessage::Pong;
+				__send(data, length, address, addressLength);
+			}
+			break;
+
+			case UdpMessage::Unregister:
+			{
+				if (client)
+				{
+					__clients[index] = __clients.back();
+					__clients.pop_back();
+				}
+			}
+			break;
+		}
+	}
+
+	/**
+	 * Sends the registered clients the game pads that changed.
+	 *
+	 * \param frames The binary frame of each game pad.
+	 * \param changed Bitmask of the game pads that changed this frame.
+	 * \param now The current time in milliseconds.
+	 */
+	void __sendFrames(const std::uint8_t frames[][GamePadSerialization::BinaryLength], std::uint8_t changed, std::uint64_t now)
+	{
+		std::uint8_t datagram[__maximumDatagramLength];
+		std::uint32_t sequence = ++__sequence;
+
+		datagram[0] = UdpMessage::Frame;
+		datagram[2] = static_cast<std::uint8_t>(sequence);
+		datagram[3] = static_cast<std::uint8_t>(sequence >> 8);
+		datagram[4] = static_cast<std::uint8_t>(sequence >> 16);
+		datagram[5] = static_cast<std::uint8_t>(sequence >> 24);
+
+		std::size_t i = 0;
+
+		while (i < __clients.size())
+		{
+			UdpClient& client = __clients[i];
+
+			// Forget clients that went away without unregistering
+			if (now - client.lastHeard > __clientTimeout)
+			{
+				client = __clients.back();
+				__clients.pop_back();
+				continue;
+			}
+
+			++i;
+
+			bool due = (client.lastSent == 0) || (now - client.lastSent >= __keyframeInterval) || ((client.pads & changed) != 0);
+
+			if ((!due) || (client.pads == 0))
+				continue;
+
+			std::size_t length = __frameHeaderLength;
+			std::uint8_t count = 0;
+
+			for (std::size_t player = 0; player < PlayerIndex::Size; ++player)
+			{
+				if ((client.pads & (1 << player)) == 0)
+					continue;
+
+				memcpy(datagram + length, frames[player], GamePadSerialization::BinaryLength);
+				length += GamePadSerialization::BinaryLength;
+				++count;
+			}
+
+			datagram[1] = count;
+
+			__send(datagram, length, client.address, client.addressLength);
+			client.lastSent = now;
+		}
+	}
+
+	/**
+	 * Serves the transport.
+	 *
+	 * Frames are sent on deadlines computed from when the transport
+	 * started, like the frame clock, and datagrams from clients are
+	 * handled while waiting for the next one.
+	 *
+	 * \param argument Unused.
+	 */
+	void __runTransport(void* argument)
+	{
+		const std::uint64_t period = 1000000 / __framesPerSecond;
+		const std::uint64_t start = Clock::getMicroseconds();
+		std::uint64_t frame = 0;
+
+		std::uint8_t frames[PlayerIndex::Size][GamePadSerialization::BinaryLength];
+		memset(frames, 0, sizeof(frames));
+		bool first = true;
+
+		while (true)
+		{
+			__mutex.lock();
+			bool shutdown = __shutdown;
+			__mutex.unlock();
+
+			if (shutdown)
+				break;
+
+			std::uint64_t now = Clock::getMicroseconds();
+			std::uint64_t deadline = start + (frame + 1) * period;
+
+			if (now >= deadline)
+			{
+				frame = (now - start) / period;
+
+				std::uint8_t changed = first ? __allPads : 0;
+				first = false;
+
+				for (std::size_t player = 0; player < PlayerIndex::Size; ++player)
+				{
+					std::uint8_t current[GamePadSerialization::BinaryLength];
+					std::uint8_t delta[GamePadSerialization::MaximumDeltaLength];
+
+					GamePadSerialization::writeBinary(GamePad::getState(static_cast<PlayerIndex::Enum>(player)), static_cast<std::int32_t>(player), current);
+
+					if (GamePadSerialization::writeDelta(frames[player], current, delta) > 0)
+						changed |= 1 << player;
+
+					memcpy(frames[player], current, sizeof(current));
+				}
+
+				__sendFrames(frames, changed, now / 1000);
+				continue;
+			}
+
+			pollfd descriptors[2];
+			descriptors[0].fd = __socket;
+			descriptors[0].events = POLLIN;
+			descriptors[1].fd = __wakeup[0];
+			descriptors[1].events = POLLIN;
+
+			int timeout = static_cast<int>((deadline - now + 999) / 1000);
+
+			if (poll(descriptors, 2, timeout) <= 0)
+				continue;
+
+			if ((descriptors[0].revents & POLLIN) == 0)
+				continue;
+
+			// Handle everything that arrived before sending the next frame
+			while (true)
+			{
+				std::uint8_t data[__maximumDatagramLength];
+				sockaddr_storage address;
+				socklen_t addressLength = sizeof(address);
+
+				ssize_t length = recvfrom(__socket, data, sizeof(data), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&address), &addressLength);
+
+				if (length < 0)
+					break;
+
+				__receive(data, static_cast<std::size_t>(length), address, addressLength, __getMilliseconds());
+			}
+		}
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+bool UdpTransport::start(const char* host, std::uint16_t port, std::uint32_t framesPerSecond)
+{
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+	{
+		printf("Unable to serve UDP on %s\n", host);
+		return false;
+	}
+
+	__socket = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (__socket == -1)
+	{
+		printf("Unable to create the UDP socket: %s\n", strerror(errno));
+		return false;
+	}
+
+	if ((bind(__socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (pipe(__wakeup) != 0))
+	{
+		printf("Unable to serve UDP on %s:%u: %s\n", host, static_cast<unsigned int>(port), strerror(errno));
+		terminate();
+		return false;
+	}
+
+	__framesPerSecond = (framesPerSecond > 0) ? std::min(framesPerSecond, EmbedLibraries::MaxFramesPerSecond) : 60;
+	__shutdown = false;
+
+	__chooseSecret();
+
+	if (!__transportThread.start(__runTransport, 0, ThreadConfiguration::getOptions(ThreadRole::Transport)))
+	{
+		terminate();
+		return false;
+	}
+
+	printf("Serving UDP on %s:%u\n", host, static_cast<unsigned int>(port));
+
+	return true;
+}
+
+//---------------------------------------------------------------------
+
+void UdpTransport::terminate()
+{
+	if (__transportThread.isStarted())
+	{
+		__mutex.lock();
+		__shutdown = true;
+		__mutex.unlock();
+
+		char wakeup = 0;
+		ssize_t written = write(__wakeup[1], &wakeup, 1);
+		(void)written;
+
+		__transportThread.join();
+	}
+
+	for (std::size_t i = 0; i < 2; ++i)
+	{
+		if (__wakeup[i] != -1)
+			close(__wakeup[i]);
+
+		__wakeup[i] = -1;
+	}
+
+	if (__socket != -1)
+		close(__socket);
+
+	__socket = -1;
+	__clients.clear();
+}
+
+#else
+
+//---------------------------------------------------------------------
+
+bool UdpTransport::start(const char* host, std::uint16_t port, std::uint32_t framesPerSecond)
+{
+	printf("The UDP transport is only supported on Linux\n");
+
+	return false;
+}
+
+//---------------------------------------------------------------------
+
+void UdpTransport::terminate()
+{ }
+
+#endif
@@ -0,0 +1,187 @@
+/**
+ * \file UdpTransport.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_UDP_TRANSPORT_HPP_INCLUDED
+#define DART_EMBED_UDP_TRANSPORT_HPP_INCLUDED
+
+#include <cstdint>
+
+namespace DartEmbed
+{
+	/**
+	 * The types of the datagrams exchanged over the UDP transport.
+	 *
+	 * Every datagram starts with its type. Multi-byte values are little
+	 * endian.
+	 */
+	namespace UdpMessage
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/**
+			 * Receive game pads; also keeps the registration alive.
+			 *
+			 *   0   uint8  type
+			 *   1   uint8  bitmask of the game pads
+			 *   2-5 uint32 cookie from the last RegisterAck; 0 at first
+			 *
+			 * Answered with a RegisterAck. Nothing is sent to the client
+			 * until it registers with the cookie, which proves the address
+			 * is really its own.
+			 */
+			Register = 0x01,
+			/**
+			 * Set the vibration of a game pad.
+			 *
+			 *   0   uint8  type
+			 *   1-2 uint16 sequence number chosen by the client
+			 *   3   uint8  index of the game pad
+			 *   4-5 uint8  left and right motor speeds scaled by 255
+			 *
+			 * Answered with a VibrationAck holding the sequence number and
+			 * what became of the request. Clients resend until acknowledged.
+			 * A request older than the last one answered is acknowledged as
+			 * stale but not applied, so requests that arrive out of order
+			 * never undo a newer one.
+			 */
+			Vibration = 0x02,
+			/**
+			 * Measure the round trip.
+			 *
+			 *   0   uint8  type
+			 *   1-8        anything; usually the time it was sent
+			 *
+			 * Answered with a Pong holding the same bytes.
+			 */
+			Ping = 0x03,
+			/**
+			 * Stop receiving game pads.
+			 *
+			 *   0   uint8  type
+			 */
+			Unregister = 0x04,
+			/**
+			 * The state of the registered game pads.
+			 *
+			 *   0   uint8  type
+			 *   1   uint8  number of game pads that follow
+			 *   2-5 uint32 sequence number
+			 *   6-         a binary frame of each game pad, as written by
+			 *              GamePadSerialization::writeBinary
+			 *
+			 * Sent on the frame a game pad changes and at least once a
+			 * second. Each frame holds the full state, so a client can
+			 * ignore any with a sequence number older than the newest it
+			 * has seen.
+			 */
+			Frame = 0x80,
+			/**
+			 * Acknowledges a Register.
+			 *
+			 *   0   uint8  type
+			 *   1   uint8  bitmask of the game pads
+			 *   2-5 uint32 cookie to register with
+			 *   6   uint8  1 if the client is registered; 0 otherwise
+			 */
+			RegisterAck = 0x81,
+			/**
+			 * Acknowledges a Vibration.
+			 *
+			 *   0   uint8  type
+			 *   1-2 uint16 sequence number of the request
+			 *   3   uint8  VibrationStatus of the request
+			 */
+			VibrationAck = 0x82,
+			/// Answers a Ping
+			Pong = 0x83
+		} ; // end enum Enum
+	} // end namespace UdpMessage
+
+	/**
+	 * What became of a Vibration, as reported in its VibrationAck.
+	 *
+	 * Only an applied request changes the game pad. Resending the newest
+	 * request gets the answer it was first given.
+	 */
+	namespace VibrationStatus
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// The speeds will be applied to the game pad
+			Applied = 0x00,
+			/// A newer request was already answered so this one was dropped
+			Stale = 0x01,
+			/// The index of the game pad is out of range
+			Invalid = 0x02,
+			/// The game pad isn't connected or can't vibrate
+			Unavailable = 0x03
+		} ; // end enum Enum
+	} // end namespace VibrationStatus
+
+	/**
+	 * Sends game pad state over UDP to clients that can't wait on TCP.
+	 *
+	 * The WebSocket path resends whatever TCP lost before anything newer
+	 * gets through. Over UDP a lost frame is replaced by the next one. The
+	 * transport runs on its own thread next to the shards, reading the game
+	 * pads directly, so the isolates never see its traffic.
+	 *
+	 * Clients register for a set of game pads and are forgotten if they
+	 * aren't heard from for five seconds, so they register again every
+	 * second to stay subscribed. A registration only counts once the
+	 * client echoes the cookie it was sent, so a forged source address
+	 * can't have frames sent to someone else, and only so many clients
+	 * are served at once.
+	 *
+	 * Only supported on Linux.
+	 */
+	namespace UdpTransport
+	{
+		/**
+		 * Starts serving the transport.
+		 *
+		 * \param host The address to bind to.
+		 * \param port The port to bind to.
+		 * \param framesPerSecond The rate the game pads are sent at, up to EmbedLibraries::MaxFramesPerSecond.
+		 * \returns true if the transport is being served; false otherwise.
+		 */
+		bool start(const char* host, std::uint16_t port, std::uint32_t framesPerSecond);
+
+		/**
+		 * Stops serving the transport.
+		 */
+		void terminate();
+	} // end namespace UdpTransport
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_UDP_TRANSPORT_HPP_INCLUDED
@@ -0,0 +1,455 @@
+/**
+ * \file UriResolution.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "UriResolution.hpp"
+#include <cctype>
+#include <cstring>
+using namespace DartEmbed;
+
+namespace
+{
+	/**
+	 * Writes characters into a fixed size buffer.
+	 *
+	 * Once the buffer is full any further writes are dropped and the
+	 * overflow flag is set.
+	 */
+	struct OutputBuffer
+	{
+		/// The buffer to write to
+		char* data;
+		/// The size of the buffer
+		std::size_t size;
+		/// The number of characters written
+		std::size_t length;
+		/// Whether the buffer was too small
+		bool overflow;
+	} ; // end struct OutputBuffer
+
+	/**
+	 * Initializes an OutputBuffer.
+	 *
+	 * \param out The OutputBuffer to initialize.
+	 * \param buffer The buffer to write to.
+	 * \param size The size of the buffer.
+	 */
+	inline void __initializeOutput(OutputBuffer* out, char* buffer, std::size_t size)
+	{
+		out->data = buffer;
+		out->size = size;
+		out->length = 0;
+		out->overflow = (size == 0);
+
+		if (size > 0)
+			buffer[0] = '\0';
+	}
+
+	/**
+	 * Appends a character to the output.
+	 *
+	 * \param out The buffer to write to.
+	 * \param value The character to append.
+	 */
+	inline void __append(OutputBuffer* out, char value)
+	{
+		if (out->length + 1 < out->size)
+		{
+			out->data[out->length++] = value;
+			out->data[out->length] = '\0';
+		}
+		else
+		{
+			out->overflow = true;
+		}
+	}
+
+	/**
+	 * Appends a string to the output.
+	 *
+	 * \param out The buffer to write to.
+	 * \param value The string to append.
+	 */
+	inline void __append(OutputBuffer* out, const char* value)
+	{
+		while (*value != '\0')
+			__append(out, *value++);
+	}
+
+	/**
+	 * Determines whether the character separates path segments.
+	 *
+	 * \param value The character to query.
+	 * \param windows Whether Windows path rules are in effect.
+	 * \returns true if the character is a separator; false otherwise.
+	 */
+	inline bool __isSeparator(char value, bool windows)
+	{
+		return (value == '/') || (windows && (value == '\\'));
+	}
+
+	/**
+	 * Determines whether the path begins with a drive letter.
+	 *
+	 * \param path The path to query.
+	 * \returns true if the path begins with a drive letter; false otherwise.
+	 */
+	inline bool __isDriveLetter(const char* path)
+	{
+		return isalpha(static_cast<unsigned char>(path[0])) &&
+		       (path[1] == ':') &&
+		       ((path[2] == '/') || (path[2] == '\\') || (path[2] == '\0'));
+	}
+
+	/**
+	 * Gets the length of the scheme at the start of the URI.
+	 *
+	 * \param uri The URI to query.
+	 * \returns The length of the scheme or 0 if there is no scheme.
+	 */
+	std::size_t __schemeLength(const char* uri)
+	{
+		if (!isalpha(static_cast<unsigned char>(uri[0])))
+			return 0;
+
+		const char* current = uri + 1;
+
+		while (isalnum(static_cast<unsigned char>(*current)) || (*current == '+') || (*current == '-') || (*current == '.'))
+			current++;
+
+		return (*current == ':') ? static_cast<std::size_t>(current - uri) : 0;
+	}
+
+	/**
+	 * Determines whether the reference is an absolute URI.
+	 *
+	 * A drive letter is indistinguishable from a single character scheme
+	 * so they are only treated as a scheme when Windows rules are not in effect.
+	 *
+	 * \param uri The URI to query.
+	 * \param windows Whether Windows path rules are in effect.
+	 * \returns true if the reference has a scheme; false otherwise.
+	 */
+	inline bool __hasScheme(const char* uri, bool windows)
+	{
+		std::size_t length = __schemeLength(uri);
+
+		return (length > 1) || ((length == 1) && !windows);
+	}
+
+	/**
+	 * Determines whether the character can appear unescaped in a URI path.
+	 *
+	 * \param value The character to query.
+	 * \returns true if the character can be used as is; false otherwise.
+	 */
+	inline bool __isPathCharacter(char value)
+	{
+		return isalnum(static_cast<unsigned char>(value)) || ((value != '\0') && (strchr("-._~!$&'()*+,;=:@/", value) != 0));
+	}
+
+	/**
+	 * Appends a path to the output converting any separators to '/'.
+	 *
+	 * Characters that have a meaning within a URI, such as '%', '?' and '#',
+	 * are percent-encoded so filePathFromUri produces the original path.
+	 *
+	 * \param out The buffer to write to.
+	 * \param path The path to append.
+	 * \param windows Whether Windows path rules are in effect.
+	 */
+	void __appendPath(OutputBuffer* out, const char* path, bool windows)
+	{
+		static const char digits[] = "0123456789ABCDEF";
+
+		while (*path != '\0')
+		{
+			char value = *path++;
+
+			if (__isSeparator(value, windows))
+			{
+				__append(out, '/');
+			}
+			else if (__isPathCharacter(value))
+			{
+				__append(out, value);
+			}
+			else
+			{
+				unsigned char byte = static_cast<unsigned char>(value);
+
+				__append(out, '%');
+				__append(out, digits[byte >> 4]);
+				__append(out, digits[byte & 0x0f]);
+			}
+		}
+	}
+
+	/**
+	 * Removes any '.' and '..' segments from an absolute path.
+	 *
+	 * Works in place as the output can never be longer than the input.
+	 *
+	 * \param path The path to normalize.
+	 */
+	void __removeDotSegments(char* path)
+	{
+		if (*path != '/')
+			return;
+
+		char* output = path;
+		const char* input = path;
+
+		while (*input != '\0')
+		{
+			// The input always points to the '/' preceding a segment
+			const char* segment = input + 1;
+			const char* end = segment;
+
+			while ((*end != '\0') && (*end != '/'))
+				end++;
+
+			std::size_t length = end - segment;
+			bool last = (*end == '\0');
+
+			if ((length == 1) && (segment[0] == '.'))
+			{
+				if (last)
+					*output++ = '/';
+			}
+			else if ((length == 2) && (segment[0] == '.') && (segment[1] == '.'))
+			{
+				// Drop the previous segment
+				while ((output > path) && (*--output != '/'))
+					;
+
+				if (last)
+					*output++ = '/';
+			}
+			else
+			{
+				std::size_t count = end - input;
+				memmove(output, input, count);
+				output += count;
+			}
+
+			input = end;
+		}
+
+		*output = '\0';
+	}
+
+	/**
+	 * Converts a hexadecimal digit into its value.
+	 *
+	 * \param value The digit to convert.
+	 * \returns The value of the digit or -1 if it is not a hexadecimal digit.
+	 */
+	inline int __hexValue(char value)
+	{
+		if ((value >= '0') && (value <= '9'))
+			return value - '0';
+		if ((value >= 'a') && (value <= 'f'))
+			return value - 'a' + 10;
+		if ((value >= 'A') && (value <= 'F'))
+			return value - 'A' + 10;
+
+		return -1;
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+PathStyle::Enum UriResolution::getHostPathStyle()
+{
+#ifdef _WIN32
+	return PathStyle::Windows;
+#else
+	return PathStyle::Posix;
+#endif
+}
+
+//----------------------------------------------------------------------
+
+bool UriResolution::resolveScriptUri(
+	const char* workingDirectory,
+	const char* scriptUri,
+	PathStyle::Enum style,
+	char* buffer,
+	std::size_t size)
+{
+	bool windows = (style == PathStyle::Windows);
+
+	OutputBuffer out;
+	__initializeOutput(&out, buffer, size);
+
+	// Already a URI so there is nothing to resolve
+	if (__hasScheme(scriptUri, windows))
+	{
+		__append(&out, scriptUri);
+
+		return !out.overflow;
+	}
+
+	std::size_t pathStart;
+
+	if (__isSeparator(scriptUri[0], windows) && __isSeparator(scriptUri[1], windows))
+	{
+		// Network path so the first segment is the authority
+		__append(&out, "file:");
+		__appendPath(&out, scriptUri, windows);
+
+		const char* path = strchr(buffer + 7, '/');
+		pathStart = (path) ? path - buffer : out.length;
+	}
+	else
+	{
+		__append(&out, "file://");
+		pathStart = out.length;
+
+		if (__isSeparator(scriptUri[0], windows))
+		{
+			__appendPath(&out, scriptUri, windows);
+		}
+		else if (windows && __isDriveLetter(scriptUri))
+		{
+			__append(&out, '/');
+			__appendPath(&out, scriptUri, windows);
+		}
+		else
+		{
+			// Relative to the working directory
+			if (!__isSeparator(workingDirectory[0], windows))
+				__append(&out, '/');
+
+			__appendPath(&out, workingDirectory, windows);
+
+			if (buffer[out.length - 1] != '/')
+				__append(&out, '/');
+
+			__appendPath(&out, scriptUri, windows);
+		}
+	}
+
+	if (out.overflow)
+		return false;
+
+	// The drive letter is the root of the path so '..' can never remove it
+	if (windows && (buffer[pathStart] == '/') && __isDriveLetter(buffer + pathStart + 1))
+		pathStart += 3;
+
+	__removeDotSegments(buffer + pathStart);
+
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+bool UriResolution::filePathFromUri(
+	const char* uri,
+	PathStyle::Enum style,
+	char* buffer,
+	std::size_t size)
+{
+	bool windows = (style == PathStyle::Windows);
+	const char* path = uri;
+	bool decode = false;
+
+	OutputBuffer out;
+	__initializeOutput(&out, buffer, size);
+
+	if (__hasScheme(uri, windows))
+	{
+		// Only file URIs map to the file system
+		if ((__schemeLength(uri) != 4) || (strncmp(uri, "file:", 5) != 0))
+			return false;
+
+		path = uri + 5;
+		decode = true;
+
+		if ((path[0] == '/') && (path[1] == '/'))
+		{
+			const char* authority = path + 2;
+			path = strchr(authority, '/');
+
+			if (!path)
+				return false;
+
+			std::size_t authorityLength = path - authority;
+
+			if ((authorityLength != 0) && ((authorityLength != 9) || (strncmp(authority, "localhost", 9) != 0)))
+			{
+				// Remote hosts are only reachable through UNC paths
+				if (!windows)
+					return false;
+
+				__append(&out, "\\\\");
+
+				for (std::size_t i = 0; i < authorityLength; ++i)
+					__append(&out, authority[i]);
+			}
+		}
+
+		// Drop the leading '/' in front of a drive letter
+		if (windows && (path[0] == '/') && __isDriveLetter(path + 1))
+			path++;
+	}
+
+	while (*path != '\0')
+	{
+		char value = *path++;
+
+		if (decode)
+		{
+			// The query and fragment are not part of the path
+			if ((value == '?') || (value == '#'))
+				break;
+
+			if (value == '%')
+			{
+				int high = __hexValue(path[0]);
+				int low  = (high >= 0) ? __hexValue(path[1]) : -1;
+
+				if (low >= 0)
+				{
+					value = static_cast<char>((high << 4) | low);
+					path += 2;
+				}
+			}
+		}
+
+		if (windows && (value == '/'))
+			value = '\\';
+
+		__append(&out, value);
+	}
+
+	return !out.overflow;
+}
@@ -0,0 +1,116 @@
+/**
+ * \file UriResolution.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_URI_RESOLUTION_HPP_INCLUDED
+#define DART_EMBED_URI_RESOLUTION_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace DartEmbed
+{
+	/**
+	 * Specifies the rules used when converting between file paths and URIs.
+	 */
+	namespace PathStyle
+	{
+		/// An enumerated type
+		enum Enum
+		{
+			/// Paths are separated by '/' and rooted at '/'
+			Posix,
+			/// Paths are separated by '\' or '/' and may begin with a drive letter
+			Windows,
+			/// The number of enumerations
+			Size
+		} ; // end enum Enum
+	} // end namespace PathStyle
+
+	/**
+	 * Native implementation of the URI handling found in dart:builtin.
+	 *
+	 * Mirrors the behavior of _resolveScriptUri and _filePathFromUri without
+	 * calling into the isolate. All results are written into buffers provided
+	 * by the caller so no allocations are made.
+	 */
+	namespace UriResolution
+	{
+		/// The size of a buffer that can hold any URI or path the embedder produces
+		const std::size_t MaxLength = 1024;
+
+		/**
+		 * Gets the path style of the host platform.
+		 *
+		 * \returns The path style of the host platform.
+		 */
+		PathStyle::Enum getHostPathStyle();
+
+		/**
+		 * Resolves the URI of a script against the working directory.
+		 *
+		 * References with a scheme other than a drive letter are copied as is.
+		 * Anything else is treated as a path and resolved to a file URI with
+		 * any reserved characters percent-encoded.
+		 *
+		 * \param workingDirectory The directory relative paths are resolved against.
+		 * \param scriptUri The path or URI to the script.
+		 * \param style The rules to use when interpreting paths.
+		 * \param buffer The buffer to write the URI into.
+		 * \param size The size of the buffer.
+		 * \returns true if the URI was resolved; false otherwise.
+		 */
+		bool resolveScriptUri(
+			const char* workingDirectory,
+			const char* scriptUri,
+			PathStyle::Enum style,
+			char* buffer,
+			std::size_t size);
+
+		/**
+		 * Determines the file path from the given URI.
+		 *
+		 * Only file URIs and plain paths can be converted. Other schemes are
+		 * left for the embedder to handle.
+		 *
+		 * \param uri The URI to convert.
+		 * \param style The rules to use when producing the path.
+		 * \param buffer The buffer to write the path into.
+		 * \param size The size of the buffer.
+		 * \returns true if the path was determined; false otherwise.
+		 */
+		bool filePathFromUri(
+			const char* uri,
+			PathStyle::Enum style,
+			char* buffer,
+			std::size_t size);
+	} // end namespace UriResolution
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_URI_RESOLUTION_HPP_INCLUDED
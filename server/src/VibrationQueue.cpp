@@ -0,0 +1,103 @@
+/**
+ * \file VibrationQueue.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "VibrationQueue.hpp"
+#include "AsyncNative.hpp"
+#include "Thread.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/**
+	 * The latest vibration asked for a controller.
+	 */
+	struct PendingVibration
+	{
+		/// The speed of the left motor
+		float leftMotor;
+		/// The speed of the right motor
+		float rightMotor;
+		/// Whether the speeds changed since they were last applied
+		bool changed;
+		/// Whether a worker is applying the speeds
+		bool queued;
+	} ; // end struct PendingVibration
+
+	/// Guards the pending vibration
+	Mutex __mutex;
+	/// The vibration waiting to be applied to each controller
+	PendingVibration __pendingVibration[PlayerIndex::Size];
+
+	/**
+	 * Applies the pending vibration of a controller on a worker.
+	 *
+	 * \param argument The controller.
+	 */
+	void __runPendingVibration(void* argument)
+	{
+		PlayerIndex::Enum player = static_cast<PlayerIndex::Enum>(reinterpret_cast<std::intptr_t>(argument));
+		PendingVibration& pending = __pendingVibration[player];
+
+		__mutex.lock();
+
+		while (pending.changed)
+		{
+			float leftMotor = pending.leftMotor;
+			float rightMotor = pending.rightMotor;
+			pending.changed = false;
+
+			__mutex.unlock();
+			GamePad::setVibration(player, leftMotor, rightMotor);
+			__mutex.lock();
+		}
+
+		pending.queued = false;
+
+		__mutex.unlock();
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+bool VibrationQueue::set(PlayerIndex::Enum player, float leftMotor, float rightMotor)
+{
+	ScopedLock lock(__mutex);
+
+	PendingVibration& pending = __pendingVibration[player];
+	pending.leftMotor = leftMotor;
+	pending.rightMotor = rightMotor;
+	pending.changed = true;
+
+	if (!pending.queued)
+		pending.queued = AsyncNatives::submit(__runPendingVibration, reinterpret_cast<void*>(static_cast<std::intptr_t>(player)));
+
+	return pending.queued;
+}
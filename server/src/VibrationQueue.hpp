@@ -0,0 +1,61 @@
+/**
+ * \file VibrationQueue.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_VIBRATION_QUEUE_HPP_INCLUDED
+#define DART_EMBED_VIBRATION_QUEUE_HPP_INCLUDED
+
+#include <DartEmbed/GamePad.hpp>
+
+namespace DartEmbed
+{
+	/**
+	 * Sets the vibration of the controllers on the async workers.
+	 *
+	 * Clients stream vibration as fast as they like, so speeds replace
+	 * any that haven't been applied rather than queueing behind them.
+	 * Speeds that change while a controller is being set are applied once
+	 * it returns, so a controller is never set from two workers at once.
+	 */
+	namespace VibrationQueue
+	{
+		/**
+		 * Sets the vibration of a controller without waiting for it.
+		 *
+		 * \param player The controller to vibrate.
+		 * \param leftMotor The speed of the left motor.
+		 * \param rightMotor The speed of the right motor.
+		 * \returns true if the speeds will be applied; false if the workers aren't running.
+		 */
+		bool set(PlayerIndex::Enum player, float leftMotor, float rightMotor);
+	} // end namespace VibrationQueue
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_VIBRATION_QUEUE_HPP_INCLUDED
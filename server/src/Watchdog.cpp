@@ -0,0 +1,342 @@
+/**
+ * \file Watchdog.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "Watchdog.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "dart_debugger_api.h"
+#include "Clock.hpp"
+#include "EmbedIsolateData.hpp"
+#include "Json.hpp"
+#include "ThreadConfiguration.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// The most frames of an interrupted isolate to report
+	const intptr_t __maxFrames = 32;
+
+	/**
+	 * The state of a watched isolate.
+	 */
+	struct Watch
+	{
+		/// The isolate being watched
+		Dart_Isolate isolate;
+		/// When the current message started in microseconds
+		std::uint64_t start;
+		/// Whether a message is being handled
+		bool active;
+		/// Whether the current message was reported
+		bool reported;
+		/// Whether the isolate was interrupted for the current message
+		bool interrupted;
+	} ; // end struct Watch
+
+	/// Guards the watchdog state
+	Mutex __mutex;
+	/// Signaled when the watchdog is stopped
+	ConditionVariable __stopped;
+	/// Thread checking the isolates
+	Thread __watchdogThread;
+	/// Whether the thread should exit
+	bool __shutdown = false;
+	/// Time in microseconds before a message is reported
+	std::uint64_t __budget = 0;
+	/// Time in microseconds before the isolate is interrupted
+	std::uint64_t __limit = 0;
+	/// The isolates being watched
+	std::vector<Watch> __watches;
+
+	/**
+	 * Finds the watch for an isolate.
+	 *
+	 * The mutex must be held by the caller.
+	 *
+	 * \param isolate The isolate to find.
+	 * \returns The watch or 0 if the isolate isn't watched.
+	 */
+	Watch* __findWatch(Dart_Isolate isolate)
+	{
+		std::size_t count = __watches.size();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (__watches[i].isolate == isolate)
+				return &__watches[i];
+		}
+
+		return 0;
+	}
+
+	/**
+	 * Reads a number of milliseconds from the configuration.
+	 *
+	 * \param configuration The configuration of the watchdog.
+	 * \param name The name of the member.
+	 * \returns The number of milliseconds or 0 if not present.
+	 */
+	std::uint32_t __readMilliseconds(const JsonValue* configuration, const char* name)
+	{
+		const JsonValue* value = configuration->getMember(name);
+
+		if (!value || (value->getType() != JsonType::Number) || (value->getNumber() < 0))
+			return 0;
+
+		return static_cast<std::uint32_t>(value->getNumber());
+	}
+
+	/**
+	 * Prints the stack of the current isolate.
+	 *
+	 * Walks the frames through the debugger API, which sees every frame
+	 * of the running isolate including the ones of the handler that was
+	 * interrupted.
+	 *
+	 * A scope must be entered by the caller.
+	 *
+	 * \returns true if the stack was printed; false otherwise.
+	 */
+	bool __printStack()
+	{
+		Dart_StackTrace trace;
+		intptr_t length;
+
+		if (Dart_IsError(Dart_GetStackTrace(&trace)) || !trace || Dart_IsError(Dart_StackTraceLength(trace, &length)))
+			return false;
+
+		intptr_t count = std::min(length, __maxFrames);
+
+		for (intptr_t i = 0; i < count; ++i)
+		{
+			Dart_ActivationFrame frame;
+			Dart_Handle functionName;
+			Dart_Handle scriptUrl;
+			intptr_t lineNumber;
+			const char* function = "<unknown>";
+			const char* script = "<unknown>";
+
+			if (Dart_IsError(Dart_GetActivationFrame(trace, static_cast<int>(i), &frame)) ||
+			    Dart_IsError(Dart_ActivationFrameInfo(frame, &functionName, &scriptUrl, &lineNumber, 0)))
+				return false;
+
+			Dart_StringToCString(functionName, &function);
+			Dart_StringToCString(scriptUrl, &script);
+
+			printf("  #%d %s (%s:%d)\n", static_cast<int>(i), function, script, static_cast<int>(lineNumber));
+		}
+
+		if (length > count)
+			printf("  ... %d more frames\n", static_cast<int>(length - count));
+
+		return true;
+	}
+} // end anonymous namespace
+
+//----------------------------------------------------------------------
+
+void Watchdog::configure(const JsonValue* configuration)
+{
+	const JsonValue* watchdog = configuration->getMember("watchdog");
+
+	if (!watchdog || (watchdog->getType() != JsonType::Object))
+		return;
+
+	std::uint32_t budget = __readMilliseconds(watchdog, "budget");
+
+	if (budget > 0)
+		start(budget, __readMilliseconds(watchdog, "limit"));
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::start(std::uint32_t budget, std::uint32_t limit)
+{
+	ScopedLock lock(__mutex);
+
+	__budget = static_cast<std::uint64_t>(budget) * 1000;
+	__limit  = static_cast<std::uint64_t>(limit)  * 1000;
+
+	if (!__watchdogThread.isStarted())
+	{
+		__shutdown = false;
+		__watchdogThread.start(run, 0, ThreadConfiguration::getOptions(ThreadRole::Watchdog));
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::stop()
+{
+	__mutex.lock();
+	__shutdown = true;
+	__stopped.broadcast();
+	__mutex.unlock();
+
+	__watchdogThread.join();
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::attach()
+{
+	Watch watch = { Dart_CurrentIsolate(), 0, false, false, false };
+
+	ScopedLock lock(__mutex);
+
+	if (!__findWatch(watch.isolate))
+		__watches.push_back(watch);
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::detach(Dart_Isolate isolate)
+{
+	ScopedLock lock(__mutex);
+
+	Watch* watch = __findWatch(isolate);
+
+	if (watch)
+		__watches.erase(__watches.begin() + (watch - &__watches[0]));
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::begin(Dart_Isolate isolate)
+{
+	std::uint64_t now = Clock::getMicroseconds();
+
+	ScopedLock lock(__mutex);
+
+	Watch* watch = __findWatch(isolate);
+
+	if (watch)
+	{
+		watch->start = now;
+		watch->active = true;
+		watch->reported = false;
+		watch->interrupted = false;
+	}
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::end(Dart_Isolate isolate)
+{
+	std::uint64_t now = Clock::getMicroseconds();
+
+	ScopedLock lock(__mutex);
+
+	Watch* watch = __findWatch(isolate);
+
+	if (watch)
+	{
+		watch->active = false;
+
+		if (watch->reported)
+			printf("Isolate %p finished the message after %llu ms\n", isolate, static_cast<unsigned long long>((now - watch->start) / 1000));
+	}
+}
+
+//----------------------------------------------------------------------
+
+bool Watchdog::interruptCallback()
+{
+	Dart_Isolate isolate = Dart_CurrentIsolate();
+	std::uint64_t elapsed;
+
+	{
+		ScopedLock lock(__mutex);
+
+		Watch* watch = __findWatch(isolate);
+
+		// Ignore interrupts the watchdog didn't request
+		if (!watch || !watch->interrupted)
+			return true;
+
+		elapsed = Clock::getMicroseconds() - watch->start;
+	}
+
+	printf("Isolate %p exceeded the limit after %llu ms while handling a message:\n", isolate, static_cast<unsigned long long>(elapsed / 1000));
+
+	// The interrupt is delivered on the isolate's own thread so its frames are on the stack
+	Dart_EnterScope();
+
+	if (!__printStack())
+		printf("  unable to capture the stack\n");
+
+	Dart_ExitScope();
+
+	// The virtual machine can't unwind the isolate so let the handler continue
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+void Watchdog::run(void* argument)
+{
+	__mutex.lock();
+
+	while (!__shutdown)
+	{
+		// Check often enough to catch a message shortly after its budget
+		std::uint64_t period = std::max<std::uint64_t>(__budget / 4000, 1);
+		__stopped.wait(__mutex, static_cast<std::uint32_t>(period));
+
+		std::uint64_t now = Clock::getMicroseconds();
+		std::size_t count = __watches.size();
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			Watch& watch = __watches[i];
+
+			if (!watch.active)
+				continue;
+
+			std::uint64_t elapsed = now - watch.start;
+
+			if (!watch.reported && (elapsed >= __budget))
+			{
+				watch.reported = true;
+				printf("Isolate %p has been handling a message for %llu ms\n", watch.isolate, static_cast<unsigned long long>(elapsed / 1000));
+			}
+
+			if ((__limit != 0) && !watch.interrupted && (elapsed >= __limit))
+			{
+				watch.interrupted = true;
+				Dart_InterruptIsolate(watch.isolate);
+			}
+		}
+	}
+
+	__mutex.unlock();
+}
@@ -0,0 +1,130 @@
+/**
+ * \file Watchdog.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_WATCHDOG_HPP_INCLUDED
+#define DART_EMBED_WATCHDOG_HPP_INCLUDED
+
+#include <cstdint>
+#include "dart_api.h"
+
+namespace DartEmbed
+{
+	//---------------------------------------------------------------------
+	// Forward declarations
+	//---------------------------------------------------------------------
+
+	class JsonValue;
+
+	/**
+	 * Watches how long isolates spend handling messages.
+	 *
+	 * A thread checks the isolates attached to a MessageLoop. A message
+	 * running past the budget is reported while it runs, and one running
+	 * past the limit has its isolate interrupted so the Dart stack can be
+	 * captured from within the runaway handler.
+	 */
+	class Watchdog
+	{
+		public:
+
+			/**
+			 * Configures the watchdog from the watchdog member of config.json.
+			 *
+			 * The member may contain a budget and a limit in milliseconds. The
+			 * watchdog starts if a budget is given.
+			 *
+			 * \param configuration The root of the configuration.
+			 */
+			static void configure(const JsonValue* configuration);
+
+			/**
+			 * Starts the watchdog thread.
+			 *
+			 * \param budget Time in milliseconds before a message is reported.
+			 * \param limit Time in milliseconds before the isolate is interrupted; 0 to never interrupt.
+			 */
+			static void start(std::uint32_t budget, std::uint32_t limit);
+
+			/**
+			 * Stops the watchdog thread.
+			 */
+			static void stop();
+
+			/**
+			 * Starts watching the current isolate.
+			 */
+			static void attach();
+
+			/**
+			 * Stops watching an isolate.
+			 *
+			 * \param isolate The isolate to stop watching.
+			 */
+			static void detach(Dart_Isolate isolate);
+
+			/**
+			 * Marks the start of handling a message.
+			 *
+			 * \param isolate The isolate handling the message.
+			 */
+			static void begin(Dart_Isolate isolate);
+
+			/**
+			 * Marks the end of handling a message.
+			 *
+			 * \param isolate The isolate that handled the message.
+			 */
+			static void end(Dart_Isolate isolate);
+
+			/**
+			 * Callback for when an isolate is interrupted.
+			 *
+			 * Captures and reports the stack of an isolate interrupted by the
+			 * watchdog.
+			 *
+			 * \returns true to continue execution.
+			 */
+			static bool interruptCallback();
+
+		private:
+
+			/**
+			 * Checks the watched isolates until the watchdog is stopped.
+			 *
+			 * \param argument Unused.
+			 */
+			static void run(void* argument);
+
+			Watchdog() { }
+	} ; // end class Watchdog
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_WATCHDOG_HPP_INCLUDED
@@ -0,0 +1,179 @@
+/**
+ * \file WorkerPool.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#include "WorkerPool.hpp"
+using namespace DartEmbed;
+
+//----------------------------------------------------------------------
+
+WorkerPool::WorkerPool(std::size_t count, ThreadRole::Enum role)
+	: _pending(0)
+	, _next(0)
+	, _shutdown(false)
+{
+	if (count == 0)
+		count = 1;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Worker* worker = new Worker();
+		worker->pool = this;
+		worker->index = i;
+
+		_workers.push_back(worker);
+	}
+
+	// Start once every queue exists as workers steal from each other
+	for (std::size_t i = 0; i < count; ++i)
+		_workers[i]->thread.start(run, _workers[i], ThreadConfiguration::getOptions(role, i));
+}
+
+//----------------------------------------------------------------------
+
+WorkerPool::~WorkerPool()
+{
+	_mutex.lock();
+	_shutdown = true;
+	_workAvailable.broadcast();
+	_mutex.unlock();
+
+	std::size_t count = _workers.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		_workers[i]->thread.join();
+		delete _workers[i];
+	}
+}
+
+//----------------------------------------------------------------------
+
+void WorkerPool::submit(Function function, void* argument)
+{
+	Task task = { function, argument };
+	std::size_t index;
+
+	{
+		ScopedLock lock(_mutex);
+
+		index = _next;
+		_next = (_next + 1) % _workers.size();
+	}
+
+	Worker* worker = _workers[index];
+
+	{
+		ScopedLock lock(worker->mutex);
+
+		worker->tasks.push_back(task);
+	}
+
+	ScopedLock lock(_mutex);
+
+	_pending++;
+	_workAvailable.signal();
+}
+
+//----------------------------------------------------------------------
+
+bool WorkerPool::take(std::size_t index, Task* task)
+{
+	std::size_t count = _workers.size();
+
+	// Newest work from the worker's own queue is the most likely to be cached
+	{
+		Worker* worker = _workers[index];
+		ScopedLock lock(worker->mutex);
+
+		if (!worker->tasks.empty())
+		{
+			*task = worker->tasks.back();
+			worker->tasks.pop_back();
+
+			return true;
+		}
+	}
+
+	// Steal the oldest work from the others
+	for (std::size_t i = 1; i < count; ++i)
+	{
+		Worker* victim = _workers[(index + i) % count];
+		ScopedLock lock(victim->mutex);
+
+		if (!victim->tasks.empty())
+		{
+			*task = victim->tasks.front();
+			victim->tasks.pop_front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//----------------------------------------------------------------------
+
+void WorkerPool::run(void* argument)
+{
+	Worker* worker = static_cast<Worker*>(argument);
+	WorkerPool* pool = worker->pool;
+
+	pool->_mutex.lock();
+
+	while (true)
+	{
+		while ((pool->_pending == 0) && !pool->_shutdown)
+			pool->_workAvailable.wait(pool->_mutex);
+
+		// Finish the queued tasks before exiting
+		if (pool->_pending == 0)
+			break;
+
+		pool->_mutex.unlock();
+
+		// Another worker may have taken the task but not yet counted it
+		Task task;
+
+		if (pool->take(worker->index, &task))
+		{
+			pool->_mutex.lock();
+			pool->_pending--;
+			pool->_mutex.unlock();
+
+			task.function(task.argument);
+		}
+
+		pool->_mutex.lock();
+	}
+
+	pool->_mutex.unlock();
+}
@@ -0,0 +1,145 @@
+/**
+ * \file WorkerPool.hpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+#ifndef DART_EMBED_WORKER_POOL_HPP_INCLUDED
+#define DART_EMBED_WORKER_POOL_HPP_INCLUDED
+
+#include <deque>
+#include <vector>
+#include "ThreadConfiguration.hpp"
+
+namespace DartEmbed
+{
+	/**
+	 * Runs tasks on a fixed set of worker threads.
+	 *
+	 * Each worker has its own queue. Tasks are spread across the queues
+	 * round robin and a worker whose queue runs dry steals from the front
+	 * of the others, so a few long tasks don't leave workers idle.
+	 */
+	class WorkerPool
+	{
+		public:
+
+			/// A task to run
+			typedef void (*Function)(void* argument);
+
+			/**
+			 * Creates an instance of the WorkerPool class.
+			 *
+			 * \param count The number of worker threads.
+			 * \param role The role used to configure the worker threads.
+			 */
+			WorkerPool(std::size_t count, ThreadRole::Enum role);
+
+			/**
+			 * Destroys an instance of the WorkerPool class.
+			 *
+			 * Waits for the queued tasks to finish.
+			 */
+			~WorkerPool();
+
+			/**
+			 * Queues a task.
+			 *
+			 * Can be called from any thread.
+			 *
+			 * \param function The function to run.
+			 * \param argument The argument to pass to the function.
+			 */
+			void submit(Function function, void* argument);
+
+		private:
+
+			/**
+			 * A queued task.
+			 */
+			struct Task
+			{
+				/// The function to run
+				Function function;
+				/// The argument to pass to the function
+				void* argument;
+			} ; // end struct Task
+
+			/**
+			 * A worker thread and its queue.
+			 */
+			struct Worker
+			{
+				/// The pool the worker belongs to
+				WorkerPool* pool;
+				/// The index of the worker
+				std::size_t index;
+				/// Guards the queue
+				Mutex mutex;
+				/// Tasks queued on the worker
+				std::deque<Task> tasks;
+				/// The thread running the worker
+				Thread thread;
+			} ; // end struct Worker
+
+			/**
+			 * Takes a task from a worker's queue, or steals one from another.
+			 *
+			 * \param index The index of the worker.
+			 * \param task The task taken.
+			 * \returns true if a task was taken; false otherwise.
+			 */
+			bool take(std::size_t index, Task* task);
+
+			/**
+			 * Runs tasks until the pool is destroyed.
+			 *
+			 * \param argument The worker to run.
+			 */
+			static void run(void* argument);
+
+			// Copying is not allowed
+			WorkerPool(const WorkerPool&);
+			WorkerPool& operator= (const WorkerPool&);
+
+			/// The workers
+			std::vector<Worker*> _workers;
+			/// Guards the pending count and shutdown flag
+			Mutex _mutex;
+			/// Signaled when a task is submitted or on shutdown
+			ConditionVariable _workAvailable;
+			/// The number of tasks queued but not yet taken
+			std::size_t _pending;
+			/// The worker the next task is queued on
+			std::size_t _next;
+			/// Whether the workers should exit
+			bool _shutdown;
+	} ; // end class WorkerPool
+} // end namespace DartEmbed
+
+#endif // end DART_EMBED_WORKER_POOL_HPP_INCLUDED
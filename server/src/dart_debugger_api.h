@@ -0,0 +1,75 @@
+// Copyright (c) 2012, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef INCLUDE_DART_DEBUGGER_API_H_
+#define INCLUDE_DART_DEBUGGER_API_H_
+
+#include "dart_api.h"
+
+// Only the stack trace portion of the debugger API is used by the embedder.
+
+typedef struct _Dart_StackTrace* Dart_StackTrace;
+typedef struct _Dart_ActivationFrame* Dart_ActivationFrame;
+
+/**
+ * Returns in \trace the current stack trace.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \return A valid handle if no error occurs during the operation.
+ */
+DART_EXPORT Dart_Handle Dart_GetStackTrace(Dart_StackTrace* trace);
+
+
+/**
+ * Returns in \length the number of activation frames in the given
+ * stack trace.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \return A handle to the True object if no error occurs.
+ */
+DART_EXPORT Dart_Handle Dart_StackTraceLength(
+                            Dart_StackTrace trace,
+                            intptr_t* length);
+
+
+/**
+ * Returns in \frame the activation frame with index \frame_index.
+ * The activation frame at the top of stack has index 0.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \return A handle to the True object if no error occurs.
+ */
+DART_EXPORT Dart_Handle Dart_GetActivationFrame(
+                            Dart_StackTrace trace,
+                            int frame_index,
+                            Dart_ActivationFrame* frame);
+
+
+/**
+ * Returns information about the given activation frame.
+ * \function_name receives a string handle with the qualified
+ *    function name.
+ * \script_url receives a string handle with the url of the
+ *    source script that contains the frame's function.
+ * \line_number receives the line number in the script.
+ * \library_id receives the id of the library in which the
+ *    function in this frame is defined.
+ *
+ * Any or all of the out parameters above may be NULL.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \return A valid handle if no error occurs during the operation.
+ */
+DART_EXPORT Dart_Handle Dart_ActivationFrameInfo(
+                            Dart_ActivationFrame activation_frame,
+                            Dart_Handle* function_name,
+                            Dart_Handle* script_url,
+                            intptr_t* line_number,
+                            intptr_t* library_id);
+
+#endif  // INCLUDE_DART_DEBUGGER_API_H_
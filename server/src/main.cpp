@@ -31,148 +31,263 @@
 
 #include <DartEmbed/GamePad.hpp>
 #include <DartEmbed/Isolate.hpp>
-#include "PlatformWindows.hpp"
+#include <DartEmbed/VirtualMachine.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "BuiltinLibraries.hpp"
 #include "EmbedLibraries.hpp"
+#include "Handover.hpp"
+#include "Host.hpp"
+#include "Json.hpp"
+#include "ThreadConfiguration.hpp"
+#include "UdpTransport.hpp"
+#include "Watchdog.hpp"
 using namespace DartEmbed;
 
 namespace
 {
-	/// Handle to the window
-	HWND handle;
+	/// The number of serving isolates; 0 for one per processor
+	std::size_t __shardCount = 1;
+	/// The rate the frame clock ticks at
+	std::uint32_t __frameRate = 60;
+	/// The path the listening sockets are handed over on; 0 to disable
+	const char* __handoverPath = 0;
+	/// Time allowed to drain connections after a handover in milliseconds
+	std::uint32_t __drainTimeout = 30000;
+	/// Time allowed for the shards to listen on inherited sockets in milliseconds
+	const std::uint32_t __handoverTimeout = 10000;
+	/// The address the server listens on
+	char __host[64] = "127.0.0.1";
+	/// The port of the UDP transport; 0 to disable
+	std::uint16_t __udpPort = 0;
+
+	/**
+	 * A script to keep isolates ready for.
+	 */
+	struct PooledScript
+	{
+		/// The path to the script
+		char path[256];
+		/// The number of isolates to keep ready
+		std::size_t size;
+	} ; // end struct PooledScript
+
+	/// The scripts to keep isolates ready for
+	std::vector<PooledScript> __pooledScripts;
 
 	//---------------------------------------------------------------------
 
-	void InitWindow(std::int32_t width, std::int32_t height)
+	void __parseArguments(int argc, char** argv)
 	{
-		// Set the window styles
-		DWORD dwStyle   = WS_VISIBLE | WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX;
-		DWORD dwExStyle = WS_EX_APPWINDOW;
-
-		// Get the window size
-		RECT rect;
-		rect.left   = 0;
-		rect.right  = width - 1;
-		rect.top    = 0;
-		rect.bottom = height - 1;
-
-		AdjustWindowRectEx(&rect, dwStyle, FALSE, dwExStyle);
-
-		std::int32_t fullWidth  = rect.right - rect.left + 1;
-		std::int32_t fullHeight = rect.bottom + rect.top + 1;
-
-		// Get the working area
-		RECT wa;
-
-		SystemParametersInfo(SPI_GETWORKAREA, 0, &wa, 0);
-
-		// Create the window
-		handle = CreateWindowExA
-		(
-			dwExStyle,
-			WINDOW_CLASS_NAME,
-			WINDOW_CLASS_NAME,
-			dwStyle,
-			wa.left, wa.top,
-			fullWidth,
-			fullHeight,
-			0,
-			0,
-			0,
-			0
-		);
-	}
+		const char* startupReport = "--startup-report=";
+		const std::size_t startupReportLength = strlen(startupReport);
+		const char* shards = "--shards=";
+		const std::size_t shardsLength = strlen(shards);
+		const char* handover = "--handover=";
+		const std::size_t handoverLength = strlen(handover);
+		const char* drainTimeout = "--drain-timeout=";
+		const std::size_t drainTimeoutLength = strlen(drainTimeout);
 
-	//---------------------------------------------------------------------
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strncmp(argv[i], startupReport, startupReportLength) == 0)
+				VirtualMachine::setStartupReportPath(argv[i] + startupReportLength);
+			else if (strncmp(argv[i], shards, shardsLength) == 0)
+				__shardCount = strtoul(argv[i] + shardsLength, 0, 10);
+			else if (strncmp(argv[i], handover, handoverLength) == 0)
+				__handoverPath = argv[i] + handoverLength;
+			else if (strncmp(argv[i], drainTimeout, drainTimeoutLength) == 0)
+				__drainTimeout = strtoul(argv[i] + drainTimeoutLength, 0, 10) * 1000;
+			else if (strcmp(argv[i], "--warm-up=background") == 0)
+				VirtualMachine::setWarmUpMode(WarmUpMode::Background);
+			else if (strcmp(argv[i], "--warm-up=startup") == 0)
+				VirtualMachine::setWarmUpMode(WarmUpMode::Startup);
+			else
+				printf("Unknown argument: %s\n", argv[i]);
+		}
+	}
 
-	LRESULT WINAPI MsgProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	/**
+	 * Reads the configuration of the application.
+	 *
+	 * A missing file leaves the defaults in place. The frameRate member
+	 * sets the rate of the frame clock in embed:input and timerResolution
+	 * the length of a tick of the timer wheel in milliseconds. The UDP
+	 * transport is served on the host at udpPort when it is given. Each
+	 * element of pool names a script and the number of isolates to keep
+	 * ready for it, such as { "script": "worker.dart", "size": 2 }.
+	 *
+	 * \param path The path to the configuration.
+	 */
+	void __loadConfiguration(const char* path)
 	{
-		switch (msg)
+		FILE* file = fopen(path, "rb");
+
+		if (!file)
+			return;
+
+		fclose(file);
+
+		JsonValue* configuration = JsonValue::parseFile(path);
+
+		if (!configuration)
 		{
-			case WM_DESTROY:
-			{
-				PostQuitMessage(0);
-				return 0;
-			}
+			printf("Unable to parse %s\n", path);
+			return;
 		}
 
-		return DefWindowProc(hWnd, msg, wParam, lParam);
-	}
+		ThreadConfiguration::configure(configuration);
+		Watchdog::configure(configuration);
 
-	//---------------------------------------------------------------------
+		const JsonValue* frameRate = configuration->getMember("frameRate");
 
-	DWORD WINAPI __scriptThread(LPVOID param)
-	{
-		// Load the script and invoke
-		Isolate* isolate = Isolate::loadScript("server.dart");
-		isolate->invokeFunction("main");
+		if (frameRate && (frameRate->getType() == JsonType::Number) && (frameRate->getNumber() >= 1))
+			__frameRate = static_cast<std::uint32_t>(std::min<double>(frameRate->getNumber(), EmbedLibraries::MaxFramesPerSecond));
+
+		const JsonValue* timerResolution = configuration->getMember("timerResolution");
+
+		if (timerResolution && (timerResolution->getType() == JsonType::Number) && (timerResolution->getNumber() >= 1))
+			VirtualMachine::setTimerResolution(static_cast<std::uint32_t>(timerResolution->getNumber()));
+
+		const JsonValue* host = configuration->getMember("host");
+
+		if (host && (host->getType() == JsonType::String))
+		{
+			strncpy(__host, host->getString(), sizeof(__host) - 1);
+			__host[sizeof(__host) - 1] = '\0';
+		}
+
+		const JsonValue* udpPort = configuration->getMember("udpPort");
+
+		if (udpPort && (udpPort->getType() == JsonType::Number) && (udpPort->getNumber() >= 1) && (udpPort->getNumber() <= 65535))
+			__udpPort = static_cast<std::uint16_t>(udpPort->getNumber());
+
+		const JsonValue* pool = configuration->getMember("pool");
+
+		if (pool && (pool->getType() == JsonType::Array))
+		{
+			std::size_t count = pool->getSize();
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const JsonValue* entry = pool->getElement(i);
 
-		return 0;
+				if (entry->getType() != JsonType::Object)
+					continue;
+
+				const JsonValue* script = entry->getMember("script");
+				const JsonValue* size = entry->getMember("size");
+
+				if (!script || (script->getType() != JsonType::String) || !size || (size->getType() != JsonType::Number) || (size->getNumber() < 1))
+				{
+					printf("Ignoring pool entry %u in %s\n", static_cast<unsigned int>(i), path);
+					continue;
+				}
+
+				PooledScript pooled;
+				strncpy(pooled.path, script->getString(), sizeof(pooled.path) - 1);
+				pooled.path[sizeof(pooled.path) - 1] = '\0';
+				pooled.size = static_cast<std::size_t>(size->getNumber());
+
+				__pooledScripts.push_back(pooled);
+			}
+		}
+
+		delete configuration;
 	}
 } // end anonymous namespace
 
 //---------------------------------------------------------------------
 
-int main()
+int main(int argc, char** argv)
 {
-	// Register window class
-	WNDCLASSEXA wc;
-	wc.cbSize        = sizeof(WNDCLASSEX);
-	wc.style         = CS_CLASSDC;
-	wc.lpfnWndProc   = MsgProc;
-	wc.cbClsExtra    = 0;
-	wc.cbWndExtra    = 0;
-	wc.hInstance     = GetModuleHandle(0);
-	wc.hIcon         = LoadIcon(0, IDI_APPLICATION);
-	wc.hCursor       = LoadCursor(0, IDC_ARROW);
-	wc.hbrBackground = 0;
-	wc.lpszMenuName  = 0;
-	wc.lpszClassName = WINDOW_CLASS_NAME;
-	wc.hIconSm       = 0;
-
-	RegisterClassExA(&wc);
-
-	// Open the window
-	InitWindow(640, 480);
+	__parseArguments(argc, argv);
+
+	// Prepare the host before any threads are started
+	if (!Host::initialize())
+		return 1;
+
+	// Configure the threads and the watchdog
+	__loadConfiguration("config.json");
 
 	// Initialize the virtual machine
-	VirtualMachine::initialize();
+	if (!VirtualMachine::initialize())
+	{
+		printf("Unable to initialize the virtual machine\n");
+		Host::terminate();
+		return 1;
+	}
 
 	// Setup the embed libraries
-	EmbedLibraries::createInputLibrary();
-
-	// Start the thread
-	DWORD scriptThreadId;
-	HANDLE scriptThread = CreateThread(
-		0,
-		0,
-		__scriptThread,
-		0,
-		0,
-		&scriptThreadId
-	);
-
-	// Start the message pump
-	MSG msg = {0};
-
-	while (msg.message != WM_QUIT)
+	EmbedLibraries::createAsyncLibrary();
+	EmbedLibraries::createInputLibrary(__frameRate);
+	EmbedLibraries::createShardLibrary();
+	EmbedLibraries::createJobsLibrary();
+
+	// Start filling the isolate pools now that every library exists
+	std::size_t pooledCount = __pooledScripts.size();
+
+	for (std::size_t i = 0; i < pooledCount; ++i)
+		VirtualMachine::setIsolatePoolSize(__pooledScripts[i].path, __pooledScripts[i].size);
+
+	// Take over the listening sockets of a running server
+	if (__handoverPath)
+		Handover::inherit(__handoverPath);
+
+	// Start serving the script
+	bool started = VirtualMachine::startShards("server.dart", __shardCount);
+
+	if (started)
 	{
-		if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
-		{
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
-		}
-		else
+		// Let the running server drain once the shards are listening
+		if (__handoverPath)
 		{
-			updateGamePads();
+			Handover::complete(__handoverTimeout);
+			Handover::offer(__handoverPath, __drainTimeout);
 		}
+
+		// Serve the clients that asked for UDP
+		if (__udpPort != 0)
+			UdpTransport::start(__host, __udpPort, __frameRate);
+
+		// Drive the game pads until asked to exit
+		Host::run();
+	}
+	else
+	{
+		// A running server keeps serving as the handover never completed
+		printf("Unable to start serving server.dart\n");
 	}
 
+	// Stop handling messages and wait for the shards to exit
+	VirtualMachine::stopShards();
+
+	// Nothing is left to watch
+	Watchdog::stop();
+
+	// Stop serving UDP before the workers applying vibration go away
+	UdpTransport::terminate();
+
+	// Stop offering the listening sockets
+	Handover::terminate();
+	EmbedLibraries::terminateShardLibrary();
+
+	// Stop ticking frames
+	EmbedLibraries::terminateInputLibrary();
+
+	// Stop accepting jobs
+	EmbedLibraries::terminateJobsLibrary();
+
+	// Finish any outstanding jobs and vibration requests
+	EmbedLibraries::terminateAsyncLibrary();
+
 	// Destroy the virtual machine
 	VirtualMachine::terminate();
 
-	// Wait for the thread to exit
-	WaitForSingleObject(scriptThread, INFINITE);
+	// Stop driving the game pads
+	Host::terminate();
 
-	return 0;
+	return (started) ? 0 : 1;
 }
@@ -0,0 +1,211 @@
+/**
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+/**
+ * Measures the startup of the server over a number of runs.
+ *
+ * Usage: dart startup_benchmark.dart <server> [runs]
+ *
+ * Each run starts the server with --startup-report, waits for the report
+ * to be written, stops the server and reads the report. The median and
+ * minimum duration of each phase, along with the time until the first
+ * function returned, are printed in microseconds so runs from different
+ * builds can be compared.
+ */
+
+#import('dart:io');
+#import('dart:json');
+
+/// Time to wait for a report before giving up on a run
+final int _reportTimeout = 30000;
+/// How often to look for the report
+final int _pollInterval = 20;
+
+/// The path to the server
+String _server;
+/// The number of runs
+int _runs = 10;
+/// The durations of each phase across the runs
+Map<String, List<int>> _phases;
+/// The total startup time of each run
+List<int> _totals;
+
+int _median(List<int> values)
+{
+  List<int> sorted = new List<int>.from(values);
+  sorted.sort((a, b) => a.compareTo(b));
+
+  return sorted[sorted.length ~/ 2];
+}
+
+int _minimum(List<int> values)
+{
+  int value = values[0];
+
+  for (int i = 1; i < values.length; ++i)
+    if (values[i] < value)
+      value = values[i];
+
+  return value;
+}
+
+void _readReport(File file)
+{
+  Map report = JSON.parse(file.readAsTextSync());
+  Map<String, int> durations = new Map<String, int>();
+  int total = 0;
+
+  // Phases such as ScriptLibrary::load repeat so sum them within a run
+  for (Map phase in report['phases'])
+  {
+    String name = phase['name'];
+    int duration = phase['duration'];
+    int end = phase['start'] + duration;
+
+    durations[name] = durations.containsKey(name) ? durations[name] + duration : duration;
+
+    if (end > total)
+      total = end;
+  }
+
+  durations.forEach((name, duration) {
+    _phases.putIfAbsent(name, () => new List<int>()).add(duration);
+  });
+
+  _totals.add(total);
+}
+
+void _printResults()
+{
+  print('${_totals.length} of ${_runs} runs reported');
+
+  if (_totals.isEmpty())
+    return;
+
+  print('phase, median (us), minimum (us)');
+
+  List<String> names = new List<String>.from(_phases.getKeys());
+  names.sort((a, b) => a.compareTo(b));
+
+  for (String name in names)
+    print('${name}, ${_median(_phases[name])}, ${_minimum(_phases[name])}');
+
+  print('total, ${_median(_totals)}, ${_minimum(_totals)}');
+}
+
+void _run(int run)
+{
+  if (run == _runs)
+  {
+    _printResults();
+    return;
+  }
+
+  String path = 'startup_benchmark_${run}.json';
+  File file = new File(path);
+
+  if (file.existsSync())
+    file.deleteSync();
+
+  Process process = Process.start(_server, ['--startup-report=${path}']);
+  bool finished = false;
+
+  // Keep the output flowing so the server never blocks on it
+  process.stdout.onData = () => process.stdout.read();
+  process.stderr.onData = () => process.stderr.read();
+
+  void next()
+  {
+    if (finished)
+      return;
+
+    finished = true;
+    process.kill();
+
+    new Timer(0, (timer) => _run(run + 1));
+  }
+
+  process.onExit = (exitCode) {
+    if (!finished)
+    {
+      print('Run ${run} exited with ${exitCode} before reporting');
+      next();
+    }
+  };
+
+  process.onError = (e) {
+    print('Unable to start ${_server}: ${e}');
+    finished = true;
+  };
+
+  int started = new Date.now().millisecondsSinceEpoch;
+
+  new Timer.repeating(_pollInterval, (timer) {
+    if (finished)
+    {
+      timer.cancel();
+    }
+    else if (file.existsSync() && (file.lengthSync() > 0))
+    {
+      timer.cancel();
+
+      // The report is written in one go once the first function returns
+      new Timer(_pollInterval, (t) {
+        _readReport(file);
+        file.deleteSync();
+        next();
+      });
+    }
+    else if (new Date.now().millisecondsSinceEpoch - started > _reportTimeout)
+    {
+      timer.cancel();
+      print('Run ${run} timed out');
+      next();
+    }
+  });
+}
+
+void main()
+{
+  List<String> arguments = new Options().arguments;
+
+  if (arguments.isEmpty())
+  {
+    print('Usage: dart startup_benchmark.dart <server> [runs]');
+    return;
+  }
+
+  _server = arguments[0];
+
+  if (arguments.length > 1)
+    _runs = Math.parseInt(arguments[1]);
+
+  _phases = new Map<String, List<int>>();
+  _totals = new List<int>();
+
+  _run(0);
+}
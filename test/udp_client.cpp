@@ -0,0 +1,675 @@
+/**
+ * \file udp_client.cpp
+ *
+ * \section COPYRIGHT
+ *
+ * Dart Embedding Example
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Copyright (c) 2012 Don Olmstead
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not
+ *   claim that you wrote the original software. If you use this software
+ *   in a product, an acknowledgment in the product documentation would be
+ *   appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be
+ *   misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *   distribution.
+ */
+
+/**
+ * Loopback harness for the UDP transport.
+ *
+ * Usage: udp_client <host> <udpPort> <webSocketPort> [pings]
+ *
+ * Registers with the UDP transport, waits for a frame and checks the
+ * status each VibrationAck reports. Then measures the round trip of pings
+ * over UDP and over the WebSocket of the same server and prints both so
+ * the transports can be compared. The WebSocket pings
+ * are the ones GamePad.measureLatency sends from the browser client.
+ *
+ * Only supported on Linux. Built by the Makefile in server.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <DartEmbed/GamePad.hpp>
+#include "UdpTransport.hpp"
+using namespace DartEmbed;
+
+namespace
+{
+	/// Time to wait for an answer in milliseconds
+	const int __timeout = 1000;
+	/// Attempts at registering before giving up
+	const int __registerAttempts = 3;
+	/// The largest datagram the transport sends
+	const std::size_t __maximumDatagramLength = 256;
+
+	/**
+	 * Gets the current time of the monotonic clock.
+	 *
+	 * \returns The current time in microseconds.
+	 */
+	std::uint64_t __getMicroseconds()
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		return static_cast<std::uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+	}
+
+	/**
+	 * Waits for a descriptor to become readable.
+	 *
+	 * \param descriptor The descriptor to wait on.
+	 * \param deadline The time to give up at in microseconds.
+	 * \returns true if the descriptor is readable; false if the deadline passed.
+	 */
+	bool __waitReadable(int descriptor, std::uint64_t deadline)
+	{
+		while (true)
+		{
+			std::uint64_t now = __getMicroseconds();
+
+			if (now >= deadline)
+				return false;
+
+			pollfd poller;
+			poller.fd = descriptor;
+			poller.events = POLLIN;
+
+			int result = poll(&poller, 1, static_cast<int>((deadline - now + 999) / 1000));
+
+			if (result > 0)
+				return true;
+			else if ((result < 0) && (errno != EINTR))
+				return false;
+		}
+	}
+
+	/**
+	 * Opens a socket connected to the server.
+	 *
+	 * \param host The address of the server.
+	 * \param port The port of the server.
+	 * \param type SOCK_DGRAM or SOCK_STREAM.
+	 * \returns The socket or -1 if it couldn't be connected.
+	 */
+	int __connect(const char* host, int port, int type)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<std::uint16_t>(port));
+
+		if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+			return -1;
+
+		int descriptor = socket(AF_INET, type, 0);
+
+		if (descriptor == -1)
+			return -1;
+
+		if (connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			close(descriptor);
+			return -1;
+		}
+
+		return descriptor;
+	}
+
+	/**
+	 * Round trip times of a transport.
+	 */
+	struct Latency
+	{
+		/// The round trip of each ping answered in microseconds
+		std::vector<std::uint64_t> samples;
+		/// The number of pings sent
+		int sent;
+	} ; // end struct Latency
+
+	/**
+	 * Prints the round trips of a transport.
+	 *
+	 * \param name The name of the transport.
+	 * \param latency The round trips.
+	 */
+	void __printLatency(const char* name, Latency& latency)
+	{
+		std::vector<std::uint64_t>& samples = latency.samples;
+		std::size_t count = samples.size();
+
+		if (count == 0)
+		{
+			printf("%-9s %6d %6d %10s %10s %10s\n", name, latency.sent, latency.sent, "-", "-", "-");
+			return;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		printf("%-9s %6d %6d %10llu %10llu %10llu\n",
+			name,
+			latency.sent,
+			latency.sent - static_cast<int>(count),
+			static_cast<unsigned long long>(samples[count / 2]),
+			static_cast<unsigned long long>(samples[std::min(count - 1, count * 99 / 100)]),
+			static_cast<unsigned long long>(samples[count - 1]));
+	}
+
+	//---------------------------------------------------------------------
+	// UDP
+	//---------------------------------------------------------------------
+
+	/**
+	 * Receives a datagram of the given type.
+	 *
+	 * Datagrams of other types, such as frames, are skipped.
+	 *
+	 * \param descriptor The socket.
+	 * \param type The type of datagram to wait for.
+	 * \param data The buffer to receive into.
+	 * \param deadline The time to give up at in microseconds.
+	 * \returns The length of the datagram or -1 if none arrived in time.
+	 */
+	ssize_t __receiveDatagram(int descriptor, std::uint8_t type, std::uint8_t* data, std::uint64_t deadline)
+	{
+		while (__waitReadable(descriptor, deadline))
+		{
+			ssize_t length = recv(descriptor, data, __maximumDatagramLength, 0);
+
+			if ((length > 0) && (data[0] == type))
+				return length;
+		}
+
+		return -1;
+	}
+
+	/**
+	 * Registers for the first game pad.
+	 *
+	 * Echoes the cookie of the first RegisterAck to prove the address.
+	 *
+	 * \param descriptor The socket.
+	 * \returns true if registered; false otherwise.
+	 */
+	bool __register(int descriptor)
+	{
+		std::uint8_t request[6] = { UdpMessage::Register, 0x01, 0, 0, 0, 0 };
+		std::uint8_t reply[__maximumDatagramLength];
+
+		for (int attempt = 0; attempt < __registerAttempts * 2; ++attempt)
+		{
+			send(descriptor, request, sizeof(request), 0);
+
+			ssize_t length = __receiveDatagram(descriptor, UdpMessage::RegisterAck, reply, __getMicroseconds() + __timeout * 1000);
+
+			if (length < 7)
+				continue;
+
+			if (reply[6] == 1)
+				return true;
+
+			// Register again with the cookie
+			memcpy(request + 2, reply + 2, 4);
+		}
+
+		return false;
+	}
+
+	/**
+	 * Sends a Vibration and waits for its acknowledgement.
+	 *
+	 * Turns the motors off so running the harness never leaves a game pad
+	 * rumbling.
+	 *
+	 * \param descriptor The socket.
+	 * \param sequence The sequence number of the request.
+	 * \param player The index of the game pad.
+	 * \returns The status acknowledged or -1 if none arrived.
+	 */
+	int __vibrate(int descriptor, std::uint16_t sequence, std::uint8_t player)
+	{
+		std::uint8_t request[6] =
+		{
+			UdpMessage::Vibration,
+			static_cast<std::uint8_t>(sequence),
+			static_cast<std::uint8_t>(sequence >> 8),
+			player,
+			0,
+			0
+		};
+		std::uint8_t reply[__maximumDatagramLength];
+
+		for (int attempt = 0; attempt < __registerAttempts; ++attempt)
+		{
+			send(descriptor, request, sizeof(request), 0);
+
+			std::uint64_t deadline = __getMicroseconds() + __timeout * 1000;
+			ssize_t length;
+
+			while ((length = __receiveDatagram(descriptor, UdpMessage::VibrationAck, reply, deadline)) != -1)
+			{
+				// Skip acknowledgements of requests that already timed out
+				if ((length >= 4) && (reply[1] == request[1]) && (reply[2] == request[2]))
+					return reply[3];
+			}
+		}
+
+		return -1;
+	}
+
+	/**
+	 * Checks that a vibration request is acknowledged with the expected status.
+	 *
+	 * \param descriptor The socket.
+	 * \param name What the request is checking.
+	 * \param sequence The sequence number of the request.
+	 * \param player The index of the game pad.
+	 * \param expected The status expected, or -1 for Applied or Unavailable.
+	 * \param status The status acknowledged, or -1 if none arrived.
+	 * \returns true if the status was expected; false otherwise.
+	 */
+	bool __checkVibration(int descriptor, const char* name, std::uint16_t sequence, std::uint8_t player, int expected, int* status)
+	{
+		*status = __vibrate(descriptor, sequence, player);
+
+		bool passed = (expected == -1)
+			? ((*status == VibrationStatus::Applied) || (*status == VibrationStatus::Unavailable))
+			: (*status == expected);
+
+		printf("UDP: vibration %-9s acknowledged %2d: %s\n", name, *status, (passed) ? "ok" : "unexpected");
+
+		return passed;
+	}
+
+	/**
+	 * Checks the status reported for newest, resent, stale and invalid requests.
+	 *
+	 * \param descriptor The socket.
+	 * \returns true if every status was expected; false otherwise.
+	 */
+	bool __runVibration(int descriptor)
+	{
+		int status;
+		bool passed = __checkVibration(descriptor, "newest", 2, 0, -1, &status);
+
+		// A resend is answered as it was the first time
+		passed &= __checkVibration(descriptor, "resent", 2, 0, (status != -1) ? status : VibrationStatus::Applied, &status);
+		passed &= __checkVibration(descriptor, "stale", 1, 0, VibrationStatus::Stale, &status);
+		passed &= __checkVibration(descriptor, "invalid", 3, PlayerIndex::Size, VibrationStatus::Invalid, &status);
+
+		return passed;
+	}
+
+	/**
+	 * Runs the UDP part of the harness.
+	 *
+	 * \param host The address of the server.
+	 * \param port The port of the UDP transport.
+	 * \param pings The number of pings to send.
+	 * \param latency The round trips measured.
+	 * \returns true if the transport answered as expected; false otherwise.
+	 */
+	bool __runUdp(const char* host, int port, int pings, Latency* latency)
+	{
+		int descriptor = __connect(host, port, SOCK_DGRAM);
+
+		if (descriptor == -1)
+		{
+			printf("Unable to open a UDP socket to %s:%d\n", host, port);
+			return false;
+		}
+
+		if (!__register(descriptor))
+		{
+			printf("UDP: no registration acknowledged\n");
+			close(descriptor);
+			return false;
+		}
+
+		std::uint8_t data[__maximumDatagramLength];
+
+		// Registered clients are sent a frame at least once a second
+		ssize_t length = __receiveDatagram(descriptor, UdpMessage::Frame, data, __getMicroseconds() + 2 * __timeout * 1000);
+
+		if (length >= 6)
+		{
+			std::uint32_t sequence = data[2] | (data[3] << 8) | (data[4] << 16) | (static_cast<std::uint32_t>(data[5]) << 24);
+			printf("UDP: registered, frame %u holds %u game pads\n", sequence, static_cast<unsigned int>(data[1]));
+		}
+		else
+		{
+			printf("UDP: registered, but no frame arrived\n");
+		}
+
+		bool vibrationPassed = __runVibration(descriptor);
+
+		for (int i = 0; i < pings; ++i)
+		{
+			std::uint8_t ping[9];
+			std::uint64_t sent = __getMicroseconds();
+
+			ping[0] = UdpMessage::Ping;
+			memcpy(ping + 1, &sent, sizeof(sent));
+
+			send(descriptor, ping, sizeof(ping), 0);
+			latency->sent++;
+
+			std::uint64_t deadline = sent + __timeout * 1000;
+
+			while ((length = __receiveDatagram(descriptor, UdpMessage::Pong, data, deadline)) != -1)
+			{
+				// Skip pongs of pings that already timed out
+				if ((length == sizeof(ping)) && (memcmp(data + 1, ping + 1, sizeof(sent)) == 0))
+				{
+					latency->samples.push_back(__getMicroseconds() - sent);
+					break;
+				}
+			}
+		}
+
+		std::uint8_t unregister = UdpMessage::Unregister;
+		send(descriptor, &unregister, sizeof(unregister), 0);
+
+		close(descriptor);
+		return vibrationPassed;
+	}
+
+	//---------------------------------------------------------------------
+	// WebSocket
+	//---------------------------------------------------------------------
+
+	/**
+	 * Reads from a stream through a buffer.
+	 */
+	struct StreamReader
+	{
+		/// The socket
+		int descriptor;
+		/// Bytes read but not consumed
+		std::string buffered;
+	} ; // end struct StreamReader
+
+	/**
+	 * Reads until the buffer holds at least the given number of bytes.
+	 *
+	 * \param reader The reader.
+	 * \param count The number of bytes needed.
+	 * \param deadline The time to give up at in microseconds.
+	 * \returns true if the bytes are buffered; false otherwise.
+	 */
+	bool __fill(StreamReader* reader, std::size_t count, std::uint64_t deadline)
+	{
+		while (reader->buffered.size() < count)
+		{
+			if (!__waitReadable(reader->descriptor, deadline))
+				return false;
+
+			char data[4096];
+			ssize_t length = recv(reader->descriptor, data, sizeof(data), 0);
+
+			if (length <= 0)
+				return false;
+
+			reader->buffered.append(data, static_cast<std::size_t>(length));
+		}
+
+		return true;
+	}
+
+	/**
+	 * Opens the WebSocket.
+	 *
+	 * \param reader The reader for the connected socket.
+	 * \param host The address of the server.
+	 * \param port The port of the server.
+	 * \returns true if the server accepted the upgrade; false otherwise.
+	 */
+	bool __handshake(StreamReader* reader, const char* host, int port)
+	{
+		char request[512];
+		int length = snprintf(request, sizeof(request),
+			"GET /ws HTTP/1.1\r\n"
+			"Host: %s:%d\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"\r\n",
+			host, port);
+
+		if (send(reader->descriptor, request, length, 0) != length)
+			return false;
+
+		std::uint64_t deadline = __getMicroseconds() + __timeout * 1000;
+		std::size_t end;
+
+		while ((end = reader->buffered.find("\r\n\r\n")) == std::string::npos)
+		{
+			if (!__fill(reader, reader->buffered.size() + 1, deadline))
+				return false;
+		}
+
+		bool upgraded = (reader->buffered.compare(0, 12, "HTTP/1.1 101") == 0);
+		reader->buffered.erase(0, end + 4);
+
+		return upgraded;
+	}
+
+	/**
+	 * Sends a text message.
+	 *
+	 * Messages from a client are masked as the protocol requires.
+	 *
+	 * \param descriptor The socket.
+	 * \param text The message, shorter than 126 bytes.
+	 * \returns true if the message was sent; false otherwise.
+	 */
+	bool __sendText(int descriptor, const char* text)
+	{
+		std::size_t length = strlen(text);
+		std::uint8_t frame[2 + 4 + 125];
+		const std::uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+		frame[0] = 0x81;
+		frame[1] = static_cast<std::uint8_t>(0x80 | length);
+		memcpy(frame + 2, mask, sizeof(mask));
+
+		for (std::size_t i = 0; i < length; ++i)
+			frame[6 + i] = static_cast<std::uint8_t>(text[i]) ^ mask[i % 4];
+
+		ssize_t size = static_cast<ssize_t>(6 + length);
+
+		return send(descriptor, frame, size, 0) == size;
+	}
+
+	/**
+	 * Receives the next message.
+	 *
+	 * \param reader The reader.
+	 * \param opcode The opcode of the message.
+	 * \param payload The payload of the message.
+	 * \param deadline The time to give up at in microseconds.
+	 * \returns true if a message was received; false otherwise.
+	 */
+	bool __receiveMessage(StreamReader* reader, int* opcode, std::string* payload, std::uint64_t deadline)
+	{
+		if (!__fill(reader, 2, deadline))
+			return false;
+
+		const std::uint8_t* header = reinterpret_cast<const std::uint8_t*>(reader->buffered.data());
+		std::size_t headerLength = 2;
+		std::uint64_t length = header[1] & 0x7f;
+		bool masked = (header[1] & 0x80) != 0;
+
+		*opcode = header[0] & 0x0f;
+
+		if (length == 126)
+			headerLength += 2;
+		else if (length == 127)
+			headerLength += 8;
+
+		if (masked)
+			headerLength += 4;
+
+		if (!__fill(reader, headerLength, deadline))
+			return false;
+
+		header = reinterpret_cast<const std::uint8_t*>(reader->buffered.data());
+
+		if (length >= 126)
+		{
+			std::size_t bytes = (length == 126) ? 2 : 8;
+			length = 0;
+
+			for (std::size_t i = 0; i < bytes; ++i)
+				length = (length << 8) | header[2 + i];
+		}
+
+		if (!__fill(reader, headerLength + static_cast<std::size_t>(length), deadline))
+			return false;
+
+		payload->assign(reader->buffered, headerLength, static_cast<std::size_t>(length));
+
+		if (masked)
+		{
+			const char* mask = reader->buffered.data() + headerLength - 4;
+
+			for (std::size_t i = 0; i < payload->size(); ++i)
+				(*payload)[i] ^= mask[i % 4];
+		}
+
+		reader->buffered.erase(0, headerLength + static_cast<std::size_t>(length));
+
+		return true;
+	}
+
+	/**
+	 * Runs the WebSocket part of the harness.
+	 *
+	 * \param host The address of the server.
+	 * \param port The port of the WebSocket.
+	 * \param pings The number of pings to send.
+	 * \param latency The round trips measured.
+	 * \returns true if the WebSocket answered; false otherwise.
+	 */
+	bool __runWebSocket(const char* host, int port, int pings, Latency* latency)
+	{
+		StreamReader reader;
+		reader.descriptor = __connect(host, port, SOCK_STREAM);
+
+		if (reader.descriptor == -1)
+		{
+			printf("Unable to connect to %s:%d\n", host, port);
+			return false;
+		}
+
+		// Pings are tiny so don't let Nagle hold them back
+		int noDelay = 1;
+		setsockopt(reader.descriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		if (!__handshake(&reader, host, port))
+		{
+			printf("WebSocket: upgrade refused\n");
+			close(reader.descriptor);
+			return false;
+		}
+
+		for (int i = 0; i < pings; ++i)
+		{
+			char ping[64];
+			snprintf(ping, sizeof(ping), "{\"type\":\"ping\",\"time\":%d}", i);
+
+			std::uint64_t sent = __getMicroseconds();
+
+			if (!__sendText(reader.descriptor, ping))
+				break;
+
+			latency->sent++;
+
+			std::uint64_t deadline = sent + __timeout * 1000;
+			int opcode = 0;
+			std::string payload;
+
+			// Game pad state is sent on the same connection so skip it
+			while (__receiveMessage(&reader, &opcode, &payload, deadline))
+			{
+				if (opcode == 0x8)
+					break;
+
+				if ((opcode == 0x1) && (payload.find("\"pong\"") != std::string::npos))
+				{
+					latency->samples.push_back(__getMicroseconds() - sent);
+					break;
+				}
+			}
+
+			if (opcode == 0x8)
+			{
+				printf("WebSocket: closed by the server\n");
+				break;
+			}
+		}
+
+		close(reader.descriptor);
+		return true;
+	}
+} // end anonymous namespace
+
+//---------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		printf("Usage: udp_client <host> <udpPort> <webSocketPort> [pings]\n");
+		return 1;
+	}
+
+	const char* host = argv[1];
+	int udpPort = atoi(argv[2]);
+	int webSocketPort = atoi(argv[3]);
+	int pings = (argc > 4) ? atoi(argv[4]) : 1000;
+
+	Latency udp;
+	udp.sent = 0;
+
+	Latency webSocket;
+	webSocket.sent = 0;
+
+	bool udpAnswered = __runUdp(host, udpPort, pings, &udp);
+	bool webSocketAnswered = __runWebSocket(host, webSocketPort, pings, &webSocket);
+
+	printf("%-9s %6s %6s %10s %10s %10s\n", "transport", "pings", "lost", "p50 (us)", "p99 (us)", "max (us)");
+	__printLatency("udp", udp);
+	__printLatency("websocket", webSocket);
+
+	return (udpAnswered && webSocketAnswered) ? 0 : 1;
+}